@@ -13,11 +13,14 @@ static bool registerVirtualMachine(nVirtualMachine::cVirtualMachine& virtualMach
 {
 	using namespace nVirtualMachine::nLibrary;
 
+	cRawSocket::cConfig rawSocketConfig;
+	rawSocketConfig.exceptInterfaces = {"mgmt0"};
+
 	if (!virtualMachine.registerLibraries(new cBase(argc,
 	                                                argv,
 	                                                envp),
 	                                      new cConsole(),
-	                                      new cRawSocket({"mgmt0"}),
+	                                      new cRawSocket(rawSocketConfig),
 	                                      new cHttpServer("0.0.0.0", 8080)))
 	{
 		return false;
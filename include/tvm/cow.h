@@ -0,0 +1,188 @@
+// Copyright © 2017, Timur Aitov. Contacts: timonbl4@gmail.com. All rights reserved
+
+#ifndef TVM_COW_H
+#define TVM_COW_H
+
+#include <memory>
+#include <algorithm>
+
+#include "stream.h"
+
+namespace nVirtualMachine
+{
+
+/** copy on write container (std::string, std::vector<uint8_t>): copies share one reference counted storage.
+ *  readers use get(), writers mutate() (own storage is copied first when shared). empty value has no storage */
+template<typename TContainer>
+class cCow
+{
+public:
+	using container_type = TContainer;
+	using value_type = typename TContainer::value_type;
+	using size_type = typename TContainer::size_type;
+	using const_iterator = typename TContainer::const_iterator;
+
+	constexpr static size_type npos = (size_type)-1;
+
+public:
+	cCow()
+	{
+	}
+
+	explicit cCow(const TContainer& container) :
+	        storage(std::make_shared<TContainer>(container))
+	{
+	}
+
+	explicit cCow(TContainer&& container) :
+	        storage(std::make_shared<TContainer>(std::move(container)))
+	{
+	}
+
+	const TContainer& get() const
+	{
+		static const TContainer emptyContainer;
+		if (!storage)
+		{
+			return emptyContainer;
+		}
+		return *storage;
+	}
+
+	TContainer& mutate()
+	{
+		if (!storage)
+		{
+			storage = std::make_shared<TContainer>();
+		}
+		else if (storage.use_count() > 1)
+		{
+			storage = std::make_shared<TContainer>(*storage);
+		}
+		return *storage;
+	}
+
+	size_type size() const
+	{
+		return get().size();
+	}
+
+	bool empty() const
+	{
+		return get().empty();
+	}
+
+	void clear()
+	{
+		storage.reset();
+	}
+
+	const_iterator begin() const
+	{
+		return get().begin();
+	}
+
+	const_iterator end() const
+	{
+		return get().end();
+	}
+
+	/** whole value is shared, not copied */
+	cCow substr(const size_type position,
+	            const size_type count = npos) const
+	{
+		if (!position &&
+		    count >= size())
+		{
+			return *this;
+		}
+		return cCow(get().substr(position, count));
+	}
+
+	size_type find(const cCow& second,
+	               const size_type position = 0) const
+	{
+		return get().find(second.get(), position);
+	}
+
+	cCow& operator+=(const cCow& second)
+	{
+		if (empty())
+		{
+			storage = second.storage;
+		}
+		else if (!second.empty())
+		{
+			/** second may share storage with this */
+			const cCow tail = second;
+			TContainer& container = mutate();
+			container.insert(container.end(), tail.begin(), tail.end());
+		}
+		return *this;
+	}
+
+	cCow operator+(const cCow& second) const
+	{
+		cCow result = *this;
+		result += second;
+		return result;
+	}
+
+	bool operator==(const cCow& second) const
+	{
+		return storage == second.storage ||
+		       get() == second.get();
+	}
+
+	bool operator!=(const cCow& second) const
+	{
+		return !(*this == second);
+	}
+
+	bool operator<(const cCow& second) const
+	{
+		return get() < second.get();
+	}
+
+	bool operator>(const cCow& second) const
+	{
+		return second < *this;
+	}
+
+	bool operator<=(const cCow& second) const
+	{
+		return !(second < *this);
+	}
+
+	bool operator>=(const cCow& second) const
+	{
+		return !(*this < second);
+	}
+
+	void streamPush(cStreamOut& stream) const
+	{
+		stream.push(get());
+	}
+
+	void streamPop(cStreamIn& stream)
+	{
+		TContainer container;
+		stream.pop(container);
+		if (container.empty())
+		{
+			storage.reset();
+			return;
+		}
+		storage = std::make_shared<TContainer>(std::move(container));
+	}
+
+private:
+	std::shared_ptr<TContainer> storage;
+};
+
+template<typename TContainer>
+constexpr typename cCow<TContainer>::size_type cCow<TContainer>::npos;
+
+}
+
+#endif // TVM_COW_H
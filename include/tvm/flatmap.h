@@ -0,0 +1,639 @@
+// Copyright © 2017, Timur Aitov. Contacts: timonbl4@gmail.com. All rights reserved
+
+#ifndef TVM_FLATMAP_H
+#define TVM_FLATMAP_H
+
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <numeric>
+
+#include "logic.h"
+#include "stream.h"
+
+namespace nVirtualMachine
+{
+
+/** read mostly map: keys and values in two sorted arrays, branchless binary search over keys.
+ *  insert() appends, build() sorts once (last inserted value wins); find() builds pending inserts */
+template<typename TKeyType,
+         typename TValueType>
+class cFlatMap
+{
+public:
+	cFlatMap()
+	{
+		sorted = true;
+	}
+
+	size_t size()
+	{
+		build();
+		return keys.size();
+	}
+
+	bool empty() const
+	{
+		return keys.empty();
+	}
+
+	void clear()
+	{
+		keys.clear();
+		values.clear();
+		sorted = true;
+	}
+
+	void reserve(const size_t count)
+	{
+		keys.reserve(count);
+		values.reserve(count);
+	}
+
+	void insert(const TKeyType& key,
+	            const TValueType& value)
+	{
+		if (sorted &&
+		    keys.size() &&
+		    !(keys.back() < key))
+		{
+			sorted = false;
+		}
+
+		keys.push_back(key);
+		values.push_back(value);
+	}
+
+	void build()
+	{
+		if (sorted)
+		{
+			return;
+		}
+
+		std::vector<size_t> order(keys.size());
+		std::iota(order.begin(), order.end(), 0);
+		std::stable_sort(order.begin(), order.end(), [this](const size_t first, const size_t second)
+		{
+			return keys[first] < keys[second];
+		});
+
+		std::vector<TKeyType> sortedKeys;
+		std::vector<TValueType> sortedValues;
+		sortedKeys.reserve(keys.size());
+		sortedValues.reserve(values.size());
+
+		for (size_t order_i = 0; order_i < order.size(); order_i++)
+		{
+			/** equal keys: keep last inserted */
+			if (order_i + 1 < order.size() &&
+			    !(keys[order[order_i]] < keys[order[order_i + 1]]))
+			{
+				continue;
+			}
+
+			sortedKeys.push_back(std::move(keys[order[order_i]]));
+			sortedValues.push_back(std::move(values[order[order_i]]));
+		}
+
+		keys.swap(sortedKeys);
+		values.swap(sortedValues);
+		sorted = true;
+	}
+
+	/** std::map is already sorted: no sort */
+	void assign(const std::map<TKeyType, TValueType>& map)
+	{
+		clear();
+		reserve(map.size());
+		for (const auto& iter : map)
+		{
+			keys.push_back(iter.first);
+			values.push_back(iter.second);
+		}
+	}
+
+	const TValueType* find(const TKeyType& key)
+	{
+		build();
+
+		if (keys.empty())
+		{
+			return nullptr;
+		}
+
+		const TKeyType* base = keys.data();
+		size_t length = keys.size();
+
+		while (length > 1)
+		{
+			const size_t half = length / 2;
+
+			/** both possible next middles: hides memory latency on large tables */
+			__builtin_prefetch(base + half / 2);
+			__builtin_prefetch(base + half + half / 2);
+
+			base = (base[half] < key) ? base + half : base;
+			length -= half;
+		}
+
+		const size_t index = (base - keys.data()) + (*base < key);
+		if (index == keys.size() ||
+		    key < keys[index])
+		{
+			return nullptr;
+		}
+
+		return &values[index];
+	}
+
+	const TKeyType& getKey(const size_t index) const
+	{
+		return keys[index];
+	}
+
+	const TValueType& getValue(const size_t index) const
+	{
+		return values[index];
+	}
+
+	void streamPush(cStreamOut& stream) const
+	{
+		/** pending inserts are pushed as is, pop rebuilds */
+		stream.push((uint32_t)keys.size());
+		for (size_t i = 0; i < keys.size(); i++)
+		{
+			stream.push(keys[i]);
+			stream.push(values[i]);
+		}
+	}
+
+	void streamPop(cStreamIn& stream)
+	{
+		clear();
+
+		uint32_t count;
+		stream.pop(count);
+		for (uint64_t i = 0; i < count && !stream.isFailed(); i++)
+		{
+			TKeyType key;
+			TValueType value;
+			stream.pop(key);
+			stream.pop(value);
+			insert(key, value);
+		}
+
+		build();
+	}
+
+private:
+	std::vector<TKeyType> keys;
+	std::vector<TValueType> values;
+	bool sorted; ///< false: inserts since last build()
+};
+
+template<typename TKeyType,
+         typename TValueType>
+class cLogicFlatMapInsert : public cLogicModule
+{
+	using tFlatMap = cFlatMap<TKeyType, TValueType>;
+
+public:
+	cLogicFlatMapInsert(const tMemoryTypeName& memoryKeyTypeName,
+	                    const tMemoryTypeName& memoryValueTypeName) :
+	        memoryKeyTypeName(memoryKeyTypeName),
+	        memoryValueTypeName(memoryValueTypeName)
+	{
+	}
+
+	cModule* clone() const override
+	{
+		return new cLogicFlatMapInsert(memoryKeyTypeName,
+		                               memoryValueTypeName);
+	}
+
+	bool registerModule() override
+	{
+		tMemoryTypeName memoryTypeNameFlatMap = "flatMap<" + memoryKeyTypeName.value + "," + memoryValueTypeName.value + ">";
+
+		setModuleName("insert");
+		setCaptionName("insert");
+
+		if (!registerSignalEntry("signal", &cLogicFlatMapInsert::signalEntry))
+		{
+			return false;
+		}
+
+		if (!registerMemoryEntry("key", memoryKeyTypeName, key))
+		{
+			return false;
+		}
+
+		if (!registerMemoryEntry("value", memoryValueTypeName, value))
+		{
+			return false;
+		}
+
+		if (!registerSignalExit("signal", signalExit))
+		{
+			return false;
+		}
+
+		if (!registerMemoryExit(memoryTypeNameFlatMap.value, memoryTypeNameFlatMap, flatMap))
+		{
+			return false;
+		}
+
+		return true;
+	}
+
+private: /** signalEntries */
+	bool signalEntry()
+	{
+		if (flatMap && key && value)
+		{
+			flatMap->insert(*key, *value);
+		}
+		return signalFlow(signalExit);
+	}
+
+private:
+	const tMemoryTypeName memoryKeyTypeName;
+	const tMemoryTypeName memoryValueTypeName;
+
+private:
+	const tSignalExitId signalExit = 1;
+
+private:
+	TKeyType* key;
+	TValueType* value;
+	tFlatMap* flatMap;
+};
+
+template<typename TKeyType,
+         typename TValueType>
+class cLogicFlatMapBuild : public cLogicModule
+{
+	using tFlatMap = cFlatMap<TKeyType, TValueType>;
+
+public:
+	cLogicFlatMapBuild(const tMemoryTypeName& memoryKeyTypeName,
+	                   const tMemoryTypeName& memoryValueTypeName) :
+	        memoryKeyTypeName(memoryKeyTypeName),
+	        memoryValueTypeName(memoryValueTypeName)
+	{
+	}
+
+	cModule* clone() const override
+	{
+		return new cLogicFlatMapBuild(memoryKeyTypeName,
+		                              memoryValueTypeName);
+	}
+
+	bool registerModule() override
+	{
+		tMemoryTypeName memoryTypeNameFlatMap = "flatMap<" + memoryKeyTypeName.value + "," + memoryValueTypeName.value + ">";
+
+		setModuleName("build");
+		setCaptionName("build");
+
+		if (!registerSignalEntry("signal", &cLogicFlatMapBuild::signalEntry))
+		{
+			return false;
+		}
+
+		if (!registerSignalExit("signal", signalExit))
+		{
+			return false;
+		}
+
+		if (!registerMemoryExit(memoryTypeNameFlatMap.value, memoryTypeNameFlatMap, flatMap))
+		{
+			return false;
+		}
+
+		return true;
+	}
+
+private: /** signalEntries */
+	bool signalEntry()
+	{
+		if (flatMap)
+		{
+			flatMap->build();
+		}
+		return signalFlow(signalExit);
+	}
+
+private:
+	const tMemoryTypeName memoryKeyTypeName;
+	const tMemoryTypeName memoryValueTypeName;
+
+private:
+	const tSignalExitId signalExit = 1;
+
+private:
+	tFlatMap* flatMap;
+};
+
+template<typename TKeyType,
+         typename TValueType>
+class cLogicFlatMapFind : public cLogicModule
+{
+	using tFlatMap = cFlatMap<TKeyType, TValueType>;
+
+public:
+	cLogicFlatMapFind(const tMemoryTypeName& memoryKeyTypeName,
+	                  const tMemoryTypeName& memoryValueTypeName) :
+	        memoryKeyTypeName(memoryKeyTypeName),
+	        memoryValueTypeName(memoryValueTypeName)
+	{
+	}
+
+	cModule* clone() const override
+	{
+		return new cLogicFlatMapFind(memoryKeyTypeName,
+		                             memoryValueTypeName);
+	}
+
+	bool registerModule() override
+	{
+		tMemoryTypeName memoryTypeNameFlatMap = "flatMap<" + memoryKeyTypeName.value + "," + memoryValueTypeName.value + ">";
+
+		setModuleName("find");
+		setCaptionName("find");
+
+		if (!registerSignalEntry("signal", &cLogicFlatMapFind::signalEntry))
+		{
+			return false;
+		}
+
+		if (!registerMemoryEntry(memoryTypeNameFlatMap.value, memoryTypeNameFlatMap, flatMap))
+		{
+			return false;
+		}
+
+		if (!registerMemoryEntry("key", memoryKeyTypeName, key))
+		{
+			return false;
+		}
+
+		if (!registerSignalExit("done", signalExitDone))
+		{
+			return false;
+		}
+
+		if (!registerSignalExit("fail", signalExitFail))
+		{
+			return false;
+		}
+
+		if (!registerMemoryExit("value", memoryValueTypeName, value))
+		{
+			return false;
+		}
+
+		return true;
+	}
+
+private: /** signalEntries */
+	bool signalEntry()
+	{
+		if (!flatMap || !key)
+		{
+			return signalFlow(signalExitFail);
+		}
+
+		const TValueType* found = flatMap->find(*key);
+		if (!found)
+		{
+			return signalFlow(signalExitFail);
+		}
+
+		if (value)
+		{
+			*value = *found;
+		}
+
+		return signalFlow(signalExitDone);
+	}
+
+private:
+	const tMemoryTypeName memoryKeyTypeName;
+	const tMemoryTypeName memoryValueTypeName;
+
+private:
+	const tSignalExitId signalExitDone = 1;
+	const tSignalExitId signalExitFail = 2;
+
+private:
+	tFlatMap* flatMap;
+	TKeyType* key;
+	TValueType* value;
+};
+
+template<typename TKeyType,
+         typename TValueType>
+class cLogicFlatMapForEach : public cLogicModule
+{
+	using tFlatMap = cFlatMap<TKeyType, TValueType>;
+
+public:
+	cLogicFlatMapForEach(const tMemoryTypeName& memoryKeyTypeName,
+	                     const tMemoryTypeName& memoryValueTypeName) :
+	        memoryKeyTypeName(memoryKeyTypeName),
+	        memoryValueTypeName(memoryValueTypeName)
+	{
+	}
+
+	cModule* clone() const override
+	{
+		return new cLogicFlatMapForEach(memoryKeyTypeName,
+		                                memoryValueTypeName);
+	}
+
+	bool registerModule() override
+	{
+		tMemoryTypeName memoryTypeNameFlatMap = "flatMap<" + memoryKeyTypeName.value + "," + memoryValueTypeName.value + ">";
+
+		setModuleName("forEach");
+		setCaptionName("forEach");
+
+		if (!registerSignalEntry("begin", &cLogicFlatMapForEach::signalEntryBegin))
+		{
+			return false;
+		}
+
+		if (!registerSignalEntry("continue", &cLogicFlatMapForEach::signalEntryContinue))
+		{
+			return false;
+		}
+
+		if (!registerMemoryEntry(memoryTypeNameFlatMap.value, memoryTypeNameFlatMap, flatMap))
+		{
+			return false;
+		}
+
+		if (!registerSignalExit("iteration", signalExitIteration))
+		{
+			return false;
+		}
+
+		if (!registerSignalExit("done", signalExitDone))
+		{
+			return false;
+		}
+
+		if (!registerMemoryExit("key", memoryKeyTypeName, key))
+		{
+			return false;
+		}
+
+		if (!registerMemoryExit("value", memoryValueTypeName, value))
+		{
+			return false;
+		}
+
+		return true;
+	}
+
+private: /** signalEntries */
+	bool signalEntryBegin()
+	{
+		if (!flatMap)
+		{
+			return signalFlow(signalExitDone);
+		}
+
+		flatMap->build();
+		index = 0;
+
+		return iteration();
+	}
+
+	bool signalEntryContinue()
+	{
+		if (!flatMap)
+		{
+			return signalFlow(signalExitDone);
+		}
+
+		return iteration();
+	}
+
+private:
+	bool iteration()
+	{
+		if (index < flatMap->size())
+		{
+			if (key)
+			{
+				*key = flatMap->getKey(index);
+			}
+
+			if (value)
+			{
+				*value = flatMap->getValue(index);
+			}
+
+			index++;
+			return signalFlow(signalExitIteration);
+		}
+		return signalFlow(signalExitDone);
+	}
+
+private:
+	const tMemoryTypeName memoryKeyTypeName;
+	const tMemoryTypeName memoryValueTypeName;
+
+private:
+	const tSignalExitId signalExitIteration = 1;
+	const tSignalExitId signalExitDone = 2;
+
+private:
+	tFlatMap* flatMap;
+	TKeyType* key;
+	TValueType* value;
+
+private:
+	size_t index;
+};
+
+/** freezes map<key,value> loaded by scheme */
+template<typename TKeyType,
+         typename TValueType>
+class cLogicFlatMapFromMap : public cLogicModule
+{
+	using tMap = std::map<TKeyType, TValueType>;
+	using tFlatMap = cFlatMap<TKeyType, TValueType>;
+
+public:
+	cLogicFlatMapFromMap(const tMemoryTypeName& memoryKeyTypeName,
+	                     const tMemoryTypeName& memoryValueTypeName) :
+	        memoryKeyTypeName(memoryKeyTypeName),
+	        memoryValueTypeName(memoryValueTypeName)
+	{
+	}
+
+	cModule* clone() const override
+	{
+		return new cLogicFlatMapFromMap(memoryKeyTypeName,
+		                                memoryValueTypeName);
+	}
+
+	bool registerModule() override
+	{
+		tMemoryTypeName memoryTypeNameMap = cLogicMapTypeName<tMap>::get(memoryKeyTypeName, memoryValueTypeName);
+		tMemoryTypeName memoryTypeNameFlatMap = "flatMap<" + memoryKeyTypeName.value + "," + memoryValueTypeName.value + ">";
+
+		setModuleName("fromMap");
+		setCaptionName("fromMap");
+
+		if (!registerSignalEntry("signal", &cLogicFlatMapFromMap::signalEntry))
+		{
+			return false;
+		}
+
+		if (!registerMemoryEntry(memoryTypeNameMap.value, memoryTypeNameMap, map))
+		{
+			return false;
+		}
+
+		if (!registerSignalExit("signal", signalExit))
+		{
+			return false;
+		}
+
+		if (!registerMemoryExit(memoryTypeNameFlatMap.value, memoryTypeNameFlatMap, flatMap))
+		{
+			return false;
+		}
+
+		return true;
+	}
+
+private: /** signalEntries */
+	bool signalEntry()
+	{
+		if (map && flatMap)
+		{
+			flatMap->assign(*map);
+		}
+		return signalFlow(signalExit);
+	}
+
+private:
+	const tMemoryTypeName memoryKeyTypeName;
+	const tMemoryTypeName memoryValueTypeName;
+
+private:
+	const tSignalExitId signalExit = 1;
+
+private:
+	tMap* map;
+	tFlatMap* flatMap;
+};
+
+}
+
+#endif // TVM_FLATMAP_H
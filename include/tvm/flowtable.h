@@ -0,0 +1,784 @@
+// Copyright © 2017, Timur Aitov. Contacts: timonbl4@gmail.com. All rights reserved
+
+#ifndef TVM_FLOWTABLE_H
+#define TVM_FLOWTABLE_H
+
+#include <vector>
+
+#include <time.h>
+
+#include "logic.h"
+#include "stream.h"
+#include "hash.h"
+
+namespace nVirtualMachine
+{
+
+/** open addressing hash table (linear probing, backward shift deletion) with idle aging and entries limit */
+template<typename TKeyType,
+         typename TValueType>
+class cFlowTable
+{
+public:
+	cFlowTable()
+	{
+		count = 0;
+		limit = defaultLimit;
+	}
+
+	size_t size() const
+	{
+		return count;
+	}
+
+	bool empty() const
+	{
+		return !count;
+	}
+
+	void clear()
+	{
+		slots.clear();
+		count = 0;
+	}
+
+	size_t getLimit() const
+	{
+		return limit;
+	}
+
+	/** limit 0 disables inserts, entries above new limit are evicted by next insert */
+	void setLimit(const size_t limit)
+	{
+		this->limit = limit;
+	}
+
+	/** updates last seen time of found entry */
+	TValueType* find(const TKeyType& key)
+	{
+		if (!count)
+		{
+			return nullptr;
+		}
+
+		const uint64_t hash = makeHash(key);
+		const size_t mask = slots.size() - 1;
+
+		for (size_t slot_i = hash & mask;; slot_i = (slot_i + 1) & mask)
+		{
+			cSlot& slot = slots[slot_i];
+			if (!slot.hash)
+			{
+				return nullptr;
+			}
+
+			if (slot.hash == hash &&
+			    slot.key == key)
+			{
+				slot.lastSeen = getTime();
+				return &slot.value;
+			}
+		}
+	}
+
+	/** returns false if limit is 0 */
+	bool insertOrUpdate(const TKeyType& key,
+	                    const TValueType& value)
+	{
+		const uint64_t hash = makeHash(key);
+		const uint64_t time = getTime();
+
+		if (count)
+		{
+			const size_t mask = slots.size() - 1;
+
+			for (size_t slot_i = hash & mask;; slot_i = (slot_i + 1) & mask)
+			{
+				cSlot& slot = slots[slot_i];
+				if (!slot.hash)
+				{
+					break;
+				}
+
+				if (slot.hash == hash &&
+				    slot.key == key)
+				{
+					slot.value = value;
+					slot.lastSeen = time;
+					return true;
+				}
+			}
+		}
+
+		if (!limit)
+		{
+			return false;
+		}
+
+		while (count >= limit)
+		{
+			evict(hash);
+		}
+
+		if ((count + 1) * loadDenominator > slots.size() * loadNumerator)
+		{
+			resize(slots.size() ? slots.size() * 2 : minCapacity);
+		}
+
+		const size_t mask = slots.size() - 1;
+
+		size_t slot_i = hash & mask;
+		while (slots[slot_i].hash)
+		{
+			slot_i = (slot_i + 1) & mask;
+		}
+
+		cSlot& slot = slots[slot_i];
+		slot.hash = hash;
+		slot.lastSeen = time;
+		slot.key = key;
+		slot.value = value;
+		count++;
+
+		return true;
+	}
+
+	bool erase(const TKeyType& key)
+	{
+		if (!count)
+		{
+			return false;
+		}
+
+		const uint64_t hash = makeHash(key);
+		const size_t mask = slots.size() - 1;
+
+		for (size_t slot_i = hash & mask;; slot_i = (slot_i + 1) & mask)
+		{
+			const cSlot& slot = slots[slot_i];
+			if (!slot.hash)
+			{
+				return false;
+			}
+
+			if (slot.hash == hash &&
+			    slot.key == key)
+			{
+				eraseSlot(slot_i);
+				return true;
+			}
+		}
+	}
+
+	/** removes entries not seen for timeout milliseconds, returns removed count */
+	size_t age(const uint64_t timeout)
+	{
+		const uint64_t time = getTime();
+		size_t removed = 0;
+
+		size_t slot_i = 0;
+		while (slot_i < slots.size())
+		{
+			const cSlot& slot = slots[slot_i];
+			if (slot.hash &&
+			    time - slot.lastSeen >= timeout)
+			{
+				/** backward shift may move not checked entry to slot_i: check it again */
+				eraseSlot(slot_i);
+				removed++;
+				continue;
+			}
+
+			slot_i++;
+		}
+
+		return removed;
+	}
+
+	void streamPush(cStreamOut& stream) const
+	{
+		stream.push((uint32_t)count);
+		for (const cSlot& slot : slots)
+		{
+			if (slot.hash)
+			{
+				stream.push(slot.key);
+				stream.push(slot.value);
+			}
+		}
+	}
+
+	void streamPop(cStreamIn& stream)
+	{
+		clear();
+
+		uint32_t count;
+		stream.pop(count);
+		for (uint64_t i = 0; i < count && !stream.isFailed(); i++)
+		{
+			TKeyType key;
+			TValueType value;
+			stream.pop(key);
+			stream.pop(value);
+			insertOrUpdate(key, value);
+		}
+	}
+
+private:
+	class cSlot
+	{
+	public:
+		cSlot() :
+		        hash(0),
+		        lastSeen(0)
+		{
+		}
+
+	public:
+		uint64_t hash; ///< 0: empty slot
+		uint64_t lastSeen; ///< milliseconds, CLOCK_MONOTONIC_COARSE
+		TKeyType key;
+		TValueType value;
+	};
+
+	/** top bit is always set: 0 marks empty slot, low bits select home slot */
+	static uint64_t makeHash(const TKeyType& key)
+	{
+		return cHash<TKeyType>::hash(key) | (1ull << 63);
+	}
+
+	static uint64_t getTime()
+	{
+		struct timespec timespec;
+		clock_gettime(CLOCK_MONOTONIC_COARSE, &timespec);
+		return (uint64_t)timespec.tv_sec * 1000 + timespec.tv_nsec / 1000000;
+	}
+
+	void resize(const size_t capacity)
+	{
+		std::vector<cSlot> oldSlots(capacity);
+		oldSlots.swap(slots);
+
+		const size_t mask = slots.size() - 1;
+		for (cSlot& oldSlot : oldSlots)
+		{
+			if (!oldSlot.hash)
+			{
+				continue;
+			}
+
+			size_t slot_i = oldSlot.hash & mask;
+			while (slots[slot_i].hash)
+			{
+				slot_i = (slot_i + 1) & mask;
+			}
+
+			slots[slot_i] = std::move(oldSlot);
+		}
+	}
+
+	void eraseSlot(size_t slot_i)
+	{
+		const size_t mask = slots.size() - 1;
+
+		for (size_t next_i = (slot_i + 1) & mask;; next_i = (next_i + 1) & mask)
+		{
+			cSlot& next = slots[next_i];
+			if (!next.hash)
+			{
+				break;
+			}
+
+			/** move entry back if its home slot is not in (slot_i, next_i] */
+			const size_t home_i = next.hash & mask;
+			if (((next_i - home_i) & mask) >= ((next_i - slot_i) & mask))
+			{
+				slots[slot_i] = std::move(next);
+				slot_i = next_i;
+			}
+		}
+
+		slots[slot_i] = cSlot();
+		count--;
+	}
+
+	/** removes least recently seen entry from evictionScan entries after home slot of hash */
+	void evict(const uint64_t hash)
+	{
+		const size_t mask = slots.size() - 1;
+
+		size_t oldest_i = 0;
+		uint64_t oldestLastSeen = 0;
+		size_t scanned = 0;
+
+		for (size_t slot_i = hash & mask; scanned < evictionScan && scanned < count; slot_i = (slot_i + 1) & mask)
+		{
+			const cSlot& slot = slots[slot_i];
+			if (!slot.hash)
+			{
+				continue;
+			}
+
+			if (!scanned ||
+			    slot.lastSeen < oldestLastSeen)
+			{
+				oldest_i = slot_i;
+				oldestLastSeen = slot.lastSeen;
+			}
+
+			scanned++;
+		}
+
+		eraseSlot(oldest_i);
+	}
+
+private:
+	constexpr static size_t defaultLimit = 1024 * 1024;
+	constexpr static size_t minCapacity = 16;
+	constexpr static size_t evictionScan = 16;
+	constexpr static size_t loadNumerator = 3; ///< max load factor 3/4
+	constexpr static size_t loadDenominator = 4;
+
+	std::vector<cSlot> slots; ///< size is power of two
+	size_t count;
+	size_t limit;
+};
+
+template<typename TKeyType,
+         typename TValueType>
+class cLogicFlowTableInsert : public cLogicModule
+{
+	using tFlowTable = cFlowTable<TKeyType, TValueType>;
+
+public:
+	cLogicFlowTableInsert(const tMemoryTypeName& memoryKeyTypeName,
+	                      const tMemoryTypeName& memoryValueTypeName) :
+	        memoryKeyTypeName(memoryKeyTypeName),
+	        memoryValueTypeName(memoryValueTypeName)
+	{
+	}
+
+	cModule* clone() const override
+	{
+		return new cLogicFlowTableInsert(memoryKeyTypeName,
+		                                 memoryValueTypeName);
+	}
+
+	bool registerModule() override
+	{
+		tMemoryTypeName memoryTypeNameFlowTable = "flowTable<" + memoryKeyTypeName.value + "," + memoryValueTypeName.value + ">";
+
+		setModuleName("insert");
+		setCaptionName("insert");
+
+		if (!registerSignalEntry("signal", &cLogicFlowTableInsert::signalEntry))
+		{
+			return false;
+		}
+
+		if (!registerMemoryEntry("key", memoryKeyTypeName, key))
+		{
+			return false;
+		}
+
+		if (!registerMemoryEntry("value", memoryValueTypeName, value))
+		{
+			return false;
+		}
+
+		if (!registerSignalExit("done", signalExitDone))
+		{
+			return false;
+		}
+
+		if (!registerSignalExit("fail", signalExitFail))
+		{
+			return false;
+		}
+
+		if (!registerMemoryExit(memoryTypeNameFlowTable.value, memoryTypeNameFlowTable, flowTable))
+		{
+			return false;
+		}
+
+		return true;
+	}
+
+private: /** signalEntries */
+	bool signalEntry()
+	{
+		if (!flowTable || !key || !value)
+		{
+			return signalFlow(signalExitFail);
+		}
+
+		if (!flowTable->insertOrUpdate(*key, *value))
+		{
+			return signalFlow(signalExitFail);
+		}
+
+		return signalFlow(signalExitDone);
+	}
+
+private:
+	const tMemoryTypeName memoryKeyTypeName;
+	const tMemoryTypeName memoryValueTypeName;
+
+private:
+	const tSignalExitId signalExitDone = 1;
+	const tSignalExitId signalExitFail = 2;
+
+private:
+	TKeyType* key;
+	TValueType* value;
+	tFlowTable* flowTable;
+};
+
+template<typename TKeyType,
+         typename TValueType>
+class cLogicFlowTableLookup : public cLogicModule
+{
+	using tFlowTable = cFlowTable<TKeyType, TValueType>;
+
+public:
+	cLogicFlowTableLookup(const tMemoryTypeName& memoryKeyTypeName,
+	                      const tMemoryTypeName& memoryValueTypeName) :
+	        memoryKeyTypeName(memoryKeyTypeName),
+	        memoryValueTypeName(memoryValueTypeName)
+	{
+	}
+
+	cModule* clone() const override
+	{
+		return new cLogicFlowTableLookup(memoryKeyTypeName,
+		                                 memoryValueTypeName);
+	}
+
+	bool registerModule() override
+	{
+		tMemoryTypeName memoryTypeNameFlowTable = "flowTable<" + memoryKeyTypeName.value + "," + memoryValueTypeName.value + ">";
+
+		setModuleName("lookup");
+		setCaptionName("lookup");
+
+		if (!registerSignalEntry("signal", &cLogicFlowTableLookup::signalEntry))
+		{
+			return false;
+		}
+
+		if (!registerMemoryEntry(memoryTypeNameFlowTable.value, memoryTypeNameFlowTable, flowTable))
+		{
+			return false;
+		}
+
+		if (!registerMemoryEntry("key", memoryKeyTypeName, key))
+		{
+			return false;
+		}
+
+		if (!registerSignalExit("done", signalExitDone))
+		{
+			return false;
+		}
+
+		if (!registerSignalExit("fail", signalExitFail))
+		{
+			return false;
+		}
+
+		if (!registerMemoryExit("value", memoryValueTypeName, value))
+		{
+			return false;
+		}
+
+		return true;
+	}
+
+private: /** signalEntries */
+	bool signalEntry()
+	{
+		if (!flowTable || !key)
+		{
+			return signalFlow(signalExitFail);
+		}
+
+		const TValueType* found = flowTable->find(*key);
+		if (!found)
+		{
+			return signalFlow(signalExitFail);
+		}
+
+		if (value)
+		{
+			*value = *found;
+		}
+
+		return signalFlow(signalExitDone);
+	}
+
+private:
+	const tMemoryTypeName memoryKeyTypeName;
+	const tMemoryTypeName memoryValueTypeName;
+
+private:
+	const tSignalExitId signalExitDone = 1;
+	const tSignalExitId signalExitFail = 2;
+
+private:
+	tFlowTable* flowTable;
+	TKeyType* key;
+	TValueType* value;
+};
+
+template<typename TKeyType,
+         typename TValueType>
+class cLogicFlowTableDelete : public cLogicModule
+{
+	using tFlowTable = cFlowTable<TKeyType, TValueType>;
+
+public:
+	cLogicFlowTableDelete(const tMemoryTypeName& memoryKeyTypeName,
+	                      const tMemoryTypeName& memoryValueTypeName) :
+	        memoryKeyTypeName(memoryKeyTypeName),
+	        memoryValueTypeName(memoryValueTypeName)
+	{
+	}
+
+	cModule* clone() const override
+	{
+		return new cLogicFlowTableDelete(memoryKeyTypeName,
+		                                 memoryValueTypeName);
+	}
+
+	bool registerModule() override
+	{
+		tMemoryTypeName memoryTypeNameFlowTable = "flowTable<" + memoryKeyTypeName.value + "," + memoryValueTypeName.value + ">";
+
+		setModuleName("delete");
+		setCaptionName("delete");
+
+		if (!registerSignalEntry("signal", &cLogicFlowTableDelete::signalEntry))
+		{
+			return false;
+		}
+
+		if (!registerMemoryEntry("key", memoryKeyTypeName, key))
+		{
+			return false;
+		}
+
+		if (!registerSignalExit("done", signalExitDone))
+		{
+			return false;
+		}
+
+		if (!registerSignalExit("fail", signalExitFail))
+		{
+			return false;
+		}
+
+		if (!registerMemoryExit(memoryTypeNameFlowTable.value, memoryTypeNameFlowTable, flowTable))
+		{
+			return false;
+		}
+
+		return true;
+	}
+
+private: /** signalEntries */
+	bool signalEntry()
+	{
+		if (!flowTable || !key)
+		{
+			return signalFlow(signalExitFail);
+		}
+
+		if (!flowTable->erase(*key))
+		{
+			return signalFlow(signalExitFail);
+		}
+
+		return signalFlow(signalExitDone);
+	}
+
+private:
+	const tMemoryTypeName memoryKeyTypeName;
+	const tMemoryTypeName memoryValueTypeName;
+
+private:
+	const tSignalExitId signalExitDone = 1;
+	const tSignalExitId signalExitFail = 2;
+
+private:
+	TKeyType* key;
+	tFlowTable* flowTable;
+};
+
+/** connect timer to signal entry: removes entries idle for timeout milliseconds */
+template<typename TKeyType,
+         typename TValueType,
+         typename TIntegerType>
+class cLogicFlowTableAge : public cLogicModule
+{
+	using tFlowTable = cFlowTable<TKeyType, TValueType>;
+
+public:
+	cLogicFlowTableAge(const tMemoryTypeName& memoryKeyTypeName,
+	                   const tMemoryTypeName& memoryValueTypeName,
+	                   const tMemoryTypeName& memoryIntegerTypeName) :
+	        memoryKeyTypeName(memoryKeyTypeName),
+	        memoryValueTypeName(memoryValueTypeName),
+	        memoryIntegerTypeName(memoryIntegerTypeName)
+	{
+	}
+
+	cModule* clone() const override
+	{
+		return new cLogicFlowTableAge(memoryKeyTypeName,
+		                              memoryValueTypeName,
+		                              memoryIntegerTypeName);
+	}
+
+	bool registerModule() override
+	{
+		tMemoryTypeName memoryTypeNameFlowTable = "flowTable<" + memoryKeyTypeName.value + "," + memoryValueTypeName.value + ">";
+
+		setModuleName("age");
+		setCaptionName("age");
+
+		if (!registerSignalEntry("signal", &cLogicFlowTableAge::signalEntry))
+		{
+			return false;
+		}
+
+		if (!registerMemoryEntry("timeout", memoryIntegerTypeName, timeout))
+		{
+			return false;
+		}
+
+		if (!registerSignalExit("signal", signalExit))
+		{
+			return false;
+		}
+
+		if (!registerMemoryExit(memoryTypeNameFlowTable.value, memoryTypeNameFlowTable, flowTable))
+		{
+			return false;
+		}
+
+		if (!registerMemoryExit("removed", memoryIntegerTypeName, removed))
+		{
+			return false;
+		}
+
+		return true;
+	}
+
+private: /** signalEntries */
+	bool signalEntry()
+	{
+		if (flowTable && timeout && *timeout >= 0)
+		{
+			const size_t removedCount = flowTable->age(*timeout);
+			if (removed)
+			{
+				*removed = removedCount;
+			}
+		}
+		return signalFlow(signalExit);
+	}
+
+private:
+	const tMemoryTypeName memoryKeyTypeName;
+	const tMemoryTypeName memoryValueTypeName;
+	const tMemoryTypeName memoryIntegerTypeName;
+
+private:
+	const tSignalExitId signalExit = 1;
+
+private:
+	TIntegerType* timeout;
+	tFlowTable* flowTable;
+	TIntegerType* removed;
+};
+
+template<typename TKeyType,
+         typename TValueType,
+         typename TIntegerType>
+class cLogicFlowTableSetLimit : public cLogicModule
+{
+	using tFlowTable = cFlowTable<TKeyType, TValueType>;
+
+public:
+	cLogicFlowTableSetLimit(const tMemoryTypeName& memoryKeyTypeName,
+	                        const tMemoryTypeName& memoryValueTypeName,
+	                        const tMemoryTypeName& memoryIntegerTypeName) :
+	        memoryKeyTypeName(memoryKeyTypeName),
+	        memoryValueTypeName(memoryValueTypeName),
+	        memoryIntegerTypeName(memoryIntegerTypeName)
+	{
+	}
+
+	cModule* clone() const override
+	{
+		return new cLogicFlowTableSetLimit(memoryKeyTypeName,
+		                                   memoryValueTypeName,
+		                                   memoryIntegerTypeName);
+	}
+
+	bool registerModule() override
+	{
+		tMemoryTypeName memoryTypeNameFlowTable = "flowTable<" + memoryKeyTypeName.value + "," + memoryValueTypeName.value + ">";
+
+		setModuleName("setLimit");
+		setCaptionName("setLimit");
+
+		if (!registerSignalEntry("signal", &cLogicFlowTableSetLimit::signalEntry))
+		{
+			return false;
+		}
+
+		if (!registerMemoryEntry("limit", memoryIntegerTypeName, limit))
+		{
+			return false;
+		}
+
+		if (!registerSignalExit("signal", signalExit))
+		{
+			return false;
+		}
+
+		if (!registerMemoryExit(memoryTypeNameFlowTable.value, memoryTypeNameFlowTable, flowTable))
+		{
+			return false;
+		}
+
+		return true;
+	}
+
+private: /** signalEntries */
+	bool signalEntry()
+	{
+		if (flowTable && limit && *limit >= 0)
+		{
+			flowTable->setLimit(*limit);
+		}
+		return signalFlow(signalExit);
+	}
+
+private:
+	const tMemoryTypeName memoryKeyTypeName;
+	const tMemoryTypeName memoryValueTypeName;
+	const tMemoryTypeName memoryIntegerTypeName;
+
+private:
+	const tSignalExitId signalExit = 1;
+
+private:
+	TIntegerType* limit;
+	tFlowTable* flowTable;
+};
+
+}
+
+#endif // TVM_FLOWTABLE_H
@@ -0,0 +1,166 @@
+// Copyright © 2017, Timur Aitov. Contacts: timonbl4@gmail.com. All rights reserved
+
+#ifndef TVM_HASH_H
+#define TVM_HASH_H
+
+#include <vector>
+#include <array>
+#include <tuple>
+#include <string>
+#include <functional>
+#include <type_traits>
+
+#include <string.h>
+
+namespace nVirtualMachine
+{
+
+/** 64 bit key hash: fixed size keys are hashed as raw bytes, tuples element by element (skips padding).
+ *  strings and c strings have equal hashes (heterogeneous lookup) */
+template<typename TType,
+         typename = void>
+class cHash
+{
+public:
+	static uint64_t hash(const TType& value)
+	{
+		return std::hash<TType>()(value);
+	}
+};
+
+class cHashBytes
+{
+public:
+	static uint64_t mix(uint64_t value)
+	{
+		value ^= value >> 33;
+		value *= 0xff51afd7ed558ccdull;
+		value ^= value >> 33;
+		value *= 0xc4ceb9fe1a85ec53ull;
+		value ^= value >> 33;
+		return value;
+	}
+
+	static uint64_t hash(const void* data,
+	                     size_t size,
+	                     uint64_t seed = 0)
+	{
+		const uint8_t* bytes = (const uint8_t*)data;
+		uint64_t result = seed ^ (size * prime);
+
+		while (size >= sizeof(uint64_t))
+		{
+			uint64_t word;
+			memcpy(&word, bytes, sizeof(word));
+			result = (result ^ mix(word)) * prime;
+			bytes += sizeof(word);
+			size -= sizeof(word);
+		}
+
+		if (size)
+		{
+			uint64_t word = 0;
+			memcpy(&word, bytes, size);
+			result = (result ^ mix(word)) * prime;
+		}
+
+		return mix(result);
+	}
+
+private:
+	constexpr static uint64_t prime = 0x9e3779b97f4a7c15ull;
+};
+
+template<typename TType>
+class cHash<TType,
+                typename std::enable_if<std::is_arithmetic<TType>::value ||
+                                        std::is_enum<TType>::value>::type>
+{
+public:
+	static uint64_t hash(const TType& value)
+	{
+		return cHashBytes::hash(&value, sizeof(value));
+	}
+};
+
+template<typename TType,
+         std::size_t TSize>
+class cHash<std::array<TType, TSize>,
+                typename std::enable_if<std::is_arithmetic<TType>::value>::type>
+{
+public:
+	static uint64_t hash(const std::array<TType, TSize>& value)
+	{
+		return cHashBytes::hash(value.data(), sizeof(TType) * TSize);
+	}
+};
+
+template<typename TType>
+class cHash<std::vector<TType>,
+                typename std::enable_if<std::is_arithmetic<TType>::value>::type>
+{
+public:
+	static uint64_t hash(const std::vector<TType>& value)
+	{
+		return cHashBytes::hash(value.data(), sizeof(TType) * value.size());
+	}
+};
+
+template<>
+class cHash<std::string>
+{
+public:
+	static uint64_t hash(const std::string& value)
+	{
+		return cHashBytes::hash(value.data(), value.size());
+	}
+};
+
+template<>
+class cHash<const char*>
+{
+public:
+	static uint64_t hash(const char* value)
+	{
+		return cHashBytes::hash(value, strlen(value));
+	}
+};
+
+template<>
+class cHash<char*> : public cHash<const char*>
+{
+};
+
+template<typename ... TArgs>
+class cHash<std::tuple<TArgs ...>>
+{
+public:
+	static uint64_t hash(const std::tuple<TArgs ...>& value)
+	{
+		return hashTuple<0>(value, 0);
+	}
+
+private:
+	template<size_t TTupleIndex>
+	static typename std::enable_if<TTupleIndex == sizeof...(TArgs), uint64_t>::type
+	hashTuple(const std::tuple<TArgs ...>& value,
+	          uint64_t seed)
+	{
+		return seed;
+	}
+
+	template<size_t TTupleIndex>
+	static typename std::enable_if<TTupleIndex < sizeof...(TArgs), uint64_t>::type
+	hashTuple(const std::tuple<TArgs ...>& value,
+	          uint64_t seed)
+	{
+		using tType = typename std::tuple_element<TTupleIndex, std::tuple<TArgs ...>>::type;
+
+		uint64_t elementHash = cHash<tType>::hash(std::get<TTupleIndex>(value));
+		return hashTuple<TTupleIndex + 1>(value, cHashBytes::hash(&elementHash, sizeof(elementHash), seed));
+	}
+};
+
+}
+
+#endif // TVM_HASH_H
@@ -0,0 +1,505 @@
+// Copyright © 2017, Timur Aitov. Contacts: timonbl4@gmail.com. All rights reserved
+
+#ifndef TVM_HASHMAP_H
+#define TVM_HASHMAP_H
+
+#include <vector>
+#include <utility>
+#include <iterator>
+#include <type_traits>
+
+#include "logic.h"
+#include "stream.h"
+#include "hash.h"
+
+namespace nVirtualMachine
+{
+
+/** unordered map: open addressing (linear probing, backward shift deletion).
+ *  hashes are kept apart from entries: probing reads one cache line per 8 slots, keys are compared on equal hash only.
+ *  find() accepts any key type with equal cHash and operator== (std::string key, const char* lookup) */
+template<typename TKeyType,
+         typename TValueType>
+class cHashMap
+{
+public:
+	using key_type = TKeyType;
+	using mapped_type = TValueType;
+	using value_type = std::pair<TKeyType, TValueType>;
+
+	/** position is slot index of one layout: after rehash or erase (entries move) iterator is equal to end() */
+	template<typename TMapType,
+	         typename TEntryType>
+	class cIterator
+	{
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = std::pair<TKeyType, TValueType>;
+		using difference_type = std::ptrdiff_t;
+		using pointer = TEntryType*;
+		using reference = TEntryType&;
+
+	public:
+		cIterator() :
+		        map(nullptr),
+		        slot_i(0),
+		        generation(0)
+		{
+		}
+
+		cIterator(TMapType* map,
+		          size_t slot_i) :
+		        map(map),
+		        slot_i(slot_i),
+		        generation(map->generation)
+		{
+		}
+
+		/** iterator to const_iterator */
+		template<typename TOtherMapType,
+		         typename TOtherEntryType>
+		cIterator(const cIterator<TOtherMapType, TOtherEntryType>& second) :
+		        map(second.map),
+		        slot_i(second.slot_i),
+		        generation(second.generation)
+		{
+		}
+
+		reference operator*() const
+		{
+			return map->entries[slot_i];
+		}
+
+		pointer operator->() const
+		{
+			return &map->entries[slot_i];
+		}
+
+		cIterator& operator++()
+		{
+			slot_i = map->nextSlot(position() + 1);
+			return *this;
+		}
+
+		cIterator operator++(int)
+		{
+			cIterator iter = *this;
+			++(*this);
+			return iter;
+		}
+
+		bool operator==(const cIterator& second) const
+		{
+			return position() == second.position();
+		}
+
+		bool operator!=(const cIterator& second) const
+		{
+			return position() != second.position();
+		}
+
+	private:
+		size_t position() const
+		{
+			if (map &&
+			    map->generation != generation)
+			{
+				return map->hashes.size();
+			}
+			return slot_i;
+		}
+
+	private:
+		template<typename, typename>
+		friend class cIterator;
+
+		TMapType* map;
+		size_t slot_i;
+		uint64_t generation;
+	};
+
+	using iterator = cIterator<cHashMap, value_type>;
+	using const_iterator = cIterator<const cHashMap, const value_type>;
+
+	friend class cLogicMapCursor<cHashMap>;
+
+public:
+	cHashMap()
+	{
+		entriesCount = 0;
+		generation = 0;
+	}
+
+	cHashMap(const cHashMap& second) :
+	        hashes(second.hashes),
+	        entries(second.entries),
+	        entriesCount(second.entriesCount),
+	        generation(0)
+	{
+	}
+
+	cHashMap(cHashMap&& second) :
+	        hashes(std::move(second.hashes)),
+	        entries(std::move(second.entries)),
+	        entriesCount(second.entriesCount),
+	        generation(0)
+	{
+		second.clear();
+	}
+
+	/** iterators of this map become equal to end() */
+	cHashMap& operator=(const cHashMap& second)
+	{
+		hashes = second.hashes;
+		entries = second.entries;
+		entriesCount = second.entriesCount;
+		generation++;
+		return *this;
+	}
+
+	cHashMap& operator=(cHashMap&& second)
+	{
+		hashes = std::move(second.hashes);
+		entries = std::move(second.entries);
+		entriesCount = second.entriesCount;
+		generation++;
+		second.clear();
+		return *this;
+	}
+
+	/** changed on every move of entries (rehash, erase, clear): iterators and slots of older generation are not valid */
+	uint64_t getGeneration() const
+	{
+		return generation;
+	}
+
+	size_t size() const
+	{
+		return entriesCount;
+	}
+
+	bool empty() const
+	{
+		return !entriesCount;
+	}
+
+	void clear()
+	{
+		hashes.clear();
+		entries.clear();
+		entriesCount = 0;
+		generation++;
+	}
+
+	/** allocates slots for count entries without rehash */
+	void reserve(const size_t count)
+	{
+		size_t capacity = minCapacity;
+		while (count * loadDenominator > capacity * loadNumerator)
+		{
+			capacity <<= 1;
+		}
+
+		if (capacity > hashes.size())
+		{
+			resize(capacity);
+		}
+	}
+
+	iterator begin()
+	{
+		return iterator(this, nextSlot(0));
+	}
+
+	iterator end()
+	{
+		return iterator(this, hashes.size());
+	}
+
+	const_iterator begin() const
+	{
+		return const_iterator(this, nextSlot(0));
+	}
+
+	const_iterator end() const
+	{
+		return const_iterator(this, hashes.size());
+	}
+
+	template<typename TLookupKeyType>
+	iterator find(const TLookupKeyType& key)
+	{
+		return iterator(this, findSlot(key));
+	}
+
+	template<typename TLookupKeyType>
+	const_iterator find(const TLookupKeyType& key) const
+	{
+		return const_iterator(this, findSlot(key));
+	}
+
+	template<typename TLookupKeyType>
+	size_t count(const TLookupKeyType& key) const
+	{
+		return findSlot(key) != hashes.size();
+	}
+
+	TValueType& operator[](const TKeyType& key)
+	{
+		const uint64_t hash = makeHash(key);
+
+		size_t slot_i = findSlot(key, hash);
+		if (slot_i != hashes.size())
+		{
+			return entries[slot_i].second;
+		}
+
+		if ((entriesCount + 1) * loadDenominator > hashes.size() * loadNumerator)
+		{
+			resize(hashes.size() ? hashes.size() * 2 : minCapacity);
+		}
+
+		const size_t mask = hashes.size() - 1;
+
+		slot_i = hash & mask;
+		while (hashes[slot_i])
+		{
+			slot_i = (slot_i + 1) & mask;
+		}
+
+		hashes[slot_i] = hash;
+		entries[slot_i].first = key;
+		entriesCount++;
+
+		return entries[slot_i].second;
+	}
+
+	template<typename TLookupKeyType>
+	size_t erase(const TLookupKeyType& key)
+	{
+		const size_t slot_i = findSlot(key);
+		if (slot_i == hashes.size())
+		{
+			return 0;
+		}
+
+		eraseSlot(slot_i);
+		return 1;
+	}
+
+	void streamPush(cStreamOut& stream) const
+	{
+		stream.push((uint32_t)entriesCount);
+		for (const auto& entry : *this)
+		{
+			stream.push(entry.first);
+			stream.push(entry.second);
+		}
+	}
+
+	void streamPop(cStreamIn& stream)
+	{
+		clear();
+
+		uint32_t count;
+		stream.pop(count);
+		for (uint64_t i = 0; i < count && !stream.isFailed(); i++)
+		{
+			TKeyType key;
+			stream.pop(key);
+			stream.pop((*this)[key]);
+		}
+	}
+
+private:
+	/** top bit is always set: 0 marks empty slot, low bits select home slot */
+	template<typename TLookupKeyType>
+	static uint64_t makeHash(const TLookupKeyType& key)
+	{
+		return cHash<typename std::decay<TLookupKeyType>::type>::hash(key) | (1ull << 63);
+	}
+
+	template<typename TLookupKeyType>
+	size_t findSlot(const TLookupKeyType& key) const
+	{
+		if (!entriesCount)
+		{
+			return hashes.size();
+		}
+
+		return findSlot(key, makeHash(key));
+	}
+
+	/** returns hashes.size() if not found */
+	template<typename TLookupKeyType>
+	size_t findSlot(const TLookupKeyType& key,
+	                const uint64_t hash) const
+	{
+		if (!entriesCount)
+		{
+			return hashes.size();
+		}
+
+		const size_t mask = hashes.size() - 1;
+
+		for (size_t slot_i = hash & mask;; slot_i = (slot_i + 1) & mask)
+		{
+			if (!hashes[slot_i])
+			{
+				return hashes.size();
+			}
+
+			if (hashes[slot_i] == hash &&
+			    entries[slot_i].first == key)
+			{
+				return slot_i;
+			}
+		}
+	}
+
+	size_t nextSlot(size_t slot_i) const
+	{
+		while (slot_i < hashes.size() &&
+		       !hashes[slot_i])
+		{
+			slot_i++;
+		}
+		return slot_i;
+	}
+
+	void resize(const size_t capacity)
+	{
+		generation++;
+
+		std::vector<uint64_t> oldHashes(capacity, 0);
+		std::vector<value_type> oldEntries(capacity);
+		oldHashes.swap(hashes);
+		oldEntries.swap(entries);
+
+		const size_t mask = hashes.size() - 1;
+		for (size_t old_i = 0; old_i < oldHashes.size(); old_i++)
+		{
+			if (!oldHashes[old_i])
+			{
+				continue;
+			}
+
+			size_t slot_i = oldHashes[old_i] & mask;
+			while (hashes[slot_i])
+			{
+				slot_i = (slot_i + 1) & mask;
+			}
+
+			hashes[slot_i] = oldHashes[old_i];
+			entries[slot_i] = std::move(oldEntries[old_i]);
+		}
+	}
+
+	void eraseSlot(size_t slot_i)
+	{
+		generation++;
+
+		const size_t mask = hashes.size() - 1;
+
+		for (size_t next_i = (slot_i + 1) & mask;; next_i = (next_i + 1) & mask)
+		{
+			if (!hashes[next_i])
+			{
+				break;
+			}
+
+			/** move entry back if its home slot is not in (slot_i, next_i] */
+			const size_t home_i = hashes[next_i] & mask;
+			if (((next_i - home_i) & mask) >= ((next_i - slot_i) & mask))
+			{
+				hashes[slot_i] = hashes[next_i];
+				entries[slot_i] = std::move(entries[next_i]);
+				slot_i = next_i;
+			}
+		}
+
+		hashes[slot_i] = 0;
+		entries[slot_i] = value_type();
+		entriesCount--;
+	}
+
+private:
+	constexpr static size_t minCapacity = 16;
+	constexpr static size_t loadNumerator = 3; ///< max load factor 3/4
+	constexpr static size_t loadDenominator = 4;
+
+	std::vector<uint64_t> hashes; ///< size is power of two, 0: empty slot
+	std::vector<value_type> entries;
+	size_t entriesCount;
+	uint64_t generation;
+};
+
+/** forEach visits keys of begin(), each once: entries are read by slot while layout is the same, by key after rehash or erase.
+ *  entries inserted during iteration are not visited, erased are skipped */
+template<typename TKeyType,
+         typename TValueType>
+class cLogicMapCursor<cHashMap<TKeyType, TValueType>>
+{
+	using tMap = cHashMap<TKeyType, TValueType>;
+
+public:
+	void begin(const tMap& map)
+	{
+		slots.clear();
+		keys.clear();
+		slots.reserve(map.size());
+		keys.reserve(map.size());
+
+		for (size_t slot_i = map.nextSlot(0); slot_i < map.hashes.size(); slot_i = map.nextSlot(slot_i + 1))
+		{
+			slots.push_back(slot_i);
+			keys.push_back(map.entries[slot_i].first);
+		}
+
+		generation = map.getGeneration();
+		position = 0;
+	}
+
+	const typename tMap::value_type* next(const tMap& map)
+	{
+		while (position < keys.size())
+		{
+			const size_t key_i = position++;
+
+			if (map.getGeneration() == generation)
+			{
+				return &map.entries[slots[key_i]];
+			}
+
+			auto iter = map.find(keys[key_i]);
+			if (iter != map.end())
+			{
+				return &*iter;
+			}
+		}
+
+		return nullptr;
+	}
+
+private:
+	std::vector<size_t> slots;
+	std::vector<TKeyType> keys;
+	uint64_t generation;
+	size_t position;
+};
+
+template<typename TKeyType,
+         typename TValueType>
+class cLogicMapTypeName<cHashMap<TKeyType, TValueType>>
+{
+public:
+	static tMemoryTypeName get(const tMemoryTypeName& memoryKeyTypeName,
+	                           const tMemoryTypeName& memoryValueTypeName)
+	{
+		return "hashMap<" + memoryKeyTypeName.value + "," + memoryValueTypeName.value + ">";
+	}
+};
+
+}
+
+#endif // TVM_HASHMAP_H
@@ -60,6 +60,21 @@ protected:
 	bool registerMemoryMap(const tMemoryTypeName& memoryKeyTypeName,
 	                       const tMemoryTypeName& memoryValueTypeName);
 
+	template<typename TKeyType,
+	         typename TValueType>
+	bool registerMemoryHashMap(const tMemoryTypeName& memoryKeyTypeName,
+	                           const tMemoryTypeName& memoryValueTypeName);
+
+	template<typename TKeyType,
+	         typename TValueType>
+	bool registerMemoryFlatMap(const tMemoryTypeName& memoryKeyTypeName,
+	                           const tMemoryTypeName& memoryValueTypeName);
+
+	template<typename TKeyType,
+	         typename TValueType>
+	bool registerMemoryFlowTable(const tMemoryTypeName& memoryKeyTypeName,
+	                             const tMemoryTypeName& memoryValueTypeName);
+
 	template<typename TTuple>
 	bool registerMemoryTuple(tMemoryTypeName memoryTypeNameTuple,
 	                         const std::vector<std::pair<tMemoryName, tMemoryTypeName>>& memories);
@@ -122,6 +137,18 @@ protected: /** exec */
 	template<typename TType>
 	inline void rootSetMemory(tRootMemoryExitId rootMemoryExitId, const TType& value);
 
+	/** callback is executed under virtual machine lock: modules are not unloaded while it runs */
+	template<typename TCallback>
+	inline void rootExecute(const TCallback& callback);
+
+	/** inside rootExecute() callback */
+	inline void rootSignalFlowLocked(tRootSignalExitId rootSignalExitId);
+
+	template<typename TType>
+	inline void rootSetMemoryLocked(tRootMemoryExitId rootMemoryExitId, const TType& value);
+
+	inline bool rootIsMemoryConnectedLocked(tRootMemoryExitId rootMemoryExitId) const;
+
 	inline bool isStopped() const;
 
 private:
@@ -34,6 +34,12 @@ public:
 	using tString = std::string;
 	using tFloat = double;
 
+	using tCowString = cCow<tString>;
+	const tMemoryTypeName memoryCowStringTypeName = "cowString";
+
+	using tCowBuffer = cCow<tBuffer>;
+	const tMemoryTypeName memoryCowBufferTypeName = "cowBuffer";
+
 public:
 	cBase()
 	{
@@ -178,19 +184,19 @@ public:
 		}
 
 		if (!registerMemoryModule("string",
-		                          new cLogicStringStartWith()))
+		                          new cLogicStringStartWith<tString>("string")))
 		{
 			return false;
 		}
 
 		if (!registerMemoryModule("string",
-		                          new cLogicStringSubString()))
+		                          new cLogicStringSubString<tString>("string")))
 		{
 			return false;
 		}
 
 		if (!registerMemoryModule("string",
-		                          new cLogicStringFindString()))
+		                          new cLogicStringFindString<tString>("string")))
 		{
 			return false;
 		}
@@ -250,6 +256,175 @@ public:
 			return false;
 		}
 
+		if (!registerMemoryVector<tBuffer>(memoryBufferTypeName))
+		{
+			return false;
+		}
+
+		/** cowString: copy is O(1), string modules as for string */
+		if (!registerMemoryStandart<tCowString>(memoryCowStringTypeName))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryCowStringTypeName,
+		                          new cLogicIsEmpty<tCowString,
+		                                            tBoolean>(memoryCowStringTypeName,
+		                                                      memoryBooleanTypeName)))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryCowStringTypeName,
+		                          new cLogicAppend<tCowString>(memoryCowStringTypeName)))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryCowStringTypeName,
+		                          new cLogicSetClear<tCowString>(memoryCowStringTypeName)))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryCowStringTypeName,
+		                          new cLogicSize<tCowString,
+		                                         tInteger>("getLength",
+		                                                   memoryCowStringTypeName,
+		                                                   memoryIntegerTypeName)))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryCowStringTypeName,
+		                          new cLogicStringStartWith<tCowString>(memoryCowStringTypeName)))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryCowStringTypeName,
+		                          new cLogicStringSubString<tCowString>(memoryCowStringTypeName)))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryCowStringTypeName,
+		                          new cLogicStringFindString<tCowString>(memoryCowStringTypeName)))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryCowStringTypeName,
+		                          new cLogicConvert<tCowString,
+		                                            tString>("toString",
+		                                                     memoryCowStringTypeName,
+		                                                     "string",
+			[](tCowString* from, tString* to)
+			{
+				*to = from->get();
+			})))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryCowStringTypeName,
+		                          new cLogicConvert<tString,
+		                                            tCowString>("fromString",
+		                                                        "string",
+		                                                        memoryCowStringTypeName,
+			[](tString* from, tCowString* to)
+			{
+				*to = tCowString(*from);
+			})))
+		{
+			return false;
+		}
+
+		/** cowBuffer: copy is O(1), toBuffer and fromBuffer copy bytes as is */
+		if (!registerMemory<tCowBuffer>(memoryCowBufferTypeName))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryCowBufferTypeName,
+		                          new cLogicCopy<tCowBuffer>(memoryCowBufferTypeName)))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryCowBufferTypeName,
+		                          new cLogicIfEqual<tCowBuffer,
+		                                            tBoolean>(memoryCowBufferTypeName,
+		                                                      memoryBooleanTypeName)))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryCowBufferTypeName,
+		                          new cLogicIsEmpty<tCowBuffer,
+		                                            tBoolean>(memoryCowBufferTypeName,
+		                                                      memoryBooleanTypeName)))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryCowBufferTypeName,
+		                          new cLogicAppend<tCowBuffer>(memoryCowBufferTypeName)))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryCowBufferTypeName,
+		                          new cLogicSetClear<tCowBuffer>(memoryCowBufferTypeName)))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryCowBufferTypeName,
+		                          new cLogicSize<tCowBuffer,
+		                                         tInteger>("getSize",
+		                                                   memoryCowBufferTypeName,
+		                                                   memoryIntegerTypeName)))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryCowBufferTypeName,
+		                          new cLogicConvert<tCowBuffer,
+		                                            tBuffer>("toBuffer",
+		                                                     memoryCowBufferTypeName,
+		                                                     memoryBufferTypeName,
+			[](tCowBuffer* from, tBuffer* to)
+			{
+				if (from->empty())
+				{
+					to->clear();
+					return;
+				}
+				*to = from->get();
+			})))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryCowBufferTypeName,
+		                          new cLogicConvert<tBuffer,
+		                                            tCowBuffer>("fromBuffer",
+		                                                        memoryBufferTypeName,
+		                                                        memoryCowBufferTypeName,
+			[](tBuffer* from, tCowBuffer* to)
+			{
+				*to = tCowBuffer(*from);
+			})))
+		{
+			return false;
+		}
+
+		if (!registerMemoryVector<tInteger>(memoryIntegerTypeName))
+		{
+			return false;
+		}
+
 		if (!registerMemoryModule(memoryIntegerTypeName,
 		                          new cLogicConvert<tInteger,
 		                                            tString>("toString",
@@ -288,6 +463,11 @@ public:
 			return false;
 		}
 
+		if (!registerMemoryVector<tFloat>("float"))
+		{
+			return false;
+		}
+
 		if (!registerMemoryModule("float",
 		                          new cLogicConvert<tFloat,
 		                                            tString>("toString",
@@ -619,12 +799,18 @@ private: /** modules */
 		tBoolean* to;
 	};
 
+	template<typename TString>
 	class cLogicStringStartWith : public cLogicModule
 	{
 	public:
+		cLogicStringStartWith(const tMemoryTypeName& memoryTypeName) :
+		        memoryTypeName(memoryTypeName)
+		{
+		}
+
 		cModule* clone() const override
 		{
-			return new cLogicStringStartWith();
+			return new cLogicStringStartWith(memoryTypeName);
 		}
 
 		bool registerModule() override
@@ -637,12 +823,12 @@ private: /** modules */
 				return false;
 			}
 
-			if (!registerMemoryEntry("string", "string", string))
+			if (!registerMemoryEntry("string", memoryTypeName, string))
 			{
 				return false;
 			}
 
-			if (!registerMemoryEntry("startWith", "string", startWith))
+			if (!registerMemoryEntry("startWith", memoryTypeName, startWith))
 			{
 				return false;
 			}
@@ -665,7 +851,8 @@ private: /** modules */
 		{
 			if (string && startWith)
 			{
-				if (string->substr(0, startWith->size()) == *startWith)
+				if (string->size() >= startWith->size() &&
+				    std::equal(startWith->begin(), startWith->end(), string->begin()))
 				{
 					return signalFlow(signalExitTrue);
 				}
@@ -673,21 +860,30 @@ private: /** modules */
 			return signalFlow(signalExitFalse);
 		}
 
+	private:
+		const tMemoryTypeName memoryTypeName;
+
 	private:
 		const tSignalExitId signalExitTrue = 1;
 		const tSignalExitId signalExitFalse = 2;
 
 	private:
-		tString* string;
-		tString* startWith;
+		TString* string;
+		TString* startWith;
 	};
 
+	template<typename TString>
 	class cLogicStringSubString : public cLogicModule
 	{
 	public:
+		cLogicStringSubString(const tMemoryTypeName& memoryTypeName) :
+		        memoryTypeName(memoryTypeName)
+		{
+		}
+
 		cModule* clone() const override
 		{
-			return new cLogicStringSubString();
+			return new cLogicStringSubString(memoryTypeName);
 		}
 
 		bool registerModule() override
@@ -700,7 +896,7 @@ private: /** modules */
 				return false;
 			}
 
-			if (!registerMemoryEntry("string", "string", string))
+			if (!registerMemoryEntry("string", memoryTypeName, string))
 			{
 				return false;
 			}
@@ -720,7 +916,7 @@ private: /** modules */
 				return false;
 			}
 
-			if (!registerMemoryExit("subString", "string", subString))
+			if (!registerMemoryExit("subString", memoryTypeName, subString))
 			{
 				return false;
 			}
@@ -753,22 +949,31 @@ private: /** modules */
 			return signalFlow(signalExit);
 		}
 
+	private:
+		const tMemoryTypeName memoryTypeName;
+
 	private:
 		const tSignalExitId signalExit = 1;
 
 	private:
-		tString* string;
+		TString* string;
 		tInteger* start;
 		tInteger* count;
-		tString* subString;
+		TString* subString;
 	};
 
+	template<typename TString>
 	class cLogicStringFindString : public cLogicModule
 	{
 	public:
+		cLogicStringFindString(const tMemoryTypeName& memoryTypeName) :
+		        memoryTypeName(memoryTypeName)
+		{
+		}
+
 		cModule* clone() const override
 		{
-			return new cLogicStringFindString();
+			return new cLogicStringFindString(memoryTypeName);
 		}
 
 		bool registerModule() override
@@ -781,12 +986,12 @@ private: /** modules */
 				return false;
 			}
 
-			if (!registerMemoryEntry("string", "string", string))
+			if (!registerMemoryEntry("string", memoryTypeName, string))
 			{
 				return false;
 			}
 
-			if (!registerMemoryEntry("subString", "string", subString))
+			if (!registerMemoryEntry("subString", memoryTypeName, subString))
 			{
 				return false;
 			}
@@ -815,7 +1020,7 @@ private: /** modules */
 			if (string && subString)
 			{
 				size_t tposition = string->find(*subString);
-				if (tposition != tString::npos)
+				if (tposition != TString::npos)
 				{
 					if (position)
 					{
@@ -828,13 +1033,16 @@ private: /** modules */
 			return signalFlow(signalExitFail);
 		}
 
+	private:
+		const tMemoryTypeName memoryTypeName;
+
 	private:
 		const tSignalExitId signalExitDone = 1;
 		const tSignalExitId signalExitFail = 2;
 
 	private:
-		tString* string;
-		tString* subString;
+		TString* string;
+		TString* subString;
 		tInteger* position;
 	};
 
@@ -925,6 +1133,7 @@ private: /** modules */
 		bool registerModule() override
 		{
 			setModuleName("true");
+			setPure();
 
 			if (!registerSignalEntry("signal", &cLogicTrue::signalEntry))
 			{
@@ -952,6 +1161,7 @@ private: /** modules */
 		bool registerModule() override
 		{
 			setModuleName("false");
+			setPure();
 
 			if (!registerSignalEntry("signal", &cLogicFalse::signalEntry))
 			{
@@ -4,9 +4,19 @@
 #define TVM_LIBRARY_CONSOLE_H
 
 #include <vector>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
 
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/uio.h>
 
 #include <tvm/library.h>
 
@@ -19,30 +29,280 @@ namespace nLibrary
 class cConsole : public cLibrary
 {
 public:
-	cConsole()
+	/** async: modules append to ring buffer, library thread writes it to stdout every flushInterval milliseconds */
+	cConsole(const bool async = false,
+	         const unsigned int flushInterval = 100,
+	         const size_t bufferSize = 1024 * 1024) :
+	        async(async),
+	        flushInterval(std::max(flushInterval, 1u))
 	{
+		size_t ringSize = 4096;
+		while (ringSize < bufferSize)
+		{
+			ringSize <<= 1;
+		}
+
+		if (async)
+		{
+			ring.resize(ringSize);
+		}
+
+		ringHead = 0;
+		ringTail = 0;
+		writerRunning = false;
+		wakeupRequested = false;
+		wakeupEventFd = -1;
+	}
+
+	~cConsole()
+	{
+		if (async)
+		{
+			flush();
+		}
+
+		if (wakeupEventFd != -1)
+		{
+			close(wakeupEventFd);
+		}
 	}
 
 	bool registerLibrary() override
 	{
 		setLibraryName("console");
 
-		if (!registerModules(new cLogicPrint(),
-		                     new cLogicPrintLine()))
+		if (!registerModules(new cLogicPrint(this),
+		                     new cLogicPrintLine(this)))
+		{
+			return false;
+		}
+
+		return true;
+	}
+
+	bool init() override
+	{
+		if (!async)
+		{
+			return true;
+		}
+
+		wakeupEventFd = eventfd(0, EFD_NONBLOCK);
+		if (wakeupEventFd < 0)
 		{
+			wakeupEventFd = -1;
 			return false;
 		}
 
+		/** do not reorder with output already buffered by std::cout */
+		std::cout << std::flush;
+
 		return true;
 	}
 
+	void run() override
+	{
+		if (!async)
+		{
+			return;
+		}
+
+		struct pollfd pollFd;
+		pollFd.fd = wakeupEventFd;
+		pollFd.events = POLLIN;
+
+		writerRunning = true;
+
+		while (!isStopped())
+		{
+			pollFd.revents = 0;
+			if (poll(&pollFd, 1, flushInterval) > 0)
+			{
+				uint64_t value;
+				if (read(wakeupEventFd, &value, sizeof(value)) < 0)
+				{
+					/** EAGAIN: counter is already reset. ring is flushed below in any case */
+				}
+			}
+
+			wakeupRequested = false;
+			flush();
+		}
+
+		writerRunning = false;
+		flush();
+	}
+
+	void stop() override
+	{
+		if (wakeupEventFd != -1)
+		{
+			uint64_t value = 1;
+			if (write(wakeupEventFd, &value, sizeof(value)) < 0)
+			{
+				/** EAGAIN: counter is not read yet, writer is woken anyway */
+			}
+		}
+	}
+
+private:
+	void print(const std::string* string,
+	           const bool newLine)
+	{
+		if (!async)
+		{
+			if (string)
+			{
+				std::cout << *string;
+			}
+			if (newLine)
+			{
+				std::cout << std::endl;
+			}
+			std::cout << std::flush;
+			return;
+		}
+
+		/** modules run under virtual machine lock and are rejected by parallelForEach,
+		 *  pushMutex keeps ring correct for any other producer and keeps line together */
+		std::lock_guard<std::mutex> guard(pushMutex);
+
+		if (string)
+		{
+			push(string->data(), string->size());
+		}
+		if (newLine)
+		{
+			push("\n", 1);
+		}
+
+		/** wake writer before ring is full */
+		if (ringHead.load(std::memory_order_relaxed) - ringTail.load(std::memory_order_relaxed) > ring.size() / 2)
+		{
+			wakeup();
+		}
+	}
+
+	void wakeup()
+	{
+		if (wakeupEventFd != -1 &&
+		    !wakeupRequested.exchange(true))
+		{
+			uint64_t value = 1;
+			if (write(wakeupEventFd, &value, sizeof(value)) < 0)
+			{
+				/** EAGAIN: counter is not read yet, writer is woken anyway */
+			}
+		}
+	}
+
+	/** pushMutex must be locked */
+	void push(const char* data,
+	          size_t length)
+	{
+		while (length)
+		{
+			const size_t head = ringHead.load(std::memory_order_relaxed);
+			const size_t tail = ringTail.load(std::memory_order_acquire);
+
+			const size_t freeSize = ring.size() - (head - tail);
+			if (!freeSize)
+			{
+				if (!writerRunning)
+				{
+					/** before run() or after stop: write it out in this thread */
+					flush();
+					continue;
+				}
+
+				/** stdout is written only by writer thread: wait for free space */
+				wakeup();
+
+				std::unique_lock<std::mutex> lock(flushMutex);
+				spaceCondition.wait_for(lock, std::chrono::milliseconds(flushInterval), [&]()
+				{
+					return ringTail.load(std::memory_order_relaxed) != tail;
+				});
+				continue;
+			}
+
+			const size_t partLength = std::min(length, freeSize);
+			const size_t offset = head & (ring.size() - 1);
+			const size_t firstLength = std::min(partLength, ring.size() - offset);
+
+			memcpy(&ring[offset], data, firstLength);
+			memcpy(&ring[0], data + firstLength, partLength - firstLength);
+
+			ringHead.store(head + partLength, std::memory_order_release);
+
+			data += partLength;
+			length -= partLength;
+		}
+	}
+
+	/** consumer side, serialized by flushMutex */
+	void flush()
+	{
+		std::lock_guard<std::mutex> guard(flushMutex);
+
+		size_t tail = ringTail.load(std::memory_order_relaxed);
+		const size_t head = ringHead.load(std::memory_order_acquire);
+
+		while (tail != head)
+		{
+			const size_t offset = tail & (ring.size() - 1);
+			const size_t length = head - tail;
+			const size_t firstLength = std::min(length, ring.size() - offset);
+
+			struct iovec iovecs[2];
+			iovecs[0].iov_base = &ring[offset];
+			iovecs[0].iov_len = firstLength;
+			iovecs[1].iov_base = &ring[0];
+			iovecs[1].iov_len = length - firstLength;
+
+			const ssize_t writeLength = writev(STDOUT_FILENO, iovecs, iovecs[1].iov_len ? 2 : 1);
+			if (writeLength < 0)
+			{
+				if (errno == EINTR)
+				{
+					continue;
+				}
+
+				if (errno == EAGAIN ||
+				    errno == EWOULDBLOCK)
+				{
+					struct pollfd pollFd;
+					pollFd.fd = STDOUT_FILENO;
+					pollFd.events = POLLOUT;
+					poll(&pollFd, 1, flushInterval);
+					continue;
+				}
+
+				/** stdout is closed: drop */
+				tail = head;
+			}
+			else
+			{
+				tail += writeLength;
+			}
+
+			ringTail.store(tail, std::memory_order_release);
+			spaceCondition.notify_all();
+		}
+	}
+
 private: /** modules */
 	class cLogicPrint : public cLogicModule
 	{
 	public:
+		cLogicPrint(cConsole* library) :
+		        library(library)
+		{
+		}
+
 		cModule* clone() const override
 		{
-			return new cLogicPrint();
+			return new cLogicPrint(library);
 		}
 
 		bool registerModule() override
@@ -72,12 +332,14 @@ private: /** modules */
 		{
 			if (string)
 			{
-				std::cout << *string;
-				std::cout << std::flush;
+				library->print(string, false);
 			}
 			return signalFlow(signalExit);
 		}
 
+	private:
+		cConsole* library;
+
 	private:
 		const tSignalExitId signalExit = 1;
 
@@ -88,9 +350,14 @@ private: /** modules */
 	class cLogicPrintLine : public cLogicModule
 	{
 	public:
+		cLogicPrintLine(cConsole* library) :
+		        library(library)
+		{
+		}
+
 		cModule* clone() const override
 		{
-			return new cLogicPrintLine();
+			return new cLogicPrintLine(library);
 		}
 
 		bool registerModule() override
@@ -118,21 +385,34 @@ private: /** modules */
 	private: /** signalEntries */
 		bool signalEntry()
 		{
-			if (string)
-			{
-				std::cout << *string;
-			}
-			std::cout << std::endl;
-			std::cout << std::flush;
+			library->print(string, true);
 			return signalFlow(signalExit);
 		}
 
+	private:
+		cConsole* library;
+
 	private:
 		const tSignalExitId signalExit = 1;
 
 	private:
 		std::string* string;
 	};
+
+private:
+	const bool async;
+	const unsigned int flushInterval; ///< milliseconds, at least 1 (0 would make poll() busy loop)
+
+	std::vector<char> ring; ///< size is power of two
+	std::atomic<size_t> ringHead; ///< written by modules
+	std::atomic<size_t> ringTail; ///< written by flush
+	std::mutex pushMutex; ///< producers
+	std::mutex flushMutex; ///< consumers
+	std::condition_variable spaceCondition; ///< ringTail moved
+
+	std::atomic<bool> writerRunning;
+	std::atomic<bool> wakeupRequested;
+	int wakeupEventFd;
 };
 
 }
@@ -5,8 +5,12 @@
 
 #include <vector>
 #include <map>
+#include <set>
+#include <deque>
+#include <mutex>
 
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <curl/curl.h>
 
@@ -18,22 +22,47 @@ namespace nVirtualMachine
 namespace nLibrary
 {
 
+/** requests are performed asynchronously by one curl_multi loop in library thread,
+ *  completions are delivered to modules under virtual machine lock */
 class cCurl : public cLibrary
 {
 public:
 	using tString = std::string;
 	using tBuffer = std::vector<uint8_t>;
+	using tInteger = cVirtualMachine::tInteger;
 
 public:
 	cCurl()
 	{
+		globalInitialized = false;
+		multi = nullptr;
+	}
+
+	~cCurl()
+	{
+		for (CURL* curl : handles)
+		{
+			curl_easy_cleanup(curl);
+		}
+
+		if (multi)
+		{
+			curl_multi_cleanup(multi);
+		}
+
+		if (globalInitialized)
+		{
+			curl_global_cleanup();
+		}
 	}
 
 	bool registerLibrary() override
 	{
 		setLibraryName("curl");
 
-		if (!registerModules(new cLogicGet()))
+		if (!registerModules(new cActionRequest(this, false),
+		                     new cActionRequest(this, true),
+		                     new cActionGetBatch(this)))
 		{
 			return false;
 		}
@@ -41,20 +70,577 @@ public:
 		return true;
 	}
 
+	bool init() override
+	{
+		if (curl_global_init(CURL_GLOBAL_DEFAULT) != CURLE_OK)
+		{
+			return false;
+		}
+
+		globalInitialized = true;
+
+		/** easy handles of one multi handle share connection cache (keep-alive) and DNS cache */
+		multi = curl_multi_init();
+		if (!multi)
+		{
+			return false;
+		}
+
+		return true;
+	}
+
+	void run() override
+	{
+		while (!isStopped())
+		{
+			{
+				std::lock_guard<std::mutex> guard(multiMutex);
+
+				removeCancelledRequests();
+				addRequests();
+
+				int runningCount;
+				if (curl_multi_perform(multi, &runningCount) != CURLM_OK)
+				{
+					break;
+				}
+
+				completeRequests();
+			}
+
+			deliverRequests();
+
+			if (curl_multi_poll(multi, nullptr, 0, 1000, nullptr) != CURLM_OK)
+			{
+				break;
+			}
+		}
+
+		removeRequests();
+	}
+
+	void stop() override
+	{
+		if (multi)
+		{
+			curl_multi_wakeup(multi);
+		}
+	}
+
+private:
+	class cActionRequest;
+	class cActionGetBatch;
+	class cBatch;
+
+	class cRequest
+	{
+	public:
+		cRequest() :
+		        module(nullptr),
+		        batch(nullptr),
+		        batchIndex(0),
+		        post(false),
+		        timeout(0),
+		        failed(false),
+		        curl(nullptr)
+		{
+		}
+
+	public:
+		cActionRequest* module; ///< single request, nullptr: cancelled
+		cBatch* batch; ///< or part of batch
+		size_t batchIndex;
+		tString url;
+		bool post;
+		tBuffer postData;
+		tInteger timeout; ///< milliseconds, 0 - without timeout
+		bool failed;
+		tBuffer response;
+		CURL* curl;
+	};
+
+	class cBatch
+	{
+	public:
+		cActionGetBatch* module; ///< nullptr: cancelled
+		std::vector<tString> urls;
+		size_t concurrency;
+		tInteger timeout;
+		size_t nextIndex; ///< next url to start
+		size_t completedCount;
+		std::vector<tBuffer> buffers;
+		std::vector<tInteger> statuses; ///< http response code, 0 on transfer error
+	};
+
+	/** called under virtual machine lock */
+	void pushRequest(cRequest* request)
+	{
+		{
+			std::lock_guard<std::mutex> guard(requestsMutex);
+			newRequests.push_back(request);
+		}
+
+		curl_multi_wakeup(multi);
+	}
+
+	/** called under virtual machine lock */
+	void pushBatch(cBatch* batch)
+	{
+		{
+			std::lock_guard<std::mutex> guard(requestsMutex);
+			newBatches.push_back(batch);
+		}
+
+		curl_multi_wakeup(multi);
+	}
+
+	/** called by module destructor under virtual machine lock: its requests are dropped without signals */
+	void cancel(const cModule* module)
+	{
+		std::lock_guard<std::mutex> guard(multiMutex);
+
+		for (cBatch* batch : activeBatches)
+		{
+			if (batch->module == module)
+			{
+				batch->module = nullptr;
+			}
+		}
+
+		/** handles are removed by library thread, it may be in curl_multi_poll() now */
+		for (auto iter = activeRequests.begin(); iter != activeRequests.end();)
+		{
+			cRequest* request = *iter;
+			if (request->module == module ||
+			    (request->batch && !request->batch->module))
+			{
+				cancelledRequests.push_back(request);
+				iter = activeRequests.erase(iter);
+				continue;
+			}
+			++iter;
+		}
+
+		for (auto iter = activeBatches.begin(); iter != activeBatches.end();)
+		{
+			cBatch* batch = *iter;
+			if (!batch->module)
+			{
+				delete batch;
+				iter = activeBatches.erase(iter);
+				continue;
+			}
+			++iter;
+		}
+
+		for (cRequest* request : completedRequests)
+		{
+			if (request->module == module)
+			{
+				request->module = nullptr;
+			}
+		}
+
+		for (cBatch* batch : completedBatches)
+		{
+			if (batch->module == module)
+			{
+				batch->module = nullptr;
+			}
+		}
+
+		{
+			std::lock_guard<std::mutex> guard(requestsMutex);
+
+			for (auto iter = newRequests.begin(); iter != newRequests.end();)
+			{
+				if ((*iter)->module == module)
+				{
+					delete *iter;
+					iter = newRequests.erase(iter);
+					continue;
+				}
+				++iter;
+			}
+
+			for (auto iter = newBatches.begin(); iter != newBatches.end();)
+			{
+				if ((*iter)->module == module)
+				{
+					delete *iter;
+					iter = newBatches.erase(iter);
+					continue;
+				}
+				++iter;
+			}
+		}
+
+		if (!cancelledRequests.empty())
+		{
+			curl_multi_wakeup(multi);
+		}
+	}
+
+	/** multiMutex must be locked */
+	void removeCancelledRequests()
+	{
+		for (cRequest* request : cancelledRequests)
+		{
+			curl_multi_remove_handle(multi, request->curl);
+			releaseHandle(request->curl);
+			delete request;
+		}
+		cancelledRequests.clear();
+	}
+
+	void addRequests()
+	{
+		std::deque<cRequest*> requests;
+		std::deque<cBatch*> batches;
+
+		{
+			std::lock_guard<std::mutex> guard(requestsMutex);
+			requests.swap(newRequests);
+			batches.swap(newBatches);
+		}
+
+		for (cRequest* request : requests)
+		{
+			startRequest(request);
+		}
+
+		for (cBatch* batch : batches)
+		{
+			startBatch(batch);
+		}
+	}
+
+	void startBatch(cBatch* batch)
+	{
+		batch->nextIndex = 0;
+		batch->completedCount = 0;
+		batch->buffers.resize(batch->urls.size());
+		batch->statuses.resize(batch->urls.size(), 0);
+
+		if (batch->urls.empty())
+		{
+			completedBatches.push_back(batch);
+			return;
+		}
+
+		activeBatches.insert(batch);
+
+		while (batch->nextIndex < batch->urls.size() &&
+		       batch->nextIndex - batch->completedCount < batch->concurrency)
+		{
+			if (!startBatchRequest(batch))
+			{
+				/** batch is completed */
+				return;
+			}
+		}
+	}
+
+	/** returns false if batch was completed */
+	bool startBatchRequest(cBatch* batch)
+	{
+		cRequest* request = new cRequest();
+		request->batch = batch;
+		request->batchIndex = batch->nextIndex;
+		request->url = batch->urls[batch->nextIndex];
+		request->timeout = batch->timeout;
+
+		batch->nextIndex++;
+
+		return startRequest(request);
+	}
+
+	/** returns false if request failed immediately and its batch was completed */
+	bool startRequest(cRequest* request)
+	{
+		request->curl = getHandle();
+		if (!request->curl)
+		{
+			return failRequest(request);
+		}
+
+		{
+			CURL* curl = request->curl;
+			curl_easy_setopt(curl, CURLOPT_URL, request->url.c_str());
+			curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+			curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+			curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+			curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, curlWriteData);
+			curl_easy_setopt(curl, CURLOPT_WRITEDATA, request);
+			curl_easy_setopt(curl, CURLOPT_PRIVATE, request);
+
+			if (request->timeout > 0)
+			{
+				curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, (long)request->timeout);
+			}
+
+			if (request->post)
+			{
+				curl_easy_setopt(curl, CURLOPT_POST, 1L);
+				curl_easy_setopt(curl, CURLOPT_POSTFIELDS, request->postData.data());
+				curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE, (curl_off_t)request->postData.size());
+			}
+
+			if (curl_multi_add_handle(multi, curl) != CURLM_OK)
+			{
+				releaseHandle(curl);
+				request->curl = nullptr;
+				return failRequest(request);
+			}
+		}
+
+		activeRequests.insert(request);
+		return true;
+	}
+
+	void completeRequests()
+	{
+		int messagesCount;
+		while (CURLMsg* message = curl_multi_info_read(multi, &messagesCount))
+		{
+			if (message->msg != CURLMSG_DONE)
+			{
+				continue;
+			}
+
+			CURL* curl = message->easy_handle;
+			const CURLcode result = message->data.result;
+
+			cRequest* request = nullptr;
+			curl_easy_getinfo(curl, CURLINFO_PRIVATE, (char**)&request);
+
+			long status = 0;
+			curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+
+			curl_multi_remove_handle(multi, curl);
+			releaseHandle(curl);
+
+			if (!request)
+			{
+				continue;
+			}
+
+			request->curl = nullptr;
+			activeRequests.erase(request);
+
+			if (result != CURLE_OK)
+			{
+				failRequest(request);
+				continue;
+			}
+
+			if (request->batch)
+			{
+				completeBatchRequest(request, status);
+				continue;
+			}
+
+			completedRequests.push_back(request);
+		}
+	}
+
+	/** returns false if batch was completed */
+	bool completeBatchRequest(cRequest* request,
+	                          const tInteger status)
+	{
+		cBatch* batch = request->batch;
+
+		batch->buffers[request->batchIndex].swap(request->response);
+		batch->statuses[request->batchIndex] = status;
+		batch->completedCount++;
+
+		delete request;
+
+		if (batch->nextIndex < batch->urls.size())
+		{
+			return startBatchRequest(batch);
+		}
+
+		if (batch->completedCount < batch->urls.size())
+		{
+			return true;
+		}
+
+		activeBatches.erase(batch);
+		completedBatches.push_back(batch);
+		return false;
+	}
+
+	/** modules are not unloaded while virtual machine lock is held: cancelled requests have no module */
+	void deliverRequests()
+	{
+		{
+			std::lock_guard<std::mutex> guard(multiMutex);
+			if (completedRequests.empty() &&
+			    completedBatches.empty())
+			{
+				return;
+			}
+		}
+
+		rootExecute([&]()
+		{
+			std::vector<cRequest*> requests;
+			std::vector<cBatch*> batches;
+
+			{
+				std::lock_guard<std::mutex> guard(multiMutex);
+				requests.swap(completedRequests);
+				batches.swap(completedBatches);
+			}
+
+			for (cRequest* request : requests)
+			{
+				if (request->module)
+				{
+					if (request->failed)
+					{
+						request->module->fail(request->response);
+					}
+					else
+					{
+						request->module->done(request->response);
+					}
+				}
+				delete request;
+			}
+
+			for (cBatch* batch : batches)
+			{
+				if (batch->module)
+				{
+					batch->module->done(batch);
+				}
+				delete batch;
+			}
+		});
+	}
+
+	/** on stop: requests are dropped without signals */
+	void removeRequests()
+	{
+		std::lock_guard<std::mutex> guard(multiMutex);
+
+		removeCancelledRequests();
+
+		for (cRequest* request : completedRequests)
+		{
+			delete request;
+		}
+		completedRequests.clear();
+
+		for (cBatch* batch : completedBatches)
+		{
+			delete batch;
+		}
+		completedBatches.clear();
+
+		for (cRequest* request : activeRequests)
+		{
+			curl_multi_remove_handle(multi, request->curl);
+			releaseHandle(request->curl);
+			delete request;
+		}
+		activeRequests.clear();
+
+		for (cBatch* batch : activeBatches)
+		{
+			delete batch;
+		}
+		activeBatches.clear();
+
+		std::lock_guard<std::mutex> requestsGuard(requestsMutex);
+		for (cRequest* request : newRequests)
+		{
+			delete request;
+		}
+		newRequests.clear();
+
+		for (cBatch* batch : newBatches)
+		{
+			delete batch;
+		}
+		newBatches.clear();
+	}
+
+	bool failRequest(cRequest* request)
+	{
+		if (request->batch)
+		{
+			request->response.clear();
+			return completeBatchRequest(request, 0);
+		}
+
+		request->failed = true;
+		completedRequests.push_back(request);
+		return true;
+	}
+
+	/** easy handles are reused: curl_easy_reset keeps live connections and caches */
+	CURL* getHandle()
+	{
+		if (handles.empty())
+		{
+			return curl_easy_init();
+		}
+
+		CURL* curl = handles.back();
+		handles.pop_back();
+		return curl;
+	}
+
+	void releaseHandle(CURL* curl)
+	{
+		curl_easy_reset(curl);
+		handles.push_back(curl);
+	}
+
+	static size_t curlWriteData(void* pointer, size_t size, size_t nmemb, void* args)
+	{
+		cRequest* request = (cRequest*)args;
+
+		const uint8_t* data = (const uint8_t*)pointer;
+		request->response.insert(request->response.end(), data, data + size * nmemb);
+
+		return size * nmemb;
+	}
+
 private: /** modules */
-	class cLogicGet : public cLogicModule
+	class cActionRequest : public cActionModule
 	{
 	public:
+		cActionRequest(cCurl* library,
+		               const bool post) :
+		        library(library),
+		        post(post),
+		        requested(false)
+		{
+			postBuffer = nullptr;
+		}
+
+		~cActionRequest()
+		{
+			if (requested)
+			{
+				library->cancel(this);
+			}
+		}
+
 		cModule* clone() const override
 		{
-			return new cLogicGet();
+			return new cActionRequest(library, post);
 		}
 
 		bool registerModule() override
 		{
-			setModuleName("get");
+			setModuleName(post ? "post" : "get");
 
-			if (!registerSignalEntry("signal", &cLogicGet::signalEntry))
+			if (!registerSignalEntry("signal", signalEntryRequest))
 			{
 				return false;
 			}
@@ -64,6 +650,19 @@ private: /** modules */
 				return false;
 			}
 
+			if (post)
+			{
+				if (!registerMemoryEntry("buffer", "buffer", postBuffer))
+				{
+					return false;
+				}
+			}
+
+			if (!registerMemoryEntry("timeout", "integer", timeout))
+			{
+				return false;
+			}
+
 			if (!registerSignalExit("done", signalExitDone))
 			{
 				return false;
@@ -87,88 +686,227 @@ private: /** modules */
 			return true;
 		}
 
+		/** called in library thread under virtual machine lock */
+		void done(const tBuffer& response)
+		{
+			setResponse(response);
+			cModule::signalFlow(signalExitDone);
+		}
+
+		void fail(const tBuffer& response)
+		{
+			setResponse(response);
+			cModule::signalFlow(signalExitFail);
+		}
+
 	private: /** signalEntries */
-		bool signalEntry()
+		bool signalEntry(const tSignalEntryId& signalEntryId) override
 		{
 			if (!url)
 			{
-				return signalFlow(signalExitFail);
+				return cModule::signalFlow(signalExitFail);
 			}
 
-			CURL* curl = curl_easy_init();
-			if (!curl)
+			/** memory entries may change before request is performed */
+			cRequest* request = new cRequest();
+			request->module = this;
+			request->url = *url;
+			request->post = post;
+			if (post &&
+			    postBuffer)
+			{
+				request->postData = *postBuffer;
+			}
+			request->timeout = requestTimeoutDefault;
+			if (timeout &&
+			    *timeout > 0)
 			{
-				return signalFlow(signalExitFail);
+				request->timeout = *timeout;
 			}
+			request->curl = nullptr;
 
+			requested = true;
+			library->pushRequest(request);
+
+			return true;
+		}
+
+	private:
+		void setResponse(const tBuffer& response)
+		{
 			if (string)
 			{
 				string->clear();
+				if (response.size())
+				{
+					string->assign((const char*)response.data(),
+					               strnlen((const char*)response.data(), response.size()));
+				}
 			}
 
 			if (buffer)
 			{
-				buffer->clear();
+				*buffer = response;
 			}
+		}
 
-			curl_easy_setopt(curl, CURLOPT_URL, url->c_str());
-			curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-			curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, curlWriteData);
-			curl_easy_setopt(curl, CURLOPT_WRITEDATA, this);
+	private:
+		cCurl* library;
+		const bool post;
+		bool requested; ///< requests of this module are cancelled on unload
+
+	private:
+		const tSignalEntryId signalEntryRequest = 1;
+
+		const tSignalExitId signalExitDone = 1;
+		const tSignalExitId signalExitFail = 2;
+
+	private:
+		tString* url;
+		tBuffer* postBuffer;
+		tInteger* timeout; ///< milliseconds
+		tString* string;
+		tBuffer* buffer;
+	};
+
+	class cActionGetBatch : public cActionModule
+	{
+	public:
+		cActionGetBatch(cCurl* library) :
+		        library(library),
+		        requested(false)
+		{
+		}
 
-			CURLcode res = curl_easy_perform(curl);
-			if(res != CURLE_OK)
+		~cActionGetBatch()
+		{
+			if (requested)
 			{
-				if (string)
-				{
-					string->resize(strnlen(string->c_str(), string->size()));
-				}
+				library->cancel(this);
+			}
+		}
+
+		cModule* clone() const override
+		{
+			return new cActionGetBatch(library);
+		}
+
+		bool registerModule() override
+		{
+			setModuleName("getBatch");
+
+			if (!registerSignalEntry("signal", signalEntryRequest))
+			{
+				return false;
+			}
 
-				curl_easy_cleanup(curl);
-				return signalFlow(signalExitFail);
+			if (!registerMemoryEntry("urls", "vector<string>", urls))
+			{
+				return false;
 			}
 
-			if (string)
+			if (!registerMemoryEntry("concurrency", "integer", concurrency))
+			{
+				return false;
+			}
+
+			if (!registerMemoryEntry("timeout", "integer", timeout))
+			{
+				return false;
+			}
+
+			if (!registerSignalExit("done", signalExitDone))
+			{
+				return false;
+			}
+
+			if (!registerMemoryExit("buffers", "vector<buffer>", buffers))
 			{
-				string->resize(strnlen(string->c_str(), string->size()));
+				return false;
+			}
+
+			if (!registerMemoryExit("statuses", "vector<integer>", statuses))
+			{
+				return false;
 			}
 
-			return signalFlow(signalExitDone);
+			return true;
 		}
 
-	private:
-		static size_t curlWriteData(void* pointer, size_t size, size_t nmemb, void* args)
+		/** called in library thread under virtual machine lock */
+		void done(cBatch* batch)
 		{
-			cLogicGet* module = (cLogicGet*)args;
-			tString* string = module->string;
-			tBuffer* buffer = module->buffer;
+			if (buffers)
+			{
+				buffers->swap(batch->buffers);
+			}
 
-			if (string)
+			if (statuses)
 			{
-				size_t length = string->size();
-				string->resize(length + (size * nmemb));
-				memcpy(&(*string)[length], pointer, (size * nmemb));
+				statuses->swap(batch->statuses);
 			}
 
-			if (buffer)
+			cModule::signalFlow(signalExitDone);
+		}
+
+	private: /** signalEntries */
+		bool signalEntry(const tSignalEntryId& signalEntryId) override
+		{
+			cBatch* batch = new cBatch();
+			batch->module = this;
+			if (urls)
 			{
-				size_t length = buffer->size();
-				buffer->resize(length + (size * nmemb));
-				memcpy(&(*buffer)[length], pointer, (size * nmemb));
+				batch->urls = *urls;
 			}
+			batch->concurrency = (concurrency && *concurrency > 0) ? *concurrency : batchConcurrencyDefault;
+			batch->timeout = requestTimeoutDefault;
+			if (timeout &&
+			    *timeout > 0)
+			{
+				batch->timeout = *timeout;
+			}
+
+			requested = true;
+			library->pushBatch(batch);
 
-			return nmemb;
+			return true;
 		}
 
 	private:
+		cCurl* library;
+		bool requested;
+
+	private:
+		const tSignalEntryId signalEntryRequest = 1;
+
 		const tSignalExitId signalExitDone = 1;
-		const tSignalExitId signalExitFail = 2;
 
 	private:
-		tString* url;
-		tString* string;
-		tBuffer* buffer;
+		std::vector<tString>* urls;
+		tInteger* concurrency;
+		tInteger* timeout; ///< milliseconds per request, requestTimeoutDefault if not connected or not positive
+		std::vector<tBuffer>* buffers;
+		std::vector<tInteger>* statuses;
 	};
+
+private:
+	constexpr static size_t batchConcurrencyDefault = 8;
+	constexpr static tInteger requestTimeoutDefault = 30000; ///< milliseconds
+
+	bool globalInitialized;
+	CURLM* multi;
+
+	std::mutex requestsMutex;
+	std::deque<cRequest*> newRequests;
+	std::deque<cBatch*> newBatches;
+
+	std::mutex multiMutex; ///< multi handle, active and completed requests. locked after virtual machine lock
+	std::set<cRequest*> activeRequests;
+	std::set<cBatch*> activeBatches;
+	std::vector<cRequest*> cancelledRequests; ///< handles to remove
+	std::vector<cRequest*> completedRequests; ///< to deliver
+	std::vector<cBatch*> completedBatches;
+	std::vector<CURL*> handles; ///< free easy handles
 };
 
 }
@@ -4,229 +4,1909 @@
 #define TVM_LIBRARY_HTTPSERVER_H
 
 #include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
 #include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <strings.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <signal.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <fcntl.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include <pthread.h>
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
 
 #include <tvm/library.h>
 
 namespace nVirtualMachine
 {
 
-namespace nLibrary
-{
+namespace nLibrary
+{
+
+class cHttpServer : public cLibrary
+{
+public:
+	using tIpAddress = uint32_t;
+	using tBoolean = bool;
+	using tString = std::string;
+	using tBuffer = cVirtualMachine::tBuffer;
+	using tInteger = cVirtualMachine::tInteger;
+
+public:
+	cHttpServer(const std::string& ipAddress,
+	            const uint16_t port,
+	            const unsigned int workersCount = 1,
+	            const size_t bodyChunkSize = 1024 * 1024) :
+	        ipAddress(ipAddress),
+	        port(port),
+	        bodyChunkSize(std::max(bodyChunkSize, (size_t)1))
+	{
+		for (unsigned int worker_i = 0; worker_i < std::max(workersCount, 1u); worker_i++)
+		{
+			workers.emplace_back(new cWorker(this, worker_i));
+		}
+	}
+
+	bool registerLibrary() override
+	{
+		setLibraryName("httpServer");
+
+		if (!registerMemory<tIpAddress>("ipAddress",
+		                                0))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule("ipAddress",
+		                          new cLogicConvert<tIpAddress,
+		                                            tString>("toString",
+		                                                     "ipAddress",
+		                                                     "string",
+			[](tIpAddress* from, tString* to)
+			{
+				char ipAddressStr[16];
+				snprintf(ipAddressStr, 16, "%u.%u.%u.%u",
+				         ((*from) & 0xFF),
+				         (((*from) >> 8) & 0xFF),
+				         (((*from) >> 16) & 0xFF),
+				         (((*from) >> 24) & 0xFF));
+				*to = ipAddressStr;
+			})))
+		{
+			return false;
+		}
+
+		if (!registerRootModules(rootGet,
+		                         rootPost))
+		{
+			return false;
+		}
+
+		if (!registerModules(new cLogicOk(this),
+		                     new cLogicNotFound(this)))
+		{
+			return false;
+		}
+
+		return true;
+	}
+
+	bool init() override
+	{
+		for (auto& worker : workers)
+		{
+			if (!worker->init())
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	void run() override
+	{
+		for (unsigned int worker_i = 1; worker_i < workers.size(); worker_i++)
+		{
+			workers[worker_i]->runThread();
+		}
+
+		workers[0]->run();
+
+		for (unsigned int worker_i = 1; worker_i < workers.size(); worker_i++)
+		{
+			workers[worker_i]->wait();
+		}
+	}
+
+	void stop() override
+	{
+		for (auto& worker : workers)
+		{
+			worker->stop();
+		}
+	}
+
+private:
+	/** incremental parser, works in place over the receive buffer */
+	class cRequest
+	{
+	public:
+		enum class eResult
+		{
+			incomplete,
+			complete,
+			error
+		};
+
+		/** offsets instead of pointers: receive buffer may be reallocated between calls */
+		class cToken
+		{
+		public:
+			cToken() :
+			        offset(0),
+			        length(0)
+			{
+			}
+
+			cToken(const size_t offset,
+			       const size_t length) :
+			        offset(offset),
+			        length(length)
+			{
+			}
+
+		public:
+			size_t offset;
+			size_t length;
+		};
+
+		class cHeader
+		{
+		public:
+			cToken name;
+			cToken value;
+		};
+
+	public:
+		cRequest()
+		{
+			reset();
+		}
+
+		void reset()
+		{
+			scanPosition = 0;
+			headerLength = 0;
+			contentLength = 0;
+			headersCount = 0;
+			keepAlive = false;
+			streamed = false;
+			expectContinue = false;
+			errorStatus = nullptr;
+		}
+
+		/** data points to the first unconsumed byte of the receive buffer */
+		eResult parse(const char* data,
+		              const size_t size,
+		              const size_t bodyBufferMaxSize)
+		{
+			if (!headerLength)
+			{
+				/** continue scan where previous call stopped */
+				const size_t from = scanPosition > 3 ? scanPosition - 3 : 0;
+				scanPosition = size;
+
+				const char* headerEnd = (const char*)memmem(data + from, size - from, "\r\n\r\n", 4);
+				if (!headerEnd)
+				{
+					if (size > requestHeaderMaxSize)
+					{
+						return fail("431 Request Header Fields Too Large");
+					}
+
+					return eResult::incomplete;
+				}
+
+				headerLength = headerEnd + 4 - data;
+
+				if (headerLength > requestHeaderMaxSize)
+				{
+					return fail("431 Request Header Fields Too Large");
+				}
+
+				if (!parseHeader(data))
+				{
+					return eResult::error;
+				}
+
+				/** body is not buffered: caller reads it in parts */
+				streamed = (contentLength > bodyBufferMaxSize);
+			}
+
+			if (streamed)
+			{
+				return eResult::complete;
+			}
+
+			if (size < headerLength + contentLength)
+			{
+				return eResult::incomplete;
+			}
+
+			return eResult::complete;
+		}
+
+		size_t size() const
+		{
+			return headerLength + contentLength;
+		}
+
+		size_t getHeaderLength() const
+		{
+			return headerLength;
+		}
+
+		cToken getBody() const
+		{
+			return cToken(headerLength, contentLength);
+		}
+
+		cToken getHeader(const char* data,
+		                 const char* name) const
+		{
+			for (unsigned int header_i = 0; header_i < headersCount; header_i++)
+			{
+				if (equalsCase(data, headers[header_i].name, name))
+				{
+					return headers[header_i].value;
+				}
+			}
+
+			return cToken();
+		}
+
+		static bool equals(const char* data,
+		                   const cToken& token,
+		                   const char* string)
+		{
+			return token.length == strlen(string) &&
+			       !memcmp(data + token.offset, string, token.length);
+		}
+
+		static bool equalsCase(const char* data,
+		                       const cToken& token,
+		                       const char* string)
+		{
+			return token.length == strlen(string) &&
+			       !strncasecmp(data + token.offset, string, token.length);
+		}
+
+		static tString toString(const char* data,
+		                        const cToken& token)
+		{
+			return tString(data + token.offset, token.length);
+		}
+
+		/** percent-decoding, allocates only here */
+		static tString decode(const char* data,
+		                      const cToken& token,
+		                      const bool plusAsSpace)
+		{
+			const char* from = data + token.offset;
+			const char* end = from + token.length;
+
+			tString result;
+			result.reserve(token.length);
+
+			while (from < end)
+			{
+				if (*from == '%' &&
+				    end - from >= 3 &&
+				    isxdigit((unsigned char)from[1]) &&
+				    isxdigit((unsigned char)from[2]))
+				{
+					result.push_back((char)((hexValue(from[1]) << 4) | hexValue(from[2])));
+					from += 3;
+				}
+				else if (*from == '+' &&
+				         plusAsSpace)
+				{
+					result.push_back(' ');
+					from++;
+				}
+				else
+				{
+					result.push_back(*from);
+					from++;
+				}
+			}
+
+			return result;
+		}
+
+	private:
+		bool parseHeader(const char* data)
+		{
+			/** every line, including the last empty one, ends with "\r\n" */
+			const size_t end = headerLength - 2;
+
+			size_t lineEnd;
+			if (!findLineEnd(data, 0, end, lineEnd))
+			{
+				return failHeader("400 Bad Request");
+			}
+
+			/** request line: method SP target SP version */
+			const char* methodEnd = (const char*)memchr(data, ' ', lineEnd);
+			if (!methodEnd ||
+			    methodEnd == data)
+			{
+				return failHeader("400 Bad Request");
+			}
+
+			method = cToken(0, methodEnd - data);
+
+			const size_t targetOffset = method.length + 1;
+			const char* targetEnd = (const char*)memchr(data + targetOffset, ' ', lineEnd - targetOffset);
+			if (!targetEnd ||
+			    targetEnd == data + targetOffset)
+			{
+				return failHeader("400 Bad Request");
+			}
+
+			target = cToken(targetOffset, targetEnd - data - targetOffset);
+
+			const size_t versionOffset = target.offset + target.length + 1;
+			version = cToken(versionOffset, lineEnd - versionOffset);
+			if (version.length != 8 ||
+			    memcmp(data + version.offset, "HTTP/1.", 7))
+			{
+				return failHeader("505 HTTP Version Not Supported");
+			}
+
+			const char* queryStart = (const char*)memchr(data + target.offset, '?', target.length);
+			if (queryStart)
+			{
+				path = cToken(target.offset, queryStart - data - target.offset);
+				query = cToken(path.offset + path.length + 1, target.length - path.length - 1);
+			}
+			else
+			{
+				path = target;
+				query = cToken();
+			}
+
+			/** HTTP/1.0 requires explicit keep-alive */
+			keepAlive = (data[version.offset + 7] != '0');
+
+			bool hasContentLength = false;
+
+			size_t position = lineEnd + 2;
+			while (position < end)
+			{
+				if (!findLineEnd(data, position, end, lineEnd))
+				{
+					return failHeader("400 Bad Request");
+				}
+
+				if (headersCount == headers.size())
+				{
+					return failHeader("431 Request Header Fields Too Large");
+				}
+
+				const char* colon = (const char*)memchr(data + position, ':', lineEnd - position);
+				if (!colon ||
+				    colon == data + position)
+				{
+					return failHeader("400 Bad Request");
+				}
+
+				size_t valueStart = colon + 1 - data;
+				size_t valueEnd = lineEnd;
+				while (valueStart < valueEnd &&
+				       (data[valueStart] == ' ' || data[valueStart] == '\t'))
+				{
+					valueStart++;
+				}
+				while (valueEnd > valueStart &&
+				       (data[valueEnd - 1] == ' ' || data[valueEnd - 1] == '\t'))
+				{
+					valueEnd--;
+				}
+
+				cHeader& header = headers[headersCount];
+				header.name = cToken(position, colon - data - position);
+				header.value = cToken(valueStart, valueEnd - valueStart);
+				headersCount++;
+
+				if (equalsCase(data, header.name, "content-length"))
+				{
+					size_t value;
+					if (!parseNumber(data, header.value, value) ||
+					    (hasContentLength && value != contentLength))
+					{
+						return failHeader("400 Bad Request");
+					}
+
+					hasContentLength = true;
+					contentLength = value;
+				}
+				else if (equalsCase(data, header.name, "transfer-encoding"))
+				{
+					return failHeader("501 Not Implemented");
+				}
+				else if (equalsCase(data, header.name, "expect"))
+				{
+					expectContinue = equalsCase(data, header.value, "100-continue");
+				}
+				else if (equalsCase(data, header.name, "connection"))
+				{
+					if (equalsCase(data, header.value, "close"))
+					{
+						keepAlive = false;
+					}
+					else if (equalsCase(data, header.value, "keep-alive"))
+					{
+						keepAlive = true;
+					}
+				}
+
+				position = lineEnd + 2;
+			}
+
+			return true;
+		}
+
+		static bool findLineEnd(const char* data,
+		                        const size_t position,
+		                        const size_t end,
+		                        size_t& lineEnd)
+		{
+			const char* carriageReturn = (const char*)memchr(data + position, '\r', end - position);
+			if (!carriageReturn ||
+			    carriageReturn[1] != '\n')
+			{
+				return false;
+			}
+
+			lineEnd = carriageReturn - data;
+			return true;
+		}
+
+		static bool parseNumber(const char* data,
+		                        const cToken& token,
+		                        size_t& value)
+		{
+			if (!token.length ||
+			    token.length > 18)
+			{
+				return false;
+			}
+
+			value = 0;
+			for (size_t i = token.offset; i < token.offset + token.length; i++)
+			{
+				if (data[i] < '0' ||
+				    data[i] > '9')
+				{
+					return false;
+				}
+
+				value = value * 10 + (data[i] - '0');
+			}
+
+			return true;
+		}
+
+		static int hexValue(const char c)
+		{
+			if (c <= '9')
+			{
+				return c - '0';
+			}
+
+			return (c | 0x20) - 'a' + 10;
+		}
+
+		eResult fail(const char* status)
+		{
+			errorStatus = status;
+			return eResult::error;
+		}
+
+		bool failHeader(const char* status)
+		{
+			errorStatus = status;
+			return false;
+		}
+
+	public:
+		cToken method;
+		cToken target; ///< path and query, not decoded
+		cToken path;
+		cToken query;
+		cToken version;
+		std::array<cHeader, 64> headers;
+		unsigned int headersCount;
+		bool keepAlive;
+		bool streamed; ///< body is larger than bodyBufferMaxSize
+		bool expectContinue; ///< client waits for "100 Continue" before sending body
+		const char* errorStatus; ///< response status on eResult::error
+
+	private:
+		size_t scanPosition;
+		size_t headerLength;
+		size_t contentLength;
+	};
+
+	enum class eConnectionState
+	{
+		readRequest,
+		readBody,
+		waitResponse, ///< scheme answers later by connectionId
+		writeResponse
+	};
+
+	/** request values in scheme types */
+	class cRequestMemory
+	{
+	public:
+		tString host;
+		tString url;
+		std::map<tString, tString> arguments;
+		tString fullUrl;
+		std::map<tString, tString> headers;
+	};
+
+	class cConnection
+	{
+	public:
+		cConnection() :
+		        socket(-1),
+		        ipAddress(0),
+		        connectionId(0),
+		        state(eConnectionState::readRequest),
+		        inPosition(0),
+		        outPosition(0),
+		        fileFd(-1),
+		        fileOffset(0),
+		        fileRemaining(0),
+		        responded(false),
+		        keepAlive(false),
+		        closeAfterWrite(false),
+		        writeFailed(false),
+		        bodyRemaining(0),
+		        bodyKeepAlive(false),
+		        lastActivity(0)
+		{
+		}
+
+		~cConnection()
+		{
+			closeFile();
+		}
+
+		void response(const char* status,
+		              const char* content,
+		              size_t contentLength)
+		{
+			const struct iovec contents[] = {makeIovec(content, contentLength)};
+			response(status, contents, 1);
+		}
+
+		/** header and contents are written directly from scheme memories, only unsent tail is copied */
+		void response(const char* status,
+		              const struct iovec* contents,
+		              const unsigned int contentsCount,
+		              const size_t fileLength = 0)
+		{
+			responded = true;
+
+			size_t contentLength = fileLength;
+			for (unsigned int content_i = 0; content_i < contentsCount; content_i++)
+			{
+				contentLength += contents[content_i].iov_len;
+			}
+
+			char header[256];
+			int headerLength = snprintf(header, sizeof(header),
+			                            "HTTP/1.1 %s\r\n"
+			                            "Server: tvm/library/httpserver\r\n"
+			                            "Content-Length: %zu\r\n"
+			                            "Connection: %s\r\n"
+			                            "\r\n",
+			                            status,
+			                            contentLength,
+			                            keepAlive ? "keep-alive" : "close");
+			if (headerLength < 0 ||
+			    headerLength >= (int)sizeof(header))
+			{
+				writeFailed = true;
+				return;
+			}
+
+			struct iovec iovecs[responseIovecsMaxCount];
+			unsigned int iovecsCount = 0;
+
+			if (outPosition < out.size())
+			{
+				iovecs[iovecsCount] = makeIovec(out.data() + outPosition, out.size() - outPosition);
+				iovecsCount++;
+			}
+
+			iovecs[iovecsCount] = makeIovec(header, headerLength);
+			iovecsCount++;
+
+			for (unsigned int content_i = 0; content_i < contentsCount; content_i++)
+			{
+				if (contents[content_i].iov_len &&
+				    iovecsCount < responseIovecsMaxCount)
+				{
+					iovecs[iovecsCount] = contents[content_i];
+					iovecsCount++;
+				}
+			}
+
+			size_t writeLength = 0;
+			if (!writeFailed)
+			{
+				struct msghdr message;
+				memset(&message, 0, sizeof(message));
+				message.msg_iov = iovecs;
+				message.msg_iovlen = iovecsCount;
+
+				ssize_t sendLength;
+				do
+				{
+					sendLength = sendmsg(socket, &message, MSG_NOSIGNAL);
+				} while (sendLength < 0 && errno == EINTR);
+
+				if (sendLength < 0)
+				{
+					if (errno != EAGAIN &&
+					    errno != EWOULDBLOCK)
+					{
+						writeFailed = true;
+					}
+				}
+				else
+				{
+					writeLength = sendLength;
+				}
+			}
+
+			std::string tail;
+			if (!writeFailed)
+			{
+				for (unsigned int iovec_i = 0; iovec_i < iovecsCount; iovec_i++)
+				{
+					if (writeLength >= iovecs[iovec_i].iov_len)
+					{
+						writeLength -= iovecs[iovec_i].iov_len;
+						continue;
+					}
+
+					tail.append((const char*)iovecs[iovec_i].iov_base + writeLength,
+					            iovecs[iovec_i].iov_len - writeLength);
+					writeLength = 0;
+				}
+			}
+
+			out.swap(tail);
+			outPosition = 0;
+
+			if (fileRemaining &&
+			    !writeFile())
+			{
+				writeFailed = true;
+			}
+		}
+
+		/** body is sent with sendfile after header */
+		bool responseFile(const char* status,
+		                  const char* path)
+		{
+			closeFile();
+
+			fileFd = open(path, O_RDONLY | O_CLOEXEC);
+			if (fileFd < 0)
+			{
+				fileFd = -1;
+				return false;
+			}
+
+			struct stat fileStat;
+			if (fstat(fileFd, &fileStat) < 0 ||
+			    !S_ISREG(fileStat.st_mode))
+			{
+				closeFile();
+				return false;
+			}
+
+			fileOffset = 0;
+			fileRemaining = fileStat.st_size;
+
+			response(status, nullptr, 0, fileRemaining);
+
+			return true;
+		}
+
+		bool isWritePending() const
+		{
+			return outPosition < out.size() ||
+			       fileRemaining;
+		}
+
+		bool writeFile()
+		{
+			while (fileRemaining &&
+			       outPosition >= out.size())
+			{
+				const ssize_t sendLength = sendfile(socket,
+				                                    fileFd,
+				                                    &fileOffset,
+				                                    std::min(fileRemaining, (size_t)0x7FFFF000));
+				if (sendLength < 0)
+				{
+					if (errno == EAGAIN ||
+					    errno == EWOULDBLOCK)
+					{
+						return true;
+					}
+
+					if (errno == EINTR)
+					{
+						continue;
+					}
+
+					return false;
+				}
+
+				if (sendLength == 0)
+				{
+					/** file was truncated */
+					return false;
+				}
+
+				fileRemaining -= sendLength;
+			}
+
+			if (!fileRemaining)
+			{
+				closeFile();
+			}
+
+			return true;
+		}
+
+		void closeFile()
+		{
+			if (fileFd != -1)
+			{
+				close(fileFd);
+				fileFd = -1;
+			}
+
+			fileRemaining = 0;
+		}
+
+	public:
+		int socket;
+		tIpAddress ipAddress;
+		tInteger connectionId; ///< current request, new for every request of connection
+		eConnectionState state;
+		cRequest request;
+		std::string in;
+		size_t inPosition; ///< first unconsumed byte of in (pipelining)
+		std::string out; ///< unsent part of responses
+		size_t outPosition;
+		int fileFd;
+		off_t fileOffset;
+		size_t fileRemaining;
+		bool responded;
+		bool keepAlive;
+		bool closeAfterWrite;
+		bool writeFailed;
+		cRequestMemory bodyRequest; ///< values of request which body is being read
+		size_t bodyRemaining;
+		bool bodyKeepAlive;
+		time_t lastActivity;
+	};
+
+	/** answer to request which is not executed by its worker now, copied to worker queue */
+	class cResponse
+	{
+	public:
+		cResponse() :
+		        connectionId(0),
+		        status(nullptr)
+		{
+		}
+
+	public:
+		tInteger connectionId;
+		const char* status;
+		std::string content;
+		tString file;
+	};
+
+	/** one listening socket (SO_REUSEPORT) and one epoll loop per worker */
+	class cWorker
+	{
+	public:
+		cWorker(cHttpServer* library,
+		        const unsigned int workerId) :
+		        library(library),
+		        workerId(workerId)
+		{
+			serverSocket = -1;
+			epollFd = -1;
+			wakeupEventFd = -1;
+			thread = 0;
+			threadId = std::thread::id();
+			nextConnectionId = 0;
+			dispatchingConnection = nullptr;
+		}
+
+		~cWorker()
+		{
+			closeConnections();
+
+			closeSocket(serverSocket);
+			closeSocket(wakeupEventFd);
+			closeSocket(epollFd);
+		}
+
+		bool init()
+		{
+			serverSocket = socket(PF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+			if (serverSocket < 0)
+			{
+				serverSocket = -1;
+				return false;
+			}
+
+			int one = 1;
+			if (setsockopt(serverSocket, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) < 0)
+			{
+				return false;
+			}
+
+			if (setsockopt(serverSocket, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) < 0)
+			{
+				return false;
+			}
+
+			epollFd = epoll_create1(0);
+			if (epollFd < 0)
+			{
+				epollFd = -1;
+				return false;
+			}
+
+			wakeupEventFd = eventfd(0, EFD_NONBLOCK);
+			if (wakeupEventFd < 0)
+			{
+				wakeupEventFd = -1;
+				return false;
+			}
+
+			if (!epollControl(EPOLL_CTL_ADD, wakeupEventFd, EPOLLIN))
+			{
+				return false;
+			}
+
+			/** connectionId % workersCount is worker of request, 0 is not used */
+			nextConnectionId = library->workers.size() + workerId;
+
+			return true;
+		}
+
+		void runThread()
+		{
+			pthread_attr_t attr;
+
+			if (pthread_attr_init(&attr) != 0)
+			{
+				return;
+			}
+			if (pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE) != 0)
+			{
+				return;
+			}
+
+			if (pthread_create(&thread, &attr, &callHelper, this) != 0)
+			{
+				thread = 0;
+			}
+
+			pthread_attr_destroy(&attr);
+		}
+
+		void wait()
+		{
+			if (thread != 0)
+			{
+				void* status;
+				pthread_join(thread, &status);
+				thread = 0;
+			}
+		}
+
+		void run()
+		{
+			/** sendfile has no MSG_NOSIGNAL */
+			sigset_t signals;
+			sigemptyset(&signals);
+			sigaddset(&signals, SIGPIPE);
+			pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+			threadId.store(std::this_thread::get_id(), std::memory_order_relaxed);
+
+			struct sockaddr_in address;
+			memset((char*)&address, 0, sizeof(struct sockaddr_in));
+			address.sin_family = PF_INET;
+			address.sin_addr.s_addr = inet_addr(library->ipAddress.c_str());
+			address.sin_port = htons(library->port);
+
+			if (bind(serverSocket, (struct sockaddr*)&address, sizeof(address)) < 0)
+			{
+				return;
+			}
+
+			if (listen(serverSocket, SOMAXCONN) < 0)
+			{
+				return;
+			}
+
+			if (!epollControl(EPOLL_CTL_ADD, serverSocket, EPOLLIN))
+			{
+				return;
+			}
+
+			struct epoll_event events[epollEventsSize];
+			time_t lastIdleCheck = getMonotonicTime();
+
+			while (!library->isStopped())
+			{
+				const int eventsCount = epoll_wait(epollFd, events, epollEventsSize, 1000);
+				if (eventsCount < 0)
+				{
+					if (errno == EINTR)
+					{
+						continue;
+					}
+
+					break;
+				}
+
+				for (int event_i = 0; event_i < eventsCount; event_i++)
+				{
+					const int socket = events[event_i].data.fd;
+
+					if (socket == wakeupEventFd)
+					{
+						uint64_t value;
+						if (read(wakeupEventFd, &value, sizeof(value)) < 0)
+						{
+							/** EAGAIN: counter was read by previous event, queue is checked anyway */
+						}
+
+						processResponses();
+						continue;
+					}
+
+					if (socket == serverSocket)
+					{
+						acceptConnections();
+						continue;
+					}
+
+					auto iter = connections.find(socket);
+					if (iter == connections.end())
+					{
+						continue;
+					}
+
+					if (!handleConnection(socket, iter->second, events[event_i].events))
+					{
+						closeConnection(socket);
+					}
+				}
+
+				const time_t currentTime = getMonotonicTime();
+				if (currentTime != lastIdleCheck)
+				{
+					lastIdleCheck = currentTime;
+					closeIdleConnections(currentTime);
+				}
+			}
+
+			closeConnections();
+		}
+
+		void stop()
+		{
+			wakeup();
+		}
+
+		bool isCurrentThread() const
+		{
+			/** other threads can not read their own id here before it is stored: relaxed order is enough */
+			return std::this_thread::get_id() == threadId.load(std::memory_order_relaxed);
+		}
+
+		/** request being executed by this worker thread, or 0 */
+		tInteger getCurrentConnectionId() const
+		{
+			if (!isCurrentThread() ||
+			    !dispatchingConnection)
+			{
+				return 0;
+			}
+
+			return dispatchingConnection->connectionId;
+		}
+
+		/** connection is answered directly only while its request is executed by this worker thread */
+		cConnection* getDispatchingConnection(const tInteger connectionId) const
+		{
+			if (!isCurrentThread() ||
+			    !dispatchingConnection ||
+			    dispatchingConnection->connectionId != connectionId ||
+			    dispatchingConnection->responded)
+			{
+				return nullptr;
+			}
+
+			return dispatchingConnection;
+		}
+
+		/** called by modules of any thread */
+		void pushResponse(cResponse&& response)
+		{
+			{
+				std::lock_guard<std::mutex> guard(responsesMutex);
+				responses.emplace_back(std::move(response));
+			}
+
+			wakeup();
+		}
+
+	private:
+		void wakeup()
+		{
+			if (wakeupEventFd != -1)
+			{
+				uint64_t value = 1;
+				if (write(wakeupEventFd, &value, sizeof(value)) < 0)
+				{
+					/** EAGAIN: counter is not read yet, worker is woken anyway */
+				}
+			}
+		}
+
+		void processResponses()
+		{
+			std::vector<cResponse> pushedResponses;
+
+			{
+				std::lock_guard<std::mutex> guard(responsesMutex);
+				pushedResponses.swap(responses);
+			}
+
+			for (cResponse& response : pushedResponses)
+			{
+				auto socketIter = connectionSockets.find(response.connectionId);
+				if (socketIter == connectionSockets.end())
+				{
+					/** connection is closed */
+					continue;
+				}
+
+				const int socket = socketIter->second;
+				cConnection& connection = connections[socket];
+				if (connection.responded)
+				{
+					continue;
+				}
+
+				if (!completeResponse(socket, connection, response))
+				{
+					closeConnection(socket);
+				}
+			}
+		}
+
+		/** answer of request which is not executed now: waiting, or body is being read */
+		bool completeResponse(const int socket,
+		                      cConnection& connection,
+		                      const cResponse& response)
+		{
+			const bool bodyDropped = (connection.state == eConnectionState::readBody);
+			if (bodyDropped)
+			{
+				/** rest of body is not read */
+				connection.keepAlive = false;
+			}
+
+			if (!response.file.empty())
+			{
+				if (!connection.responseFile(response.status, response.file.c_str()))
+				{
+					responseNotFound(&connection);
+				}
+			}
+			else
+			{
+				connection.response(response.status, response.content.data(), response.content.size());
+			}
+
+			if (bodyDropped)
+			{
+				dispatchBody(connection, nullptr, 0);
+				connection.bodyRequest = cRequestMemory();
+			}
+
+			if (!connection.keepAlive)
+			{
+				connection.closeAfterWrite = true;
+			}
+
+			connection.state = eConnectionState::writeResponse;
+			if (!epollControl(EPOLL_CTL_MOD, socket, EPOLLOUT))
+			{
+				return false;
+			}
+
+			return processConnection(socket, connection);
+		}
+
+		static void* callHelper(void* args)
+		{
+			cWorker* worker = (cWorker*)args;
+			worker->run();
+			return nullptr;
+		}
+
+		void acceptConnections()
+		{
+			for (;;)
+			{
+				struct sockaddr_in address;
+				socklen_t addressLength = sizeof(address);
+				const int clientSocket = accept4(serverSocket,
+				                                 (struct sockaddr*)&address,
+				                                 &addressLength,
+				                                 SOCK_NONBLOCK);
+				if (clientSocket < 0)
+				{
+					/** EAGAIN, or out of descriptors: retry on next event */
+					return;
+				}
+
+				int one = 1;
+				setsockopt(clientSocket, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+				if (!epollControl(EPOLL_CTL_ADD, clientSocket, EPOLLIN))
+				{
+					close(clientSocket);
+					continue;
+				}
+
+				cConnection& connection = connections[clientSocket];
+				connection.socket = clientSocket;
+				connection.ipAddress = address.sin_addr.s_addr;
+				connection.lastActivity = getMonotonicTime();
+			}
+		}
+
+		bool handleConnection(const int socket,
+		                      cConnection& connection,
+		                      const uint32_t events)
+		{
+			connection.lastActivity = getMonotonicTime();
+
+			if (events & (EPOLLERR | EPOLLHUP))
+			{
+				return false;
+			}
+
+			bool peerClosed = false;
+
+			if (events & EPOLLIN)
+			{
+				for (;;)
+				{
+					char buffer[16384];
+
+					const ssize_t recvLength = recv(socket, buffer, sizeof(buffer), MSG_NOSIGNAL);
+					if (recvLength < 0)
+					{
+						if (errno == EAGAIN ||
+						    errno == EWOULDBLOCK)
+						{
+							break;
+						}
+
+						if (errno == EINTR)
+						{
+							continue;
+						}
+
+						return false;
+					}
+
+					if (recvLength == 0)
+					{
+						/** answer already received requests before close */
+						peerClosed = true;
+						break;
+					}
+
+					connection.in.append(buffer, recvLength);
+
+					if (connection.in.size() - connection.inPosition > requestHeaderMaxSize + library->bodyChunkSize)
+					{
+						/** process buffered requests first, rest stays in socket */
+						break;
+					}
+				}
+			}
+
+			if (!processConnection(socket, connection))
+			{
+				return false;
+			}
+
+			if (peerClosed)
+			{
+				/** body will not be completed: signalEnd on close */
+				if (connection.state == eConnectionState::readRequest ||
+				    connection.state == eConnectionState::readBody)
+				{
+					return false;
+				}
+
+				connection.closeAfterWrite = true;
+			}
+
+			return true;
+		}
+
+		bool processConnection(const int socket,
+		                       cConnection& connection)
+		{
+			for (;;)
+			{
+				if (connection.state == eConnectionState::waitResponse)
+				{
+					/** next pipelined request is read after answer */
+					return true;
+				}
+
+				if (connection.state == eConnectionState::writeResponse)
+				{
+					if (!writeConnection(socket, connection))
+					{
+						return false;
+					}
+
+					if (connection.isWritePending())
+					{
+						/** wait for EPOLLOUT */
+						return true;
+					}
+
+					connection.out.clear();
+					connection.outPosition = 0;
+
+					if (connection.closeAfterWrite)
+					{
+						return false;
+					}
+
+					if (!epollControl(EPOLL_CTL_MOD, socket, EPOLLIN))
+					{
+						return false;
+					}
+
+					connection.state = eConnectionState::readRequest;
+				}
+
+				const char* data = connection.in.data() + connection.inPosition;
+				const size_t size = connection.in.size() - connection.inPosition;
+
+				if (connection.state == eConnectionState::readBody)
+				{
+					const size_t chunkLength = std::min(connection.bodyRemaining, library->bodyChunkSize);
+					if (size < chunkLength)
+					{
+						compactConnection(connection);
+						return true;
+					}
+
+					connection.bodyRemaining -= chunkLength;
+
+					/** answer before end of body: rest of body is not read, connection is closed */
+					connection.keepAlive = connection.bodyRemaining ? false : connection.bodyKeepAlive;
+
+					dispatchBody(connection, data, chunkLength);
+					connection.inPosition += chunkLength;
+
+					if (!connection.responded &&
+					    connection.bodyRemaining)
+					{
+						continue;
+					}
+
+					/** after last chunk, also when rest of body is dropped after answer */
+					dispatchBody(connection, data, 0);
+
+					connection.bodyRequest = cRequestMemory();
+					connection.state = eConnectionState::readRequest;
+				}
+				else
+				{
+					const auto result = connection.request.parse(data, size, library->bodyChunkSize);
+					if (result == cRequest::eResult::incomplete)
+					{
+						if (!continueConnection(socket, connection))
+						{
+							return false;
+						}
+
+						compactConnection(connection);
+						return true;
+					}
+
+					connection.responded = false;
+
+					if (result == cRequest::eResult::error)
+					{
+						connection.keepAlive = false;
+						connection.response(connection.request.errorStatus, "", 0);
+					}
+					else if (!cRequest::equals(data, connection.request.method, "GET") &&
+					         !cRequest::equals(data, connection.request.method, "POST"))
+					{
+						/** streamed body is not read: connection is closed */
+						connection.keepAlive = connection.request.keepAlive && !connection.request.streamed;
+						connection.response("501 Not Implemented", "", 0);
+
+						if (!connection.request.streamed)
+						{
+							connection.inPosition += connection.request.size();
+						}
+					}
+					else if (connection.request.streamed)
+					{
+						if (!cRequest::equals(data, connection.request.method, "POST"))
+						{
+							connection.keepAlive = false;
+							connection.response("413 Payload Too Large", "", 0);
+						}
+						else
+						{
+							beginRequest(socket, connection);
+							library->getRequestMemory(data, connection.request, true, connection.bodyRequest);
+
+							connection.bodyRemaining = connection.request.getBody().length;
+							connection.bodyKeepAlive = connection.request.keepAlive;
+							connection.inPosition += connection.request.getHeaderLength();
+							connection.state = eConnectionState::readBody;
+
+							if (!continueConnection(socket, connection))
+							{
+								return false;
+							}
+
+							connection.request.reset();
+							continue;
+						}
+					}
+					else
+					{
+						connection.keepAlive = connection.request.keepAlive;
+
+						beginRequest(socket, connection);
+						dispatchRequest(connection, data);
+
+						connection.inPosition += connection.request.size();
+					}
+
+					connection.request.reset();
+				}
+
+				if (!connection.responded)
+				{
+					/** scheme answers later by connectionId, or 504 after responseTimeout */
+					connection.state = eConnectionState::waitResponse;
+					return epollControl(EPOLL_CTL_MOD, socket, 0);
+				}
+
+				connection.closeAfterWrite = !connection.keepAlive;
+
+				if (!writeConnection(socket, connection))
+				{
+					return false;
+				}
+
+				if (connection.isWritePending())
+				{
+					connection.state = eConnectionState::writeResponse;
+					return epollControl(EPOLL_CTL_MOD, socket, EPOLLOUT);
+				}
+
+				connection.out.clear();
+				connection.outPosition = 0;
+
+				if (connection.closeAfterWrite)
+				{
+					return false;
+				}
+			}
+		}
+
+		/** new id for every request: late answer of previous request is dropped */
+		void beginRequest(const int socket,
+		                  cConnection& connection)
+		{
+			connectionSockets.erase(connection.connectionId);
+
+			connection.connectionId = nextConnectionId;
+			nextConnectionId += library->workers.size();
+
+			connectionSockets[connection.connectionId] = socket;
+		}
+
+		void dispatchRequest(cConnection& connection,
+		                     const char* data)
+		{
+			dispatchingConnection = &connection;
+			library->dispatchRequest(workerId, connection, data, bodyBuffer);
+			dispatchingConnection = nullptr;
+		}
+
+		void dispatchBody(cConnection& connection,
+		                  const char* data,
+		                  const size_t length)
+		{
+			bodyBuffer.assign((const uint8_t*)data, (const uint8_t*)data + length);
+
+			dispatchingConnection = &connection;
+			library->dispatchBody(workerId, connection, bodyBuffer);
+			dispatchingConnection = nullptr;
+		}
+
+		/** interim response, nothing else is pending while request is being read */
+		bool continueConnection(const int socket,
+		                        cConnection& connection)
+		{
+			if (!connection.request.expectContinue)
+			{
+				return true;
+			}
+
+			connection.request.expectContinue = false;
+			connection.out += "HTTP/1.1 100 Continue\r\n\r\n";
+
+			return writeConnection(socket, connection);
+		}
+
+		static void compactConnection(cConnection& connection)
+		{
+			if (connection.inPosition)
+			{
+				connection.in.erase(0, connection.inPosition);
+				connection.inPosition = 0;
+			}
+		}
+
+		bool writeConnection(const int socket,
+		                     cConnection& connection)
+		{
+			if (connection.writeFailed)
+			{
+				return false;
+			}
+
+			while (connection.outPosition < connection.out.size())
+			{
+				const ssize_t sendLength = send(socket,
+				                                connection.out.data() + connection.outPosition,
+				                                connection.out.size() - connection.outPosition,
+				                                MSG_NOSIGNAL);
+				if (sendLength < 0)
+				{
+					if (errno == EAGAIN ||
+					    errno == EWOULDBLOCK)
+					{
+						return true;
+					}
+
+					if (errno == EINTR)
+					{
+						continue;
+					}
+
+					return false;
+				}
+
+				connection.outPosition += sendLength;
+			}
+
+			return connection.writeFile();
+		}
 
-class cHttpServer : public cLibrary
-{
-public:
-	using tIpAddress = uint32_t;
-	using tBoolean = bool;
-	using tString = std::string;
-	using tBuffer = cVirtualMachine::tBuffer;
+		void closeConnection(const int socket)
+		{
+			auto iter = connections.find(socket);
+			if (iter != connections.end() &&
+			    iter->second.state == eConnectionState::readBody)
+			{
+				/** body is not complete */
+				dispatchBody(iter->second, nullptr, 0);
+			}
 
-public:
-	cHttpServer(const std::string& ipAddress,
-	            const uint16_t port) :
-	        ipAddress(ipAddress),
-	        port(port)
-	{
-		serverSocket = -1;
-		clientSocket = -1;
-	}
+			epoll_ctl(epollFd, EPOLL_CTL_DEL, socket, nullptr);
+			close(socket);
 
-	bool registerLibrary() override
-	{
-		setLibraryName("httpServer");
+			if (iter != connections.end())
+			{
+				connectionSockets.erase(iter->second.connectionId);
+				connections.erase(iter);
+			}
+		}
 
-		if (!registerMemory<tIpAddress>("ipAddress",
-		                                0))
+		void closeConnections()
 		{
-			return false;
+			for (auto& iter : connections)
+			{
+				close(iter.first);
+			}
+			connections.clear();
+			connectionSockets.clear();
 		}
 
-		if (!registerMemoryModule("ipAddress",
-		                          new cLogicConvert<tIpAddress,
-		                                            tString>("toString",
-		                                                     "ipAddress",
-		                                                     "string",
-			[](tIpAddress* from, tString* to)
-			{
-				char ipAddressStr[16];
-				snprintf(ipAddressStr, 16, "%u.%u.%u.%u",
-				         ((*from) & 0xFF),
-				         (((*from) >> 8) & 0xFF),
-				         (((*from) >> 16) & 0xFF),
-				         (((*from) >> 24) & 0xFF));
-				*to = ipAddressStr;
-			})))
+		void closeIdleConnections(const time_t currentTime)
 		{
-			return false;
+			auto iter = connections.begin();
+			while (iter != connections.end())
+			{
+				auto next = std::next(iter);
+				cConnection& connection = iter->second;
+
+				if (connection.state == eConnectionState::waitResponse)
+				{
+					if (currentTime - connection.lastActivity >= responseTimeout)
+					{
+						cResponse response;
+						response.status = "504 Gateway Timeout";
+
+						connection.keepAlive = false;
+						if (!completeResponse(iter->first, connection, response))
+						{
+							closeConnection(iter->first);
+						}
+					}
+				}
+				else if (currentTime - connection.lastActivity >= keepAliveTimeout)
+				{
+					closeConnection(iter->first);
+				}
+
+				iter = next;
+			}
 		}
 
-		if (!registerRootModules(rootGet,
-		                         rootPost))
+		bool epollControl(const int operation,
+		                  const int socket,
+		                  const uint32_t events)
 		{
-			return false;
+			struct epoll_event event;
+			memset(&event, 0, sizeof(event));
+			event.events = events;
+			event.data.fd = socket;
+
+			return (epoll_ctl(epollFd, operation, socket, &event) == 0);
 		}
 
-		if (!registerModules(new cLogicOk(this),
-		                     new cLogicNotFound(this)))
+	private:
+		cHttpServer* library;
+		const unsigned int workerId;
+
+		int serverSocket;
+		int epollFd;
+		int wakeupEventFd; ///< stop and pushed responses
+		pthread_t thread;
+		std::atomic<std::thread::id> threadId; ///< set by worker thread, read by modules of any thread
+
+		std::map<int, cConnection> connections;
+		std::map<tInteger, int> connectionSockets; ///< connectionId of current request: socket
+		tInteger nextConnectionId;
+		cConnection* dispatchingConnection; ///< request being executed by root signal
+		tBuffer bodyBuffer; ///< post body or chunk, capacity is reused
+
+		std::mutex responsesMutex;
+		std::vector<cResponse> responses; ///< pushed by modules of other threads
+	};
+
+	/** root events of all workers are serialized: root memories are shared */
+	void dispatchRequest(const unsigned int workerId,
+	                     cConnection& connection,
+	                     const char* data,
+	                     tBuffer& bodyBuffer)
+	{
+		const cRequest& request = connection.request;
+
+		if (cRequest::equals(data, request.method, "GET"))
 		{
-			return false;
+			cRequestMemory requestMemory;
+			getRequestMemory(data, request, false, requestMemory);
+
+			std::lock_guard<std::mutex> guard(dispatchMutex);
+
+			rootSetMemory(rootGet.memoryWorkerId, (tInteger)workerId);
+			rootSetMemory(rootGet.memoryConnectionId, connection.connectionId);
+			rootSetMemory(rootGet.memoryFromIpAddress, connection.ipAddress);
+			rootSetMemory(rootGet.memoryHost, requestMemory.host);
+			rootSetMemory(rootGet.memoryUrl, requestMemory.url);
+			rootSetMemory(rootGet.memoryArguments, requestMemory.arguments);
+			rootSetMemory(rootGet.memoryFullUrl, requestMemory.fullUrl);
+			rootSignalFlow(rootGet.signal);
 		}
+		else if (cRequest::equals(data, request.method, "POST"))
+		{
+			cRequestMemory requestMemory;
+			getRequestMemory(data, request, true, requestMemory);
 
-		return true;
+			const cRequest::cToken body = request.getBody();
+			bodyBuffer.assign((const uint8_t*)data + body.offset, (const uint8_t*)data + body.offset + body.length);
+
+			std::lock_guard<std::mutex> guard(dispatchMutex);
+
+			setPostMemory(workerId, connection, requestMemory);
+			rootSetMemory(rootPost.memoryBuffer, bodyBuffer);
+			rootSignalFlow(rootPost.signal);
+		}
 	}
 
-	bool init() override
+	/** part of streamed post body, empty after last part */
+	void dispatchBody(const unsigned int workerId,
+	                  cConnection& connection,
+	                  const tBuffer& body)
+	{
+		std::lock_guard<std::mutex> guard(dispatchMutex);
+
+		setPostMemory(workerId, connection, connection.bodyRequest);
+		rootSetMemory(rootPost.memoryBuffer, body);
+		rootSignalFlow(body.size() ? rootPost.signalChunk : rootPost.signalEnd);
+	}
+
+	void setPostMemory(const unsigned int workerId,
+	                   const cConnection& connection,
+	                   const cRequestMemory& requestMemory)
+	{
+		rootSetMemory(rootPost.memoryWorkerId, (tInteger)workerId);
+		rootSetMemory(rootPost.memoryConnectionId, connection.connectionId);
+		rootSetMemory(rootPost.memoryFromIpAddress, connection.ipAddress);
+		rootSetMemory(rootPost.memoryHost, requestMemory.host);
+		rootSetMemory(rootPost.memoryUrl, requestMemory.url);
+		rootSetMemory(rootPost.memoryArguments, requestMemory.arguments);
+		rootSetMemory(rootPost.memoryFullUrl, requestMemory.fullUrl);
+		rootSetMemory(rootPost.memoryHeaders, requestMemory.headers);
+	}
+
+	static void getRequestMemory(const char* data,
+	                             const cRequest& request,
+	                             const bool withHeaders,
+	                             cRequestMemory& requestMemory)
 	{
-		serverSocket = socket(PF_INET, SOCK_STREAM, 0);
-		if (serverSocket < 0)
+		requestMemory.host = cRequest::toString(data, request.getHeader(data, "host"));
+		requestMemory.url = cRequest::decode(data, request.path, false);
+		requestMemory.fullUrl = cRequest::toString(data, request.target);
+
+		size_t position = request.query.offset;
+		const size_t end = request.query.offset + request.query.length;
+		while (position < end)
 		{
-			serverSocket = -1;
-			return false;
+			const char* argumentEnd = (const char*)memchr(data + position, '&', end - position);
+			const size_t argumentLength = argumentEnd ? argumentEnd - data - position : end - position;
+
+			const char* separator = (const char*)memchr(data + position, '=', argumentLength);
+			if (separator)
+			{
+				const size_t nameLength = separator - data - position;
+				const cRequest::cToken name(position, nameLength);
+				const cRequest::cToken value(position + nameLength + 1, argumentLength - nameLength - 1);
+
+				requestMemory.arguments[cRequest::decode(data, name, true)] = cRequest::decode(data, value, true);
+			}
+
+			position += argumentLength + 1;
 		}
 
-		if (fcntl(serverSocket, F_GETFL) & O_NONBLOCK)
+		if (withHeaders)
 		{
-			if (fcntl(serverSocket, F_SETFL, fcntl(serverSocket, F_GETFL) & (~O_NONBLOCK)) < 0)
+			/** header names are case-insensitive: lower case keys */
+			for (unsigned int header_i = 0; header_i < request.headersCount; header_i++)
 			{
-				return false;
+				tString name = cRequest::toString(data, request.headers[header_i].name);
+				for (char& c : name)
+				{
+					c = tolower((unsigned char)c);
+				}
+
+				requestMemory.headers[name] = cRequest::toString(data, request.headers[header_i].value);
 			}
 		}
+	}
+
+	static struct iovec makeIovec(const void* data,
+	                              const size_t length)
+	{
+		struct iovec result;
+		result.iov_base = const_cast<void*>(data);
+		result.iov_len = length;
+		return result;
+	}
+
+	static struct iovec notFoundContent()
+	{
+		static const char content[] = "<HTML>"
+		                              "<HEAD><TITLE>404 Not Found</TITLE></HEAD>"
+		                              "<BODY><CENTER><H1>404 Not Found</H1></CENTER></BODY>"
+		                              "</HTML>";
+
+		return makeIovec(content, sizeof(content) - 1);
+	}
 
-		int one = 1;
-		if (setsockopt(serverSocket, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) < 0)
+	static void responseNotFound(cConnection* connection)
+	{
+		const struct iovec contents[] = {notFoundContent()};
+		connection->response("404 Not Found", contents, 1);
+	}
+
+	cWorker* getWorker(const tInteger connectionId) const
+	{
+		if (connectionId <= 0)
 		{
-			return false;
+			return nullptr;
 		}
 
-		return true;
+		return workers[connectionId % workers.size()].get();
 	}
 
-	void run() override
+	/** ok/notFound without connectionId answer request executed by calling worker thread */
+	tInteger getCurrentConnectionId() const
 	{
-		struct sockaddr_in address;
-		memset((char*)&address, 0, sizeof(struct sockaddr_in));
-		address.sin_family = PF_INET;
-		address.sin_addr.s_addr = inet_addr(ipAddress.c_str());
-		address.sin_port = htons(port);
+		for (auto& worker : workers)
+		{
+			if (worker->isCurrentThread())
+			{
+				return worker->getCurrentConnectionId();
+			}
+		}
+
+		return 0;
+	}
 
-		if (bind(serverSocket, (struct sockaddr*)&address, sizeof(address)) < 0)
+	/** request executed by calling worker is answered directly from scheme memories,
+	 *  other requests (answer after curl, timer, ...) are copied to queue of their worker */
+	void response(const tInteger connectionId,
+	              const char* status,
+	              const struct iovec* contents,
+	              const unsigned int contentsCount)
+	{
+		cWorker* worker = getWorker(connectionId);
+		if (!worker)
 		{
 			return;
 		}
 
-		if (listen(serverSocket, 64) < 0)
+		cConnection* connection = worker->getDispatchingConnection(connectionId);
+		if (connection)
 		{
+			connection->response(status, contents, contentsCount);
 			return;
 		}
 
-		while (!isStopped())
+		cResponse response;
+		response.connectionId = connectionId;
+		response.status = status;
+		for (unsigned int content_i = 0; content_i < contentsCount; content_i++)
 		{
-			struct sockaddr_in address;
-			socklen_t addressLength = sizeof(address);
-			clientSocket = accept(serverSocket, (struct sockaddr*)&address, &addressLength);
-			if (clientSocket < 0)
+			if (contents[content_i].iov_len)
 			{
-				continue;
+				response.content.append((const char*)contents[content_i].iov_base, contents[content_i].iov_len);
 			}
+		}
 
-			std::string request;
-			for (;;)
-			{
-				char buffer[8192];
-
-				int recvLength = recv(clientSocket, buffer, sizeof(buffer), MSG_NOSIGNAL);
-				if (recvLength <= 0)
-				{
-					break;
-				}
+		worker->pushResponse(std::move(response));
+	}
 
-				request.insert(request.length(), buffer, recvLength);
-				if (request.substr(request.length() - 4, 4) == "\r\n\r\n")
-				{
-					break;
-				}
-			}
+	void responseFile(const tInteger connectionId,
+	                  const char* status,
+	                  const tString& file)
+	{
+		cWorker* worker = getWorker(connectionId);
+		if (!worker)
+		{
+			return;
+		}
 
-			if (request.substr(0, 3) == "GET")
+		cConnection* connection = worker->getDispatchingConnection(connectionId);
+		if (connection)
+		{
+			if (!connection->responseFile(status, file.c_str()))
 			{
-				std::map<tString, tString> arguments;
-
-				tString host = request.substr(request.find("Host: ") + 6);
-				host = host.substr(0, host.find("\r\n"));
-				tString url = request.substr(4);
-				url = url.substr(0, url.find("\r\n") - 9);
-				tString fullUrl = url;
-
-				tString urlArguments = url;
-				if (url.find('?') != tString::npos)
-				{
-					urlArguments = urlArguments.substr(url.find('?') + 1);
-					while (urlArguments.length())
-					{
-						tString argument;
-
-						if (urlArguments.find('&') != tString::npos)
-						{
-							argument = urlArguments.substr(0, urlArguments.find('&'));
-							urlArguments = urlArguments.substr(urlArguments.find('&') + 1);
-						}
-						else
-						{
-							argument = urlArguments;
-							urlArguments.clear();
-						}
-
-						if (argument.find('=') != tString::npos)
-						{
-							const tString argumentName = argument.substr(0, argument.find('='));
-							const tString argumentValue = argument.substr(argument.find('=') + 1);
+				responseNotFound(connection);
+			}
+			return;
+		}
 
-							arguments[argumentName] = argumentValue;
-						}
-					}
+		cResponse response;
+		response.connectionId = connectionId;
+		response.status = status;
+		response.file = file;
 
-					url = url.substr(0, url.find('?'));
-				}
+		worker->pushResponse(std::move(response));
+	}
 
-				rootSetMemory(rootGet.memoryFromIpAddress, address.sin_addr.s_addr);
-				rootSetMemory(rootGet.memoryHost, host);
-				rootSetMemory(rootGet.memoryUrl, url);
-				rootSetMemory(rootGet.memoryArguments, arguments);
-				rootSetMemory(rootGet.memoryFullUrl, fullUrl);
-				rootSignalFlow(rootGet.signal);
-			}
-			else if (request.substr(0, 4) == "POST")
-			{
-				/** @todo */
-			}
+	void responseNotFound(const tInteger connectionId)
+	{
+		const struct iovec contents[] = {notFoundContent()};
+		response(connectionId, "404 Not Found", contents, 1);
+	}
 
-			close(clientSocket);
-			clientSocket = -1;
-		}
+	static time_t getMonotonicTime()
+	{
+		struct timespec currentTime;
+		clock_gettime(CLOCK_MONOTONIC, &currentTime);
+		return currentTime.tv_sec;
 	}
 
-	void stop() override
+	static void closeSocket(int& socket)
 	{
-		if (serverSocket != -1)
+		if (socket != -1)
 		{
-			shutdown(serverSocket, SHUT_RDWR);
-			close(serverSocket);
-			serverSocket = -1;
+			close(socket);
+			socket = -1;
 		}
 	}
 
 private:
+	constexpr static int epollEventsSize = 256;
+	constexpr static size_t requestHeaderMaxSize = 16384;
+	constexpr static unsigned int responseIovecsMaxCount = 8;
+	constexpr static time_t keepAliveTimeout = 30;
+	constexpr static time_t responseTimeout = 30; ///< request without answer gets "504 Gateway Timeout"
+
 	const std::string ipAddress;
 	const uint16_t port;
-	int serverSocket;
-	int clientSocket;
+	const size_t bodyChunkSize; ///< larger request bodies are passed to scheme in parts
+
+	std::vector<std::unique_ptr<cWorker>> workers;
+
+	std::mutex dispatchMutex;
 
 private: /** rootModules */
 	class cRootGet : public cRootModule
@@ -241,6 +1921,16 @@ private: /** rootModules */
 				return false;
 			}
 
+			if (!registerMemoryExit("workerId", "integer", memoryWorkerId))
+			{
+				return false;
+			}
+
+			if (!registerMemoryExit("connectionId", "integer", memoryConnectionId))
+			{
+				return false;
+			}
+
 			if (!registerMemoryExit("fromIpAddress", "ipAddress", memoryFromIpAddress))
 			{
 				return false;
@@ -270,6 +1960,8 @@ private: /** rootModules */
 		}
 
 		tRootSignalExitId signal;
+		tRootMemoryExitId memoryWorkerId;
+		tRootMemoryExitId memoryConnectionId; ///< ok/notFound answer this request, also after signal
 		tRootMemoryExitId memoryFromIpAddress;
 		tRootMemoryExitId memoryHost;
 		tRootMemoryExitId memoryUrl;
@@ -289,12 +1981,76 @@ private: /** rootModules */
 				return false;
 			}
 
-			/** @todo */
+			if (!registerSignalExit("chunk", signalChunk))
+			{
+				return false;
+			}
+
+			if (!registerSignalExit("end", signalEnd))
+			{
+				return false;
+			}
+
+			if (!registerMemoryExit("workerId", "integer", memoryWorkerId))
+			{
+				return false;
+			}
+
+			if (!registerMemoryExit("connectionId", "integer", memoryConnectionId))
+			{
+				return false;
+			}
+
+			if (!registerMemoryExit("fromIpAddress", "ipAddress", memoryFromIpAddress))
+			{
+				return false;
+			}
+
+			if (!registerMemoryExit("host", "string", memoryHost))
+			{
+				return false;
+			}
+
+			if (!registerMemoryExit("url", "string", memoryUrl))
+			{
+				return false;
+			}
+
+			if (!registerMemoryExit("arguments", "map<string,string>", memoryArguments))
+			{
+				return false;
+			}
+
+			if (!registerMemoryExit("fullUrl", "string", memoryFullUrl))
+			{
+				return false;
+			}
+
+			if (!registerMemoryExit("headers", "map<string,string>", memoryHeaders))
+			{
+				return false;
+			}
+
+			if (!registerMemoryExit("buffer", "buffer", memoryBuffer))
+			{
+				return false;
+			}
 
 			return true;
 		}
 
-		tRootSignalExitId signal;
+		tRootSignalExitId signal; ///< whole body in buffer
+		tRootSignalExitId signalChunk; ///< body larger than bodyChunkSize: next part in buffer
+		tRootSignalExitId signalEnd; ///< after last chunk, or when rest of body is dropped (answer, close). buffer is empty
+		tRootMemoryExitId memoryWorkerId;
+		tRootMemoryExitId memoryConnectionId; ///< ok/notFound answer this request, also after signal
+		tRootMemoryExitId memoryFromIpAddress;
+		tRootMemoryExitId memoryHost;
+		tRootMemoryExitId memoryUrl;
+		tRootMemoryExitId memoryArguments;
+		tRootMemoryExitId memoryFullUrl;
+		tRootMemoryExitId memoryHeaders;
+		tRootMemoryExitId memoryBuffer;
 	};
 
 private:
@@ -339,41 +2095,49 @@ private: /** modules */
 				return false;
 			}
 
+			if (!registerMemoryEntry("file", "string", file))
+			{
+				return false;
+			}
+
+			if (!registerMemoryEntry("connectionId", "integer", connectionId))
+			{
+				return false;
+			}
+
 			return true;
 		}
 
 	private: /** signalEntries */
 		bool signalEntry()
 		{
-			std::string response;
-			response = "HTTP/1.1 200 OK\r\nServer: tvm/library/httpserver\r\n\r\n";
+			const tInteger id = connectionId ? *connectionId : library->getCurrentConnectionId();
 
-			if (buffer)
+			if (file &&
+			    !file->empty())
 			{
-				size_t position = response.size();
-				response.resize(response.size() + buffer->size());
-				memcpy(&response[position], buffer->data(), buffer->size());
+				library->responseFile(id, "200 OK", *file);
+				return true;
 			}
-			else
-			{
-				response += "<HTML>";
-				response += "<HEAD><TITLE>";
-				if (title)
-				{
-					response += *title;
-				}
-				response += "</TITLE></HEAD>";
 
-				response += "<BODY>";
-				if (body)
-				{
-					response += *body;
-				}
-				response += "</BODY>";
-				response += "</HTML>";
+			if (buffer)
+			{
+				const struct iovec contents[] = {makeIovec(buffer->data(), buffer->size())};
+				library->response(id, "200 OK", contents, 1);
+				return true;
 			}
 
-			send(library->clientSocket, response.c_str(), response.length(), MSG_NOSIGNAL);
+			static const char htmlBegin[] = "<HTML><HEAD><TITLE>";
+			static const char htmlTitleEnd[] = "</TITLE></HEAD><BODY>";
+			static const char htmlEnd[] = "</BODY></HTML>";
+
+			const struct iovec contents[] = {makeIovec(htmlBegin, sizeof(htmlBegin) - 1),
+			                                 makeIovec(title ? title->data() : nullptr, title ? title->size() : 0),
+			                                 makeIovec(htmlTitleEnd, sizeof(htmlTitleEnd) - 1),
+			                                 makeIovec(body ? body->data() : nullptr, body ? body->size() : 0),
+			                                 makeIovec(htmlEnd, sizeof(htmlEnd) - 1)};
+
+			library->response(id, "200 OK", contents, 5);
 
 			return true;
 		}
@@ -385,6 +2149,8 @@ private: /** modules */
 		tString* title;
 		tString* body;
 		tBuffer* buffer;
+		tString* file;
+		tInteger* connectionId; ///< not connected: request executed by current worker
 	};
 
 	class cLogicNotFound : public cLogicModule
@@ -409,27 +2175,27 @@ private: /** modules */
 				return false;
 			}
 
+			if (!registerMemoryEntry("connectionId", "integer", connectionId))
+			{
+				return false;
+			}
+
 			return true;
 		}
 
 	private: /** signalEntries */
 		bool signalEntry()
 		{
-			std::string response;
-			response = "HTTP/1.1 404 Not Found\r\nServer: tvm/library/httpserver\r\n\r\n";
-
-			response += "<HTML>";
-			response += "<HEAD><TITLE>404 Not Found</TITLE></HEAD>";
-			response += "<BODY><CENTER><H1>404 Not Found</H1></CENTER></BODY>";
-			response += "</HTML>";
-
-			send(library->clientSocket, response.c_str(), response.length(), MSG_NOSIGNAL);
+			library->responseNotFound(connectionId ? *connectionId : library->getCurrentConnectionId());
 
 			return true;
 		}
 
 	private:
 		cHttpServer* library;
+
+	private:
+		tInteger* connectionId;
 	};
 };
 
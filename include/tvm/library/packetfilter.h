@@ -0,0 +1,1037 @@
+// Copyright © 2017, Timur Aitov. Contacts: timonbl4@gmail.com. All rights reserved
+
+#ifndef TVM_LIBRARY_PACKETFILTER_H
+#define TVM_LIBRARY_PACKETFILTER_H
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <functional>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <linux/if_ether.h>
+#include <linux/filter.h>
+
+namespace nVirtualMachine
+{
+
+namespace nLibrary
+{
+
+/** compiles filter expression to classic BPF: attached to socket (SO_ATTACH_FILTER) or executed by match()
+ *
+ *  expression: primitives combined with "and" ("&&"), "or" ("||"), "not" ("!") and parentheses
+ *  primitives:
+ *    ether src|dst|host <xx:xx:xx:xx:xx:xx>, ether proto <number>, ether broadcast, ether multicast
+ *    ip, ip6, arp, vlan, tcp, udp, icmp, ip proto <number>
+ *    [src|dst] host <a.b.c.d>, [src|dst] net <a.b.c.d/len>
+ *    [tcp|udp] [src|dst] port <number>
+ *    less <length>, greater <length>
+ *  host, net and port match IPv4 only (untagged frames) */
+class cPacketFilter
+{
+public:
+	cPacketFilter()
+	{
+	}
+
+	/** empty expression: filter accepts everything, nothing to attach */
+	bool compile(const std::string& expression)
+	{
+		code.clear();
+		labels.clear();
+		program.clear();
+		tokens.clear();
+		tokenPosition = 0;
+
+		if (!tokenize(expression))
+		{
+			return false;
+		}
+
+		if (tokens.empty())
+		{
+			return true;
+		}
+
+		std::unique_ptr<cNode> node = parseOr();
+		if ((!node) ||
+		    tokenPosition != tokens.size())
+		{
+			return false;
+		}
+
+		const int labelTrue = newLabel();
+		const int labelFalse = newLabel();
+
+		generate(node.get(), labelTrue, labelFalse);
+
+		placeLabel(labelTrue);
+		emit(BPF_RET | BPF_K, labelNext, labelNext, snapLength);
+		placeLabel(labelFalse);
+		emit(BPF_RET | BPF_K, labelNext, labelNext, 0);
+
+		return resolve();
+	}
+
+	bool isEmpty() const
+	{
+		return program.empty();
+	}
+
+	bool attach(const int socket) const
+	{
+		if (program.empty())
+		{
+			return true;
+		}
+
+		struct sock_fprog fprog;
+		fprog.len = program.size();
+		fprog.filter = (struct sock_filter*)program.data();
+
+		return (setsockopt(socket, SOL_SOCKET, SO_ATTACH_FILTER, &fprog, sizeof(fprog)) == 0);
+	}
+
+	/** userspace interpreter, same result as kernel for programs built by compile() */
+	bool match(const uint8_t* data,
+	           const uint32_t size) const
+	{
+		if (program.empty())
+		{
+			return true;
+		}
+
+		uint32_t a = 0;
+		uint32_t x = 0;
+		uint32_t memory[BPF_MEMWORDS] = {0};
+
+		for (size_t pc = 0; pc < program.size(); pc++)
+		{
+			const struct sock_filter& instruction = program[pc];
+			const uint32_t k = instruction.k;
+
+			switch (instruction.code)
+			{
+				case BPF_LD | BPF_W | BPF_ABS:
+				case BPF_LD | BPF_H | BPF_ABS:
+				case BPF_LD | BPF_B | BPF_ABS:
+				case BPF_LD | BPF_W | BPF_IND:
+				case BPF_LD | BPF_H | BPF_IND:
+				case BPF_LD | BPF_B | BPF_IND:
+				{
+					const uint64_t offset = (uint64_t)k + ((BPF_MODE(instruction.code) == BPF_IND) ? x : 0);
+					if (!load(data, size, offset, BPF_SIZE(instruction.code), a))
+					{
+						return false;
+					}
+					break;
+				}
+				case BPF_LD | BPF_W | BPF_LEN:
+					a = size;
+					break;
+				case BPF_LDX | BPF_W | BPF_LEN:
+					x = size;
+					break;
+				case BPF_LD | BPF_IMM:
+					a = k;
+					break;
+				case BPF_LDX | BPF_IMM:
+					x = k;
+					break;
+				case BPF_LD | BPF_MEM:
+					a = memory[k % BPF_MEMWORDS];
+					break;
+				case BPF_LDX | BPF_MEM:
+					x = memory[k % BPF_MEMWORDS];
+					break;
+				case BPF_LDX | BPF_B | BPF_MSH:
+					if (k >= size)
+					{
+						return false;
+					}
+					x = 4 * (data[k] & 0x0F);
+					break;
+				case BPF_ST:
+					memory[k % BPF_MEMWORDS] = a;
+					break;
+				case BPF_STX:
+					memory[k % BPF_MEMWORDS] = x;
+					break;
+				case BPF_ALU | BPF_ADD | BPF_K:
+					a += k;
+					break;
+				case BPF_ALU | BPF_SUB | BPF_K:
+					a -= k;
+					break;
+				case BPF_ALU | BPF_AND | BPF_K:
+					a &= k;
+					break;
+				case BPF_ALU | BPF_OR | BPF_K:
+					a |= k;
+					break;
+				case BPF_ALU | BPF_LSH | BPF_K:
+					a <<= (k & 31);
+					break;
+				case BPF_ALU | BPF_RSH | BPF_K:
+					a >>= (k & 31);
+					break;
+				case BPF_ALU | BPF_ADD | BPF_X:
+					a += x;
+					break;
+				case BPF_ALU | BPF_AND | BPF_X:
+					a &= x;
+					break;
+				case BPF_ALU | BPF_NEG:
+					a = -a;
+					break;
+				case BPF_JMP | BPF_JA:
+					pc += k;
+					break;
+				case BPF_JMP | BPF_JEQ | BPF_K:
+					pc += (a == k) ? instruction.jt : instruction.jf;
+					break;
+				case BPF_JMP | BPF_JGT | BPF_K:
+					pc += (a > k) ? instruction.jt : instruction.jf;
+					break;
+				case BPF_JMP | BPF_JGE | BPF_K:
+					pc += (a >= k) ? instruction.jt : instruction.jf;
+					break;
+				case BPF_JMP | BPF_JSET | BPF_K:
+					pc += (a & k) ? instruction.jt : instruction.jf;
+					break;
+				case BPF_JMP | BPF_JEQ | BPF_X:
+					pc += (a == x) ? instruction.jt : instruction.jf;
+					break;
+				case BPF_RET | BPF_K:
+					return k != 0;
+				case BPF_RET | BPF_A:
+					return a != 0;
+				case BPF_MISC | BPF_TAX:
+					x = a;
+					break;
+				case BPF_MISC | BPF_TXA:
+					a = x;
+					break;
+				default:
+					return false;
+			}
+		}
+
+		return false;
+	}
+
+private:
+	/** jump targets are labels until resolve() */
+	class cInstruction
+	{
+	public:
+		uint16_t code;
+		int labelTrue;
+		int labelFalse;
+		uint32_t k;
+	};
+
+	class cNode
+	{
+	public:
+		enum class eType
+		{
+			primitive,
+			conjunction,
+			disjunction,
+			negation
+		};
+
+		using tGenerate = std::function<void(const int labelTrue, const int labelFalse)>;
+
+	public:
+		cNode(const eType type) :
+		        type(type)
+		{
+		}
+
+	public:
+		eType type;
+		std::unique_ptr<cNode> left;
+		std::unique_ptr<cNode> right;
+		tGenerate generate;
+	};
+
+	enum class eDirection
+	{
+		source,
+		destination,
+		any
+	};
+
+private: /** parser */
+	bool tokenize(const std::string& expression)
+	{
+		size_t position = 0;
+		while (position < expression.size())
+		{
+			const char symbol = expression[position];
+
+			if (symbol == ' ' || symbol == '\t' || symbol == '\n')
+			{
+				position++;
+				continue;
+			}
+
+			if (symbol == '(' || symbol == ')' || symbol == '!')
+			{
+				tokens.emplace_back(1, symbol);
+				position++;
+				continue;
+			}
+
+			if ((symbol == '&' || symbol == '|') &&
+			    position + 1 < expression.size() &&
+			    expression[position + 1] == symbol)
+			{
+				tokens.emplace_back(symbol == '&' ? "and" : "or");
+				position += 2;
+				continue;
+			}
+
+			if (symbol == '&' || symbol == '|')
+			{
+				return false;
+			}
+
+			const size_t end = expression.find_first_of(" \t\n()!&|", position);
+			tokens.emplace_back(expression.substr(position, end - position));
+			position = (end == std::string::npos) ? expression.size() : end;
+		}
+
+		return true;
+	}
+
+	bool accept(const char* token)
+	{
+		if (tokenPosition < tokens.size() &&
+		    tokens[tokenPosition] == token)
+		{
+			tokenPosition++;
+			return true;
+		}
+		return false;
+	}
+
+	bool next(std::string& token)
+	{
+		if (tokenPosition >= tokens.size())
+		{
+			return false;
+		}
+		token = tokens[tokenPosition++];
+		return true;
+	}
+
+	std::unique_ptr<cNode> parseOr()
+	{
+		std::unique_ptr<cNode> left = parseAnd();
+		while (left && accept("or"))
+		{
+			std::unique_ptr<cNode> node(new cNode(cNode::eType::disjunction));
+			node->left = std::move(left);
+			node->right = parseAnd();
+			if (!node->right)
+			{
+				return nullptr;
+			}
+			left = std::move(node);
+		}
+		return left;
+	}
+
+	std::unique_ptr<cNode> parseAnd()
+	{
+		std::unique_ptr<cNode> left = parseNot();
+		while (left && accept("and"))
+		{
+			std::unique_ptr<cNode> node(new cNode(cNode::eType::conjunction));
+			node->left = std::move(left);
+			node->right = parseNot();
+			if (!node->right)
+			{
+				return nullptr;
+			}
+			left = std::move(node);
+		}
+		return left;
+	}
+
+	std::unique_ptr<cNode> parseNot()
+	{
+		if (accept("not") || accept("!"))
+		{
+			std::unique_ptr<cNode> node(new cNode(cNode::eType::negation));
+			node->left = parseNot();
+			if (!node->left)
+			{
+				return nullptr;
+			}
+			return node;
+		}
+
+		if (accept("("))
+		{
+			std::unique_ptr<cNode> node = parseOr();
+			if (!accept(")"))
+			{
+				return nullptr;
+			}
+			return node;
+		}
+
+		return parsePrimitive();
+	}
+
+	std::unique_ptr<cNode> parsePrimitive()
+	{
+		std::unique_ptr<cNode> node(new cNode(cNode::eType::primitive));
+		std::string token;
+
+		if (accept("ether"))
+		{
+			if (accept("proto"))
+			{
+				uint32_t etherType;
+				if (!next(token) || !parseNumber(token, 0xFFFF, etherType))
+				{
+					return nullptr;
+				}
+				node->generate = [this, etherType](const int labelTrue, const int labelFalse)
+				{
+					generateEtherType(etherType, labelTrue, labelFalse);
+				};
+				return node;
+			}
+
+			if (accept("broadcast"))
+			{
+				node->generate = [this](const int labelTrue, const int labelFalse)
+				{
+					emitLoad(BPF_W, 2);
+					emitJump(BPF_JEQ, 0xFFFFFFFF, labelNext, labelFalse);
+					emitLoad(BPF_H, 0);
+					emitJump(BPF_JEQ, 0xFFFF, labelTrue, labelFalse);
+				};
+				return node;
+			}
+
+			if (accept("multicast"))
+			{
+				node->generate = [this](const int labelTrue, const int labelFalse)
+				{
+					emitLoad(BPF_B, 0);
+					emitJump(BPF_JSET, 0x01, labelTrue, labelFalse);
+				};
+				return node;
+			}
+
+			eDirection direction;
+			if (accept("src"))
+			{
+				direction = eDirection::source;
+			}
+			else if (accept("dst"))
+			{
+				direction = eDirection::destination;
+			}
+			else if (accept("host"))
+			{
+				direction = eDirection::any;
+			}
+			else
+			{
+				return nullptr;
+			}
+
+			uint8_t address[6];
+			if (!next(token) || !parseEthernetAddress(token, address))
+			{
+				return nullptr;
+			}
+
+			const uint32_t high = ((uint32_t)address[0] << 8) | address[1];
+			const uint32_t low = ((uint32_t)address[2] << 24) | ((uint32_t)address[3] << 16) | ((uint32_t)address[4] << 8) | address[5];
+
+			node->generate = [this, direction, high, low](const int labelTrue, const int labelFalse)
+			{
+				if (direction != eDirection::destination)
+				{
+					const int labelOther = (direction == eDirection::any) ? newLabel() : labelFalse;
+					generateEthernetAddress(6, high, low, labelTrue, labelOther);
+					if (direction == eDirection::any)
+					{
+						placeLabel(labelOther);
+					}
+				}
+				if (direction != eDirection::source)
+				{
+					generateEthernetAddress(0, high, low, labelTrue, labelFalse);
+				}
+			};
+			return node;
+		}
+
+		if (accept("ip"))
+		{
+			if (accept("proto"))
+			{
+				uint32_t protocol;
+				if (!next(token) || !parseNumber(token, 0xFF, protocol))
+				{
+					return nullptr;
+				}
+				node->generate = [this, protocol](const int labelTrue, const int labelFalse)
+				{
+					generateIpProtocol(protocol, labelTrue, labelFalse);
+				};
+				return node;
+			}
+
+			node->generate = [this](const int labelTrue, const int labelFalse)
+			{
+				generateEtherType(ETH_P_IP, labelTrue, labelFalse);
+			};
+			return node;
+		}
+
+		if (accept("ip6"))
+		{
+			node->generate = [this](const int labelTrue, const int labelFalse)
+			{
+				generateEtherType(ETH_P_IPV6, labelTrue, labelFalse);
+			};
+			return node;
+		}
+
+		if (accept("arp"))
+		{
+			node->generate = [this](const int labelTrue, const int labelFalse)
+			{
+				generateEtherType(ETH_P_ARP, labelTrue, labelFalse);
+			};
+			return node;
+		}
+
+		if (accept("vlan"))
+		{
+			node->generate = [this](const int labelTrue, const int labelFalse)
+			{
+				generateEtherType(ETH_P_8021Q, labelTrue, labelFalse);
+			};
+			return node;
+		}
+
+		if (accept("icmp"))
+		{
+			node->generate = [this](const int labelTrue, const int labelFalse)
+			{
+				generateIpProtocol(IPPROTO_ICMP, labelTrue, labelFalse);
+			};
+			return node;
+		}
+
+		if (accept("less") || accept("greater"))
+		{
+			const bool less = tokens[tokenPosition - 1] == "less";
+			uint32_t length;
+			if (!next(token) || !parseNumber(token, 0xFFFFFFFF, length))
+			{
+				return nullptr;
+			}
+			node->generate = [this, less, length](const int labelTrue, const int labelFalse)
+			{
+				emit(BPF_LD | BPF_W | BPF_LEN, labelNext, labelNext, 0);
+				if (less)
+				{
+					emitJump(BPF_JGT, length, labelFalse, labelTrue);
+				}
+				else
+				{
+					emitJump(BPF_JGE, length, labelTrue, labelFalse);
+				}
+			};
+			return node;
+		}
+
+		/** [tcp|udp] [src|dst] port, [src|dst] host, [src|dst] net */
+		uint32_t protocol = 0;
+		if (accept("tcp"))
+		{
+			protocol = IPPROTO_TCP;
+		}
+		else if (accept("udp"))
+		{
+			protocol = IPPROTO_UDP;
+		}
+
+		eDirection direction = eDirection::any;
+		if (accept("src"))
+		{
+			direction = eDirection::source;
+		}
+		else if (accept("dst"))
+		{
+			direction = eDirection::destination;
+		}
+
+		if (accept("port"))
+		{
+			uint32_t port;
+			if (!next(token) || !parseNumber(token, 0xFFFF, port))
+			{
+				return nullptr;
+			}
+			node->generate = [this, protocol, direction, port](const int labelTrue, const int labelFalse)
+			{
+				generatePort(protocol, direction, port, labelTrue, labelFalse);
+			};
+			return node;
+		}
+
+		if (protocol)
+		{
+			if (direction != eDirection::any)
+			{
+				return nullptr;
+			}
+			node->generate = [this, protocol](const int labelTrue, const int labelFalse)
+			{
+				generateIpProtocol(protocol, labelTrue, labelFalse);
+			};
+			return node;
+		}
+
+		const bool net = accept("net");
+		if (!net && !accept("host"))
+		{
+			return nullptr;
+		}
+
+		uint32_t address;
+		uint32_t mask = 0xFFFFFFFF;
+		if (!next(token))
+		{
+			return nullptr;
+		}
+		if (net)
+		{
+			const size_t slash = token.find('/');
+			if (slash != std::string::npos)
+			{
+				uint32_t prefixLength;
+				if (!parseNumber(token.substr(slash + 1), 32, prefixLength))
+				{
+					return nullptr;
+				}
+				mask = prefixLength ? (0xFFFFFFFF << (32 - prefixLength)) : 0;
+				token.resize(slash);
+			}
+		}
+		if (!parseIpAddress(token, address))
+		{
+			return nullptr;
+		}
+		address &= mask;
+
+		node->generate = [this, direction, address, mask](const int labelTrue, const int labelFalse)
+		{
+			generateEtherType(ETH_P_IP, labelNext, labelFalse);
+			if (direction != eDirection::destination)
+			{
+				emitLoad(BPF_W, 26);
+				emitMask(mask);
+				emitJump(BPF_JEQ, address, labelTrue, (direction == eDirection::any) ? labelNext : labelFalse);
+			}
+			if (direction != eDirection::source)
+			{
+				emitLoad(BPF_W, 30);
+				emitMask(mask);
+				emitJump(BPF_JEQ, address, labelTrue, labelFalse);
+			}
+		};
+		return node;
+	}
+
+	static bool parseNumber(const std::string& string,
+	                        const uint32_t maxValue,
+	                        uint32_t& value)
+	{
+		if (string.empty())
+		{
+			return false;
+		}
+
+		char* end;
+		const unsigned long long result = strtoull(string.c_str(), &end, 0);
+		if (*end ||
+		    result > maxValue)
+		{
+			return false;
+		}
+
+		value = result;
+		return true;
+	}
+
+	static bool parseEthernetAddress(const std::string& string,
+	                                 uint8_t (&address)[6])
+	{
+		unsigned int bytes[6];
+		char end;
+		if (sscanf(string.c_str(), "%x:%x:%x:%x:%x:%x%c",
+		           &bytes[0], &bytes[1], &bytes[2], &bytes[3], &bytes[4], &bytes[5], &end) != 6)
+		{
+			return false;
+		}
+
+		for (unsigned int byte_i = 0; byte_i < 6; byte_i++)
+		{
+			if (bytes[byte_i] > 0xFF)
+			{
+				return false;
+			}
+			address[byte_i] = bytes[byte_i];
+		}
+		return true;
+	}
+
+	static bool parseIpAddress(const std::string& string,
+	                           uint32_t& address)
+	{
+		struct in_addr inAddress;
+		if (inet_pton(AF_INET, string.c_str(), &inAddress) != 1)
+		{
+			return false;
+		}
+		address = ntohl(inAddress.s_addr);
+		return true;
+	}
+
+private: /** code generation, jumps are forward only: targets are placed after current node */
+	void generate(const cNode* node,
+	              const int labelTrue,
+	              const int labelFalse)
+	{
+		switch (node->type)
+		{
+			case cNode::eType::primitive:
+				node->generate(labelTrue, labelFalse);
+				break;
+			case cNode::eType::conjunction:
+			{
+				const int labelRight = newLabel();
+				generate(node->left.get(), labelRight, labelFalse);
+				placeLabel(labelRight);
+				generate(node->right.get(), labelTrue, labelFalse);
+				break;
+			}
+			case cNode::eType::disjunction:
+			{
+				const int labelRight = newLabel();
+				generate(node->left.get(), labelTrue, labelRight);
+				placeLabel(labelRight);
+				generate(node->right.get(), labelTrue, labelFalse);
+				break;
+			}
+			case cNode::eType::negation:
+				generate(node->left.get(), labelFalse, labelTrue);
+				break;
+		}
+	}
+
+	void generateEtherType(const uint32_t etherType,
+	                       const int labelTrue,
+	                       const int labelFalse)
+	{
+		emitLoad(BPF_H, 12);
+		emitJump(BPF_JEQ, etherType, labelTrue, labelFalse);
+	}
+
+	void generateEthernetAddress(const uint32_t offset,
+	                             const uint32_t high,
+	                             const uint32_t low,
+	                             const int labelTrue,
+	                             const int labelFalse)
+	{
+		emitLoad(BPF_W, offset + 2);
+		emitJump(BPF_JEQ, low, labelNext, labelFalse);
+		emitLoad(BPF_H, offset);
+		emitJump(BPF_JEQ, high, labelTrue, labelFalse);
+	}
+
+	void generateIpProtocol(const uint32_t protocol,
+	                        const int labelTrue,
+	                        const int labelFalse)
+	{
+		generateEtherType(ETH_P_IP, labelNext, labelFalse);
+		emitLoad(BPF_B, 23);
+		emitJump(BPF_JEQ, protocol, labelTrue, labelFalse);
+	}
+
+	/** protocol 0: tcp or udp */
+	void generatePort(const uint32_t protocol,
+	                  const eDirection direction,
+	                  const uint32_t port,
+	                  const int labelTrue,
+	                  const int labelFalse)
+	{
+		generateEtherType(ETH_P_IP, labelNext, labelFalse);
+
+		emitLoad(BPF_B, 23);
+		if (protocol)
+		{
+			emitJump(BPF_JEQ, protocol, labelNext, labelFalse);
+		}
+		else
+		{
+			const int labelProtocol = newLabel();
+			emitJump(BPF_JEQ, IPPROTO_TCP, labelProtocol, labelNext);
+			emitJump(BPF_JEQ, IPPROTO_UDP, labelProtocol, labelFalse);
+			placeLabel(labelProtocol);
+		}
+
+		/** not first fragment: no transport header */
+		emitLoad(BPF_H, 20);
+		emitJump(BPF_JSET, 0x1FFF, labelFalse, labelNext);
+
+		emit(BPF_LDX | BPF_B | BPF_MSH, labelNext, labelNext, 14);
+
+		if (direction != eDirection::destination)
+		{
+			emit(BPF_LD | BPF_H | BPF_IND, labelNext, labelNext, 14);
+			emitJump(BPF_JEQ, port, labelTrue, (direction == eDirection::any) ? labelNext : labelFalse);
+		}
+		if (direction != eDirection::source)
+		{
+			emit(BPF_LD | BPF_H | BPF_IND, labelNext, labelNext, 16);
+			emitJump(BPF_JEQ, port, labelTrue, labelFalse);
+		}
+	}
+
+	int newLabel()
+	{
+		labels.push_back(-1);
+		return labels.size() - 1;
+	}
+
+	void placeLabel(const int label)
+	{
+		labels[label] = code.size();
+	}
+
+	void emit(const uint16_t instructionCode,
+	          const int labelTrue,
+	          const int labelFalse,
+	          const uint32_t k)
+	{
+		code.push_back({instructionCode, labelTrue, labelFalse, k});
+	}
+
+	void emitLoad(const uint16_t size,
+	              const uint32_t offset)
+	{
+		emit(BPF_LD | size | BPF_ABS, labelNext, labelNext, offset);
+	}
+
+	void emitMask(const uint32_t mask)
+	{
+		if (mask != 0xFFFFFFFF)
+		{
+			emit(BPF_ALU | BPF_AND | BPF_K, labelNext, labelNext, mask);
+		}
+	}
+
+	void emitJump(const uint16_t operation,
+	              const uint32_t k,
+	              const int labelTrue,
+	              const int labelFalse)
+	{
+		emit(BPF_JMP | operation | BPF_K, labelTrue, labelFalse, k);
+	}
+
+	bool resolve()
+	{
+		program.clear();
+
+		insertTrampolines();
+
+		for (size_t instruction_i = 0; instruction_i < code.size(); instruction_i++)
+		{
+			const cInstruction& instruction = code[instruction_i];
+
+			struct sock_filter filter;
+			filter.code = instruction.code;
+			filter.jt = 0;
+			filter.jf = 0;
+			filter.k = instruction.k;
+
+			if (instruction.code == (BPF_JMP | BPF_JA))
+			{
+				const int distance = labels[instruction.labelTrue] - (int)instruction_i - 1;
+				if (labels[instruction.labelTrue] < 0 ||
+				    distance < 0)
+				{
+					program.clear();
+					return false;
+				}
+				filter.k = distance;
+			}
+			else if (BPF_CLASS(instruction.code) == BPF_JMP)
+			{
+				if (!offset(instruction_i, instruction.labelTrue, filter.jt) ||
+				    !offset(instruction_i, instruction.labelFalse, filter.jf))
+				{
+					program.clear();
+					return false;
+				}
+			}
+
+			program.push_back(filter);
+		}
+
+		if (program.size() > BPF_MAXINSNS)
+		{
+			program.clear();
+			return false;
+		}
+
+		return true;
+	}
+
+	/** conditional jumps reach 255 instructions: farther target is reached through BPF_JA placed right after jump */
+	void insertTrampolines()
+	{
+		bool inserted = true;
+		while (inserted)
+		{
+			inserted = false;
+
+			for (size_t instruction_i = 0; instruction_i < code.size(); instruction_i++)
+			{
+				const cInstruction instruction = code[instruction_i];
+				if (BPF_CLASS(instruction.code) != BPF_JMP ||
+				    instruction.code == (BPF_JMP | BPF_JA))
+				{
+					continue;
+				}
+
+				const bool farTrue = isFar(instruction_i, instruction.labelTrue);
+				const bool farFalse = isFar(instruction_i, instruction.labelFalse);
+				if (!farTrue && !farFalse)
+				{
+					continue;
+				}
+
+				size_t position = instruction_i + 1;
+				const int labelTrue = farTrue ? insertJump(position++, instruction.labelTrue) : instruction.labelTrue;
+				const int labelFalse = farFalse ? insertJump(position++, instruction.labelFalse) : instruction.labelFalse;
+
+				/** fall through must skip trampolines */
+				const int labelAfter = newLabel();
+				labels[labelAfter] = position;
+
+				code[instruction_i].labelTrue = (labelTrue == labelNext) ? labelAfter : labelTrue;
+				code[instruction_i].labelFalse = (labelFalse == labelNext) ? labelAfter : labelFalse;
+
+				inserted = true;
+			}
+		}
+	}
+
+	bool isFar(const size_t instruction_i,
+	           const int label) const
+	{
+		return label != labelNext &&
+		       labels[label] - (int)instruction_i - 1 > 0xFF;
+	}
+
+	/** returns label of inserted BPF_JA */
+	int insertJump(const size_t position,
+	               const int label)
+	{
+		for (int& labelPosition : labels)
+		{
+			if (labelPosition >= (int)position)
+			{
+				labelPosition++;
+			}
+		}
+
+		code.insert(code.begin() + position, {BPF_JMP | BPF_JA, label, labelNext, 0});
+
+		const int labelJump = newLabel();
+		labels[labelJump] = position;
+		return labelJump;
+	}
+
+	bool offset(const size_t instruction_i,
+	            const int label,
+	            uint8_t& result) const
+	{
+		if (label == labelNext)
+		{
+			result = 0;
+			return true;
+		}
+
+		const int distance = labels[label] - (int)instruction_i - 1;
+		if (labels[label] < 0 ||
+		    distance < 0 ||
+		    distance > 0xFF)
+		{
+			return false;
+		}
+
+		result = distance;
+		return true;
+	}
+
+	static bool load(const uint8_t* data,
+	                 const uint32_t size,
+	                 const uint64_t offset,
+	                 const uint16_t loadSize,
+	                 uint32_t& value)
+	{
+		const unsigned int length = (loadSize == BPF_W) ? 4 : ((loadSize == BPF_H) ? 2 : 1);
+		if (offset + length > size)
+		{
+			return false;
+		}
+
+		value = 0;
+		for (unsigned int byte_i = 0; byte_i < length; byte_i++)
+		{
+			value = (value << 8) | data[offset + byte_i];
+		}
+		return true;
+	}
+
+private:
+	constexpr static int labelNext = -1;
+	constexpr static uint32_t snapLength = 262144;
+
+	std::vector<std::string> tokens;
+	size_t tokenPosition;
+
+	std::vector<cInstruction> code;
+	std::vector<int> labels;
+
+	std::vector<struct sock_filter> program;
+};
+
+}
+
+}
+
+#endif // TVM_LIBRARY_PACKETFILTER_H
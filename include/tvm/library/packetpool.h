@@ -0,0 +1,197 @@
+// Copyright © 2017, Timur Aitov. Contacts: timonbl4@gmail.com. All rights reserved
+
+#ifndef TVM_LIBRARY_PACKETPOOL_H
+#define TVM_LIBRARY_PACKETPOOL_H
+
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <algorithm>
+
+#include <stdlib.h>
+#include <sys/mman.h>
+
+namespace nVirtualMachine
+{
+
+namespace nLibrary
+{
+
+/** fixed size packet buffers in one mapping, slots are reference counted and recycled through free list */
+class cPacketPool
+{
+public:
+	class cSlot
+	{
+	public:
+		cPacketPool* pool;
+		uint8_t* data;
+		std::atomic<uint32_t> references;
+	};
+
+public:
+	/** slotSize is rounded up to cache line, hugePages: MAP_HUGETLB with fallback to normal pages */
+	cPacketPool(const size_t slotsCount,
+	            const size_t slotSize,
+	            const bool hugePages) :
+	        slotSize((std::max(slotSize, (size_t)1) + cacheLineSize - 1) & ~(cacheLineSize - 1)),
+	        slots(slotsCount)
+	{
+		map = MAP_FAILED;
+		mapSize = 0;
+		destroyed = false;
+		used = 0;
+		peak = 0;
+		failures = 0;
+
+		if (!slotsCount)
+		{
+			return;
+		}
+
+		if (hugePages)
+		{
+			mapSize = (this->slotSize * slotsCount + hugePageSize - 1) & ~(hugePageSize - 1);
+			map = mmap(nullptr, mapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		}
+
+		if (map == MAP_FAILED)
+		{
+			mapSize = this->slotSize * slotsCount;
+			map = mmap(nullptr, mapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		}
+
+		if (map == MAP_FAILED)
+		{
+			mapSize = 0;
+			slots.clear();
+			return;
+		}
+
+		freeSlots.reserve(slots.size());
+		for (size_t slot_i = 0; slot_i < slots.size(); slot_i++)
+		{
+			slots[slot_i].pool = this;
+			slots[slot_i].data = (uint8_t*)map + slot_i * this->slotSize;
+			slots[slot_i].references = 0;
+			freeSlots.push_back(&slots[slot_i]);
+		}
+	}
+
+	/** slots may still be referenced by scheme memories: last release() frees the pool */
+	void destroy()
+	{
+		bool unused;
+
+		{
+			std::lock_guard<std::mutex> guard(mutex);
+			destroyed = true;
+			unused = (used == 0);
+		}
+
+		if (unused)
+		{
+			delete this;
+		}
+	}
+
+	/** returns slot with one reference, or nullptr if pool is exhausted */
+	cSlot* acquire()
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+
+		if (freeSlots.empty())
+		{
+			failures++;
+			return nullptr;
+		}
+
+		cSlot* slot = freeSlots.back();
+		freeSlots.pop_back();
+
+		slot->references.store(1, std::memory_order_relaxed);
+
+		used++;
+		peak = std::max(peak, used);
+
+		return slot;
+	}
+
+	static void reference(cSlot* slot)
+	{
+		slot->references.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	static void release(cSlot* slot)
+	{
+		if (slot->references.fetch_sub(1, std::memory_order_acq_rel) != 1)
+		{
+			return;
+		}
+
+		cPacketPool* pool = slot->pool;
+		bool unused;
+
+		{
+			std::lock_guard<std::mutex> guard(pool->mutex);
+			pool->freeSlots.push_back(slot);
+			pool->used--;
+			unused = pool->destroyed && (pool->used == 0);
+		}
+
+		if (unused)
+		{
+			delete pool;
+		}
+	}
+
+	size_t getSlotSize() const
+	{
+		return slotSize;
+	}
+
+	/** occupancy stats: slots count, slots in use, highest use, failed acquires */
+	void getStats(size_t& size,
+	              size_t& used,
+	              size_t& peak,
+	              size_t& failures)
+	{
+		std::lock_guard<std::mutex> guard(mutex);
+		size = slots.size();
+		used = this->used;
+		peak = this->peak;
+		failures = this->failures;
+	}
+
+private:
+	~cPacketPool()
+	{
+		if (map != MAP_FAILED)
+		{
+			munmap(map, mapSize);
+		}
+	}
+
+private:
+	constexpr static size_t cacheLineSize = 64;
+	constexpr static size_t hugePageSize = 2 * 1024 * 1024;
+
+	const size_t slotSize;
+	std::vector<cSlot> slots;
+
+	void* map;
+	size_t mapSize;
+
+	std::mutex mutex;
+	std::vector<cSlot*> freeSlots;
+	bool destroyed;
+	size_t used;
+	size_t peak;
+	size_t failures;
+};
+
+}
+
+}
+
+#endif // TVM_LIBRARY_PACKETPOOL_H
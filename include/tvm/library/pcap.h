@@ -0,0 +1,722 @@
+// Copyright © 2017, Timur Aitov. Contacts: timonbl4@gmail.com. All rights reserved
+
+#ifndef TVM_LIBRARY_PCAP_H
+#define TVM_LIBRARY_PCAP_H
+
+#include <vector>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include <tvm/library.h>
+#include <tvm/library/rawsocket.h>
+
+namespace nVirtualMachine
+{
+
+namespace nLibrary
+{
+
+/** replays pcap/pcapng file through recvPacket root (same exits as rawSocket) and writes sendPacket to pcap file.
+ *  uses memory types of rawSocket library: register both */
+class cPcap : public cLibrary
+{
+public:
+	using tInteger = int64_t;
+	using tPortId = cRawSocket::tPortId;
+	using tBuffer = cRawSocket::tBuffer;
+	using tPacket = cRawSocket::tPacket;
+
+public:
+	/** speed: 0 - as fast as possible, 1.0 - timestamps pacing, 2.0 - twice faster. loops: 0 - forever.
+	 *  portId of pcapng packet is its interface index, of pcap packet is 0 */
+	cPcap(const std::string& readFilePath = "",
+	      const std::string& writeFilePath = "",
+	      const double speed = 0,
+	      const unsigned int loops = 1) :
+	        readFilePath(readFilePath),
+	        writeFilePath(writeFilePath),
+	        speed(speed),
+	        loops(loops)
+	{
+		readMap = MAP_FAILED;
+		readMapSize = 0;
+		writeFd = -1;
+	}
+
+	~cPcap()
+	{
+		if (writeFd != -1)
+		{
+			flushWrite();
+			close(writeFd);
+		}
+
+		if (readMap != MAP_FAILED)
+		{
+			munmap(readMap, readMapSize);
+		}
+	}
+
+	bool registerLibrary() override
+	{
+		setLibraryName("pcap");
+
+		if (!registerRootModules(rootRecvPacket,
+		                         rootReplayDone))
+		{
+			return false;
+		}
+
+		if (!registerModules(new cLogicSendPacket(this)))
+		{
+			return false;
+		}
+
+		return true;
+	}
+
+	bool init() override
+	{
+		if (readFilePath.size())
+		{
+			if (!openRead())
+			{
+				return false;
+			}
+		}
+
+		if (writeFilePath.size())
+		{
+			if (!openWrite())
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	void run() override
+	{
+		if (records.empty())
+		{
+			return;
+		}
+
+		tBuffer packetData;
+
+		for (unsigned int loop_i = 0; (!loops || loop_i < loops) && !isStopped(); loop_i++)
+		{
+			const auto startTime = std::chrono::steady_clock::now();
+			const uint64_t startTimestamp = records.front().timestamp;
+
+			uint64_t packetsCount = 0;
+			uint64_t bytesCount = 0;
+
+			for (const cRecord& record : records)
+			{
+				if (isStopped())
+				{
+					break;
+				}
+
+				if (speed > 0 &&
+				    record.timestamp > startTimestamp)
+				{
+					if (!waitUntil(startTime + std::chrono::nanoseconds((uint64_t)((record.timestamp - startTimestamp) / speed))))
+					{
+						break;
+					}
+				}
+
+				/** one virtual machine lock per packet, packetData is copied only if it is connected */
+				rootExecute([&]()
+				{
+					rootSetMemoryLocked(rootRecvPacket.memoryWorkerId, (tInteger)0);
+					rootSetMemoryLocked(rootRecvPacket.memoryPortId, record.portId);
+					rootSetMemoryLocked(rootRecvPacket.memoryPacket, tPacket(record.data, record.size));
+					if (rootIsMemoryConnectedLocked(rootRecvPacket.memoryPacketData))
+					{
+						packetData.assign(record.data, record.data + record.size);
+						rootSetMemoryLocked(rootRecvPacket.memoryPacketData, packetData);
+					}
+					rootSignalFlowLocked(rootRecvPacket.signal);
+				});
+
+				packetsCount++;
+				bytesCount += record.size;
+			}
+
+			const auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime);
+
+			/** packet is view of file mapping */
+			rootSetMemory(rootRecvPacket.memoryPacket, tPacket());
+
+			rootSetMemory(rootReplayDone.memoryLoop, (tInteger)loop_i);
+			rootSetMemory(rootReplayDone.memoryPackets, (tInteger)packetsCount);
+			rootSetMemory(rootReplayDone.memoryBytes, (tInteger)bytesCount);
+			rootSetMemory(rootReplayDone.memoryDuration, (tInteger)duration.count());
+			rootSignalFlow(rootReplayDone.signal);
+		}
+	}
+
+private:
+	class cRecord
+	{
+	public:
+		const uint8_t* data;
+		uint32_t size;
+		tPortId portId;
+		uint64_t timestamp; ///< nanoseconds
+	};
+
+	/** sleeps in short steps to notice stop */
+	bool waitUntil(const std::chrono::steady_clock::time_point& time)
+	{
+		for (;;)
+		{
+			if (isStopped())
+			{
+				return false;
+			}
+
+			const auto now = std::chrono::steady_clock::now();
+			if (now >= time)
+			{
+				return true;
+			}
+
+			std::this_thread::sleep_for(std::min(std::chrono::duration_cast<std::chrono::nanoseconds>(time - now),
+			                                     std::chrono::nanoseconds(100 * 1000 * 1000)));
+		}
+	}
+
+	bool openRead()
+	{
+		int fd = open(readFilePath.data(), O_RDONLY);
+		if (fd < 0)
+		{
+			return false;
+		}
+
+		struct stat fileStat;
+		if (fstat(fd, &fileStat) < 0 ||
+		    fileStat.st_size < 4)
+		{
+			close(fd);
+			return false;
+		}
+
+		/** read whole file before replay: disk does not limit packet rate */
+		readMapSize = fileStat.st_size;
+		readMap = mmap(nullptr, readMapSize, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+		close(fd);
+
+		if (readMap == MAP_FAILED)
+		{
+			return false;
+		}
+
+		madvise(readMap, readMapSize, MADV_WILLNEED);
+
+		const uint8_t* file = (const uint8_t*)readMap;
+
+		uint32_t magic;
+		memcpy(&magic, file, sizeof(magic));
+
+		if (magic == pcapngBlockSectionHeader)
+		{
+			return parsePcapng(file, readMapSize);
+		}
+
+		return parsePcap(file, readMapSize);
+	}
+
+	static uint16_t read16(const uint8_t* pointer,
+	                       const bool swapped)
+	{
+		uint16_t value;
+		memcpy(&value, pointer, sizeof(value));
+		return swapped ? __builtin_bswap16(value) : value;
+	}
+
+	static uint32_t read32(const uint8_t* pointer,
+	                       const bool swapped)
+	{
+		uint32_t value;
+		memcpy(&value, pointer, sizeof(value));
+		return swapped ? __builtin_bswap32(value) : value;
+	}
+
+	bool parsePcap(const uint8_t* file,
+	               const size_t fileSize)
+	{
+		if (fileSize < 24)
+		{
+			return false;
+		}
+
+		const uint32_t magic = read32(file, false);
+
+		bool swapped;
+		uint64_t fractionNanoseconds;
+
+		if (magic == pcapMagicMicroseconds ||
+		    magic == pcapMagicNanoseconds)
+		{
+			swapped = false;
+		}
+		else if (__builtin_bswap32(magic) == pcapMagicMicroseconds ||
+		         __builtin_bswap32(magic) == pcapMagicNanoseconds)
+		{
+			swapped = true;
+		}
+		else
+		{
+			return false;
+		}
+
+		fractionNanoseconds = (read32(file, swapped) == pcapMagicNanoseconds) ? 1 : 1000;
+
+		if ((read32(file + 20, swapped) & 0x0FFFFFFF) != linkTypeEthernet)
+		{
+			return false;
+		}
+
+		size_t offset = 24;
+		while (offset + 16 <= fileSize)
+		{
+			const uint64_t seconds = read32(file + offset, swapped);
+			const uint64_t fraction = read32(file + offset + 4, swapped);
+			const uint32_t capturedLength = read32(file + offset + 8, swapped);
+
+			offset += 16;
+
+			if (capturedLength > fileSize - offset)
+			{
+				/** truncated file */
+				break;
+			}
+
+			records.push_back({file + offset,
+			                   capturedLength,
+			                   0,
+			                   seconds * 1000000000 + fraction * fractionNanoseconds});
+
+			offset += capturedLength;
+		}
+
+		return true;
+	}
+
+	bool parsePcapng(const uint8_t* file,
+	                 const size_t fileSize)
+	{
+		/** per section: link type and timestamp units per second of interfaces */
+		std::vector<std::pair<uint16_t, uint64_t>> interfaces;
+		bool swapped = false;
+
+		size_t offset = 0;
+		while (offset + 12 <= fileSize)
+		{
+			const uint8_t* block = file + offset;
+
+			if (read32(block, false) == pcapngBlockSectionHeader)
+			{
+				const uint32_t byteOrderMagic = read32(block + 8, false);
+				if (byteOrderMagic == pcapngByteOrderMagic)
+				{
+					swapped = false;
+				}
+				else if (__builtin_bswap32(byteOrderMagic) == pcapngByteOrderMagic)
+				{
+					swapped = true;
+				}
+				else
+				{
+					return false;
+				}
+
+				interfaces.clear();
+			}
+
+			const uint32_t blockType = read32(block, swapped);
+			const uint32_t blockLength = read32(block + 4, swapped);
+
+			if (blockLength < 12 ||
+			    blockLength % 4 ||
+			    blockLength > fileSize - offset)
+			{
+				/** truncated file */
+				break;
+			}
+
+			if (blockType == pcapngBlockInterfaceDescription &&
+			    blockLength >= 20)
+			{
+				uint64_t unitsPerSecond = 1000000;
+
+				size_t optionOffset = 16;
+				while (optionOffset + 4 <= blockLength - 4)
+				{
+					const uint16_t optionCode = read16(block + optionOffset, swapped);
+					const uint16_t optionLength = read16(block + optionOffset + 2, swapped);
+
+					if (!optionCode ||
+					    optionOffset + 4 + optionLength > blockLength - 4)
+					{
+						break;
+					}
+
+					if (optionCode == pcapngOptionTimestampResolution &&
+					    optionLength >= 1)
+					{
+						const uint8_t resolution = block[optionOffset + 4];
+
+						unitsPerSecond = 1;
+						for (unsigned int i = 0; i < (resolution & 0x7F) && unitsPerSecond < 1000000000000000000ull; i++)
+						{
+							unitsPerSecond *= (resolution & 0x80) ? 2 : 10;
+						}
+					}
+
+					optionOffset += 4 + ((optionLength + 3) & ~3);
+				}
+
+				interfaces.emplace_back(read16(block + 8, swapped), unitsPerSecond);
+			}
+			else if (blockType == pcapngBlockEnhancedPacket &&
+			         blockLength >= 32)
+			{
+				const uint32_t interfaceId = read32(block + 8, swapped);
+				const uint64_t timestamp = ((uint64_t)read32(block + 12, swapped) << 32) | read32(block + 16, swapped);
+				const uint32_t capturedLength = read32(block + 20, swapped);
+
+				if (capturedLength > blockLength - 32)
+				{
+					/** corrupted block: keep records read before it, as for truncated file */
+					break;
+				}
+
+				if (interfaceId < interfaces.size() &&
+				    interfaces[interfaceId].first == linkTypeEthernet)
+				{
+					const uint64_t unitsPerSecond = interfaces[interfaceId].second;
+
+					records.push_back({block + 28,
+					                   capturedLength,
+					                   (tPortId)interfaceId,
+					                   timestamp / unitsPerSecond * 1000000000 + timestamp % unitsPerSecond * 1000000000 / unitsPerSecond});
+				}
+			}
+			else if (blockType == pcapngBlockSimplePacket &&
+			         blockLength >= 16)
+			{
+				if (interfaces.size() &&
+				    interfaces[0].first == linkTypeEthernet)
+				{
+					const uint32_t capturedLength = std::min(read32(block + 8, swapped), blockLength - 16);
+
+					records.push_back({block + 12,
+					                   capturedLength,
+					                   0,
+					                   records.size() ? records.back().timestamp : 0});
+				}
+			}
+
+			offset += blockLength;
+		}
+
+		return true;
+	}
+
+	bool openWrite()
+	{
+		writeFd = open(writeFilePath.data(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (writeFd < 0)
+		{
+			writeFd = -1;
+			return false;
+		}
+
+		writeBuffer.reserve(writeBufferSize + 65536);
+
+		const uint32_t header[6] = {pcapMagicNanoseconds,
+		                            2 | (4 << 16), ///< version 2.4
+		                            0,
+		                            0,
+		                            writeSnapLength,
+		                            linkTypeEthernet};
+
+		push(header, sizeof(header));
+
+		return flushWrite();
+	}
+
+	void push(const void* data,
+	          const size_t size)
+	{
+		writeBuffer.insert(writeBuffer.end(), (const uint8_t*)data, (const uint8_t*)data + size);
+	}
+
+	/** modules are executed under virtual machine lock */
+	void writePacket(const uint8_t* data,
+	                 uint32_t size)
+	{
+		if (writeFd == -1)
+		{
+			return;
+		}
+
+		struct timespec timespec;
+		clock_gettime(CLOCK_REALTIME, &timespec);
+
+		if (size > writeSnapLength)
+		{
+			size = writeSnapLength;
+		}
+
+		const uint32_t header[4] = {(uint32_t)timespec.tv_sec,
+		                            (uint32_t)timespec.tv_nsec,
+		                            size,
+		                            size};
+
+		push(header, sizeof(header));
+		push(data, size);
+
+		if (writeBuffer.size() >= writeBufferSize)
+		{
+			flushWrite();
+		}
+	}
+
+	bool flushWrite()
+	{
+		size_t offset = 0;
+		while (offset < writeBuffer.size())
+		{
+			const ssize_t writeLength = write(writeFd, &writeBuffer[offset], writeBuffer.size() - offset);
+			if (writeLength < 0)
+			{
+				if (errno == EINTR)
+				{
+					continue;
+				}
+
+				writeBuffer.clear();
+				return false;
+			}
+
+			offset += writeLength;
+		}
+
+		writeBuffer.clear();
+		return true;
+	}
+
+private: /** rootModules */
+	class cRootRecvPacket : public cRootModule
+	{
+	public:
+		bool registerModule() override
+		{
+			setModuleName("recvPacket");
+
+			if (!registerSignalExit("signal", signal))
+			{
+				return false;
+			}
+
+			if (!registerMemoryExit("workerId", "integer", memoryWorkerId))
+			{
+				return false;
+			}
+
+			if (!registerMemoryExit("portId", "portId", memoryPortId))
+			{
+				return false;
+			}
+
+			if (!registerMemoryExit("packet", "packet", memoryPacket))
+			{
+				return false;
+			}
+
+			if (!registerMemoryExit("packetData", "buffer", memoryPacketData))
+			{
+				return false;
+			}
+
+			return true;
+		}
+
+		tRootSignalExitId signal;
+		tRootMemoryExitId memoryWorkerId;
+		tRootMemoryExitId memoryPortId;
+		tRootMemoryExitId memoryPacket;
+		tRootMemoryExitId memoryPacketData;
+	};
+
+	/** after each pass over file: packets and bytes replayed, duration in nanoseconds */
+	class cRootReplayDone : public cRootModule
+	{
+	public:
+		bool registerModule() override
+		{
+			setModuleName("replayDone");
+
+			if (!registerSignalExit("signal", signal))
+			{
+				return false;
+			}
+
+			if (!registerMemoryExit("loop", "integer", memoryLoop))
+			{
+				return false;
+			}
+
+			if (!registerMemoryExit("packets", "integer", memoryPackets))
+			{
+				return false;
+			}
+
+			if (!registerMemoryExit("bytes", "integer", memoryBytes))
+			{
+				return false;
+			}
+
+			if (!registerMemoryExit("duration", "integer", memoryDuration))
+			{
+				return false;
+			}
+
+			return true;
+		}
+
+		tRootSignalExitId signal;
+		tRootMemoryExitId memoryLoop;
+		tRootMemoryExitId memoryPackets;
+		tRootMemoryExitId memoryBytes;
+		tRootMemoryExitId memoryDuration;
+	};
+
+private:
+	cRootRecvPacket rootRecvPacket;
+	cRootReplayDone rootReplayDone;
+
+private: /** modules */
+	class cLogicSendPacket : public cLogicModule
+	{
+	public:
+		cLogicSendPacket(cPcap* library) :
+		        library(library)
+		{
+		}
+
+		cModule* clone() const override
+		{
+			return new cLogicSendPacket(library);
+		}
+
+		bool registerModule() override
+		{
+			setModuleName("sendPacket");
+
+			if (!registerSignalEntry("signal", &cLogicSendPacket::signalEntry))
+			{
+				return false;
+			}
+
+			if (!registerMemoryEntry("portId", "portId", portId))
+			{
+				return false;
+			}
+
+			if (!registerMemoryEntry("packet", "packet", packet))
+			{
+				return false;
+			}
+
+			if (!registerMemoryEntry("packetData", "buffer", packetData))
+			{
+				return false;
+			}
+
+			if (!registerSignalExit("signal", signalExit))
+			{
+				return false;
+			}
+
+			return true;
+		}
+
+	private: /** signalEntries */
+		bool signalEntry()
+		{
+			if (packet)
+			{
+				library->writePacket(packet->data(), packet->size());
+			}
+			else if (packetData)
+			{
+				library->writePacket(packetData->data(), packetData->size());
+			}
+
+			return signalFlow(signalExit);
+		}
+
+	private:
+		const tSignalExitId signalExit = 1;
+
+	private:
+		cPcap* library;
+
+	private:
+		tPortId* portId;
+		tPacket* packet;
+		tBuffer* packetData;
+	};
+
+private:
+	constexpr static uint32_t pcapMagicMicroseconds = 0xA1B2C3D4;
+	constexpr static uint32_t pcapMagicNanoseconds = 0xA1B23C4D;
+	constexpr static uint32_t pcapngBlockSectionHeader = 0x0A0D0D0A;
+	constexpr static uint32_t pcapngBlockInterfaceDescription = 0x00000001;
+	constexpr static uint32_t pcapngBlockSimplePacket = 0x00000003;
+	constexpr static uint32_t pcapngBlockEnhancedPacket = 0x00000006;
+	constexpr static uint32_t pcapngByteOrderMagic = 0x1A2B3C4D;
+	constexpr static uint16_t pcapngOptionTimestampResolution = 9;
+	constexpr static uint32_t linkTypeEthernet = 1;
+	constexpr static uint32_t writeSnapLength = 262144;
+	constexpr static size_t writeBufferSize = 1024 * 1024;
+
+	const std::string readFilePath;
+	const std::string writeFilePath;
+	const double speed;
+	const unsigned int loops;
+
+	void* readMap;
+	size_t readMapSize;
+	std::vector<cRecord> records;
+
+	int writeFd;
+	std::vector<uint8_t> writeBuffer;
+};
+
+}
+
+}
+
+#endif // TVM_LIBRARY_PCAP_H
@@ -4,21 +4,36 @@
 #define TVM_LIBRARY_RAWSOCKET_H
 
 #include <vector>
+#include <array>
 #include <map>
+#include <memory>
 #include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
 
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
 #include <sys/types.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
 #include <ifaddrs.h>
 #include <sys/ioctl.h>
 #include <net/if.h>
 #include <netinet/in.h>
+#include <arpa/inet.h>
 #include <linux/if_ether.h>
-#include <netpacket/packet.h>
+#include <linux/if_packet.h>
 #include <endian.h>
 
 #include <tvm/library.h>
+#include <tvm/library/packetfilter.h>
+#include <tvm/library/packetpool.h>
 
 namespace nVirtualMachine
 {
@@ -30,6 +45,8 @@ class cRawSocket : public cLibrary
 {
 	/** @todo: import cBase */
 
+	class cRingBlock;
+
 public:
 	using tBoolean = bool;
 	using tString = std::string;
@@ -38,16 +55,366 @@ public:
 	using tBuffer = std::vector<uint8_t>;
 	using tEthernetType = uint16_t;
 	using tEthernetAddress = std::array<uint8_t, 6>;
+	using tIpv4Address = uint32_t; ///< host byte order
+	using tIpv6Address = std::array<uint8_t, 16>;
 	using tInterfaceInformation = std::tuple<tBoolean, tString>;
+	using tFiveTuple = std::tuple<tIpv4Address, tIpv4Address, tInteger, tInteger, tInteger>;
+
+	/** reference to packet pool buffer, to ring block or to own copy (pool is exhausted).
+	 *  ring block is referenced only by view of received frame in root memory, copies of that view
+	 *  (made by scheme) are moved into packet pool. plain view is valid only while signal is executed */
+	class cPacket
+	{
+	public:
+		cPacket() :
+		        slot(nullptr),
+		        block(nullptr),
+		        pointer(nullptr),
+		        length(0),
+		        blockOrigin(false)
+		{
+		}
+
+		cPacket(const uint8_t* pointer,
+		        const uint32_t length) :
+		        slot(nullptr),
+		        block(nullptr),
+		        pointer(pointer),
+		        length(length),
+		        blockOrigin(false)
+		{
+		}
+
+		/** takes reference returned by cPacketPool::acquire() */
+		cPacket(cPacketPool::cSlot* slot,
+		        const uint32_t length) :
+		        slot(slot),
+		        block(nullptr),
+		        pointer(slot->data),
+		        length(length),
+		        blockOrigin(false)
+		{
+		}
+
+		explicit cPacket(tBuffer&& buffer) :
+		        slot(nullptr),
+		        block(nullptr),
+		        storage(std::make_shared<const tBuffer>(std::move(buffer))),
+		        pointer(storage->data()),
+		        length(storage->size()),
+		        blockOrigin(false)
+		{
+		}
+
+		/** frame received into ring block: its copies (root memories) are views referencing block */
+		cPacket(cRingBlock* block,
+		        const uint8_t* pointer,
+		        const uint32_t length) :
+		        slot(nullptr),
+		        block(block),
+		        pointer(pointer),
+		        length(length),
+		        blockOrigin(true)
+		{
+			cRing::reference(block);
+		}
+
+		cPacket(const cPacket& second) :
+		        slot(second.slot),
+		        block(second.block),
+		        storage(second.storage),
+		        pointer(second.pointer),
+		        length(second.length),
+		        blockOrigin(false)
+		{
+			if (block &&
+			    !second.blockOrigin)
+			{
+				/** copy of view: block must not be pinned by scheme */
+				block = nullptr;
+				copyFrame(second.block->ring->pool);
+				return;
+			}
+
+			if (slot)
+			{
+				cPacketPool::reference(slot);
+			}
+			if (block)
+			{
+				cRing::reference(block);
+			}
+		}
+
+		cPacket(cPacket&& second) :
+		        slot(second.slot),
+		        block(second.block),
+		        storage(std::move(second.storage)),
+		        pointer(second.pointer),
+		        length(second.length),
+		        blockOrigin(second.blockOrigin)
+		{
+			second.slot = nullptr;
+			second.block = nullptr;
+			second.blockOrigin = false;
+		}
+
+		~cPacket()
+		{
+			if (slot)
+			{
+				cPacketPool::release(slot);
+			}
+			if (block)
+			{
+				cRing::release(block);
+			}
+		}
+
+		cPacket& operator=(const cPacket& second)
+		{
+			if (this != &second)
+			{
+				cPacket copy(second);
+				*this = std::move(copy);
+			}
+			return *this;
+		}
+
+		cPacket& operator=(cPacket&& second)
+		{
+			std::swap(slot, second.slot);
+			std::swap(block, second.block);
+			std::swap(storage, second.storage);
+			std::swap(blockOrigin, second.blockOrigin);
+			pointer = second.pointer;
+			length = second.length;
+			return *this;
+		}
+
+		bool isPooled() const
+		{
+			return slot != nullptr;
+		}
+
+		const uint8_t* data() const
+		{
+			return pointer;
+		}
+
+		size_t size() const
+		{
+			return length;
+		}
+
+		/** view has no value to store in scheme */
+		void streamPush(cStreamOut& stream) const
+		{
+		}
+
+		void streamPop(cStreamIn& stream)
+		{
+			*this = cPacket();
+		}
+
+	private:
+		/** pointer and length are set: frame is moved into pool slot, or into own storage if pool is exhausted */
+		void copyFrame(cPacketPool* pool)
+		{
+			slot = length <= pool->getSlotSize() ? pool->acquire() : nullptr;
+			if (slot)
+			{
+				memcpy(slot->data, pointer, length);
+				pointer = slot->data;
+				return;
+			}
+
+			storage = std::make_shared<const tBuffer>(pointer, pointer + length);
+			pointer = storage->data();
+		}
+
+	private:
+		cPacketPool::cSlot* slot;
+		cRingBlock* block;
+		std::shared_ptr<const tBuffer> storage;
+		const uint8_t* pointer;
+		uint32_t length;
+		bool blockOrigin; ///< packet passed by receiving worker, copies of it are views of ring block
+	};
+
+	using tPacket = cPacket;
+
+private:
+	class cRing;
+
+	class cRingBlock
+	{
+	public:
+		cRing* ring;
+		struct tpacket_block_desc* desc;
+		std::atomic<uint32_t> references; ///< receiving worker and views in root memories
+	};
+
+	/** TPACKET_V3 mapping of one socket. block is returned to kernel by last release(),
+	 *  mapping is unmapped when ring is destroyed and no block is referenced */
+	class cRing
+	{
+	public:
+		cRing(uint8_t* map,
+		      const size_t blockSize,
+		      const unsigned int blocksCount,
+		      cPacketPool* pool) :
+		        map(map),
+		        blockSize(blockSize),
+		        blocksCount(blocksCount),
+		        pool(pool),
+		        currentBlock(0),
+		        blocks(blocksCount)
+		{
+			destroyed = false;
+			usedBlocks = 0;
+
+			for (unsigned int block_i = 0; block_i < blocksCount; block_i++)
+			{
+				blocks[block_i].ring = this;
+				blocks[block_i].desc = (struct tpacket_block_desc*)(map + block_i * blockSize);
+				blocks[block_i].references = 0;
+			}
+		}
+
+		void destroy()
+		{
+			bool unused;
+
+			{
+				std::lock_guard<std::mutex> guard(mutex);
+				destroyed = true;
+				unused = (usedBlocks == 0);
+			}
+
+			if (unused)
+			{
+				delete this;
+			}
+		}
+
+		/** block released by kernel: returns false while views of its packets from previous pass are alive */
+		bool acquire(cRingBlock& block)
+		{
+			std::lock_guard<std::mutex> guard(mutex);
+
+			if (block.references.load(std::memory_order_acquire))
+			{
+				return false;
+			}
+
+			block.references.store(1, std::memory_order_relaxed);
+			usedBlocks++;
+			return true;
+		}
+
+		static void reference(cRingBlock* block)
+		{
+			block->references.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		static void release(cRingBlock* block)
+		{
+			if (block->references.fetch_sub(1, std::memory_order_acq_rel) != 1)
+			{
+				return;
+			}
+
+			cRing* ring = block->ring;
+			bool unused;
+
+			{
+				std::lock_guard<std::mutex> guard(ring->mutex);
+				__atomic_store_n(&block->desc->hdr.bh1.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+				ring->usedBlocks--;
+				unused = ring->destroyed && (ring->usedBlocks == 0);
+			}
+
+			if (unused)
+			{
+				delete ring;
+			}
+		}
+
+	private:
+		~cRing()
+		{
+			munmap(map, blockSize * blocksCount);
+		}
+
+	public:
+		uint8_t* const map;
+		const size_t blockSize;
+		const unsigned int blocksCount;
+		cPacketPool* const pool; ///< of receiving worker, copies of ring packets are kept in it
+		unsigned int currentBlock;
+		std::vector<cRingBlock> blocks;
+
+	private:
+		std::mutex mutex;
+		bool destroyed;
+		unsigned int usedBlocks;
+	};
+
+	/** outgoing frames of one interface, flushed by one sendmmsg() */
+	class cTxQueue
+	{
+	public:
+		cTxQueue() :
+		        count(0),
+		        waitWritable(false)
+		{
+		}
+
+	public:
+		std::vector<tPacket> packets; ///< pool references, released after flush
+		unsigned int count;
+		bool waitWritable; ///< socket buffer is full: rest of queue is flushed on EPOLLOUT
+	};
 
 public:
-	cRawSocket()
+	class cConfig
 	{
-	}
+	public:
+		cConfig() :
+		        packetRing(false),
+		        burstSize(0),
+		        workersCount(1),
+		        poolSize(1024),
+		        poolHugePages(false)
+		{
+		}
 
-	cRawSocket(const std::vector<std::string>& exceptInterfaces) :
-	        exceptInterfaces(exceptInterfaces)
+	public:
+		std::vector<std::string> exceptInterfaces;
+		bool packetRing; ///< receive through TPACKET_V3 ring, recvPacket fills only "packet" (no "packetData" copy)
+		unsigned int burstSize; ///< if not zero, up to burstSize frames are delivered by recvPacketBurst instead of recvPacket
+		unsigned int workersCount; ///< receive threads, sockets of every worker join PACKET_FANOUT_HASH group per interface
+		std::string filter; ///< expression (see cPacketFilter) attached to sockets, other frames are dropped in kernel
+		std::map<std::string, std::string> rootFilters; ///< expressions per root module name ("recvPacket", "recvPacketBurst"), checked in userspace
+		unsigned int poolSize; ///< packet buffers per worker, received and sent frames are kept in them without allocations
+		bool poolHugePages; ///< try to back packet pools with hugepages
+	};
+
+public:
+	cRawSocket(const cConfig& config = cConfig()) :
+	        exceptInterfaces(config.exceptInterfaces),
+	        packetRing(config.packetRing),
+	        burstSize(config.burstSize),
+	        filterExpression(config.filter),
+	        rootFilterExpressions(config.rootFilters),
+	        poolSize(config.poolSize),
+	        poolHugePages(config.poolHugePages)
 	{
+		for (unsigned int worker_i = 0; worker_i < std::max(config.workersCount, 1u); worker_i++)
+		{
+			workers.emplace_back(new cWorker(this, worker_i));
+		}
 	}
 
 	bool registerLibrary() override
@@ -67,6 +434,33 @@ public:
 			return false;
 		}
 
+		if (!registerMemory<tPacket>("packet"))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule("packet",
+		                          new cLogicConvert<tPacket,
+		                                            tBuffer>("toBuffer",
+		                                                     "packet",
+		                                                     "buffer",
+			[](tPacket* from, tBuffer* to)
+			{
+				to->assign(from->data(), from->data() + from->size());
+			})))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule("packet",
+		                          new cLogicSize<tPacket,
+		                                         tInteger>("getSize",
+		                                                   "packet",
+		                                                   "integer")))
+		{
+			return false;
+		}
+
 		if (!registerMemoryStandart<tEthernetType>("ethernetType",
 		                                           0))
 		{
@@ -106,6 +500,57 @@ public:
 			return false;
 		}
 
+		if (!registerMemoryStandart<tIpv4Address>("ipv4Address",
+		                                          0))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule("ipv4Address",
+		                          new cLogicConvert<tIpv4Address,
+		                                            tString>("toString",
+		                                                     "ipv4Address",
+		                                                     "string",
+			[](tIpv4Address* from, tString* to)
+			{
+				char ipv4AddressStr[16];
+				snprintf(ipv4AddressStr, 16, "%u.%u.%u.%u",
+				         (*from >> 24) & 0xFF,
+				         (*from >> 16) & 0xFF,
+				         (*from >> 8) & 0xFF,
+				         *from & 0xFF);
+				*to = ipv4AddressStr;
+			})))
+		{
+			return false;
+		}
+
+		if (!registerMemoryArray<uint8_t,
+		                         16>("ipv6Address",
+		                             "byte"))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule("ipv6Address",
+		                          new cLogicConvert<tIpv6Address,
+		                                            tString>("toString",
+		                                                     "ipv6Address",
+		                                                     "string",
+			[](tIpv6Address* from, tString* to)
+			{
+				char ipv6AddressStr[INET6_ADDRSTRLEN];
+				if (!inet_ntop(AF_INET6, from->data(), ipv6AddressStr, INET6_ADDRSTRLEN))
+				{
+					to->clear();
+					return;
+				}
+				*to = ipv6AddressStr;
+			})))
+		{
+			return false;
+		}
+
 		if (!registerMemoryTuple<tInterfaceInformation>("interfaceInformation",
 		                                                {
 		                                                 {"state", "boolean"},
@@ -122,7 +567,27 @@ public:
 			return false;
 		}
 
-		if (!registerRootModules(rootRecvPacket))
+		if (!registerMemoryTuple<tFiveTuple>("fiveTuple",
+		                                     {
+		                                      {"sourceAddress", "ipv4Address"},
+		                                      {"destinationAddress", "ipv4Address"},
+		                                      {"protocol", "integer"},
+		                                      {"sourcePort", "integer"},
+		                                      {"destinationPort", "integer"},
+		                                     }))
+		{
+			return false;
+		}
+
+		if (!registerMemoryFlowTable<tEthernetAddress,
+		                             tPortId>("ethernetAddress",
+		                                      "portId"))
+		{
+			return false;
+		}
+
+		if (!registerRootModules(rootRecvPacket,
+		                         rootRecvPacketBurst))
 		{
 			return false;
 		}
@@ -130,7 +595,15 @@ public:
 		if (!registerModules(new cLogicSendPacket(this),
 		                     new cLogicGetEthernetHeader(),
 		                     new cLogicSendPacketBroadcast(this),
-		                     new cLogicGetInterfacesInformation(this)))
+		                     new cLogicGetInterfacesInformation(this),
+		                     new cLogicFlush(this),
+		                     new cLogicGetPoolStats(this),
+		                     new cLogicGetVlanHeader(),
+		                     new cLogicGetArpHeader(),
+		                     new cLogicGetIpv4Header(),
+		                     new cLogicGetIpv6Header(),
+		                     new cLogicGetTcpHeader(),
+		                     new cLogicGetUdpHeader()))
 		{
 			return false;
 		}
@@ -138,8 +611,36 @@ public:
 		return true;
 	}
 
+
 	bool init() override
 	{
+		if (!socketFilter.compile(filterExpression))
+		{
+			return false;
+		}
+
+		for (const auto& iter : rootFilterExpressions)
+		{
+			if (iter.first == "recvPacket")
+			{
+				if (!recvPacketFilter.compile(iter.second))
+				{
+					return false;
+				}
+			}
+			else if (iter.first == "recvPacketBurst")
+			{
+				if (!recvPacketBurstFilter.compile(iter.second))
+				{
+					return false;
+				}
+			}
+			else
+			{
+				return false;
+			}
+		}
+
 		struct ifaddrs* networkInterfaces;
 		struct ifaddrs* networkInterfaceNext;
 
@@ -169,156 +670,1660 @@ public:
 				continue;
 			}
 
-			int rawSocket = createSocket(networkInterface->ifa_name);
-			if (rawSocket < 0)
+			interfaceNames.push_back(networkInterface->ifa_name);
+		}
+
+		freeifaddrs(networkInterfaces);
+
+		fanoutGroupIds.assign(interfaceNames.size(), -1);
+
+		for (auto& worker : workers)
+		{
+			if (!worker->init())
 			{
 				return false;
 			}
-
-			interfaceNames.push_back(networkInterface->ifa_name);
-			interfaces.push_back(rawSocket);
 		}
 
-		freeifaddrs(networkInterfaces);
 		return true;
 	}
 
 	void run() override
 	{
-		std::vector<char> buffer;
-		constexpr size_t bufferSize = 16384;
-
-		while (!isStopped())
+		for (unsigned int worker_i = 1; worker_i < workers.size(); worker_i++)
 		{
-			for (tPortId portId = 0; portId < (unsigned int)interfaces.size(); portId++)
-			{
-				int rawSocket = interfaces[portId];
-
-				buffer.resize(bufferSize);
-
-				const int recvLen = recv(rawSocket,
-				                         &buffer[0],
-				                         bufferSize,
-				                         0);
-				if (recvLen < 0)
-				{
-					const int errorNumber = errno;
-					if (errorNumber == EAGAIN ||
-					    errorNumber == EINTR ||
-					    errorNumber == ENETDOWN)
-					{
-						continue;
-					}
-
-					return;
-				}
+			workers[worker_i]->runThread();
+		}
 
-				buffer.resize(recvLen);
+		workers[0]->run();
 
-				rootSetMemory(rootRecvPacket.memoryPortId, portId);
-				rootSetMemory(rootRecvPacket.memoryPacket, buffer);
-				rootSignalFlow(rootRecvPacket.signal);
-			}
+		for (unsigned int worker_i = 1; worker_i < workers.size(); worker_i++)
+		{
+			workers[worker_i]->wait();
+		}
+	}
 
-			sleep(0);
+	void stop() override
+	{
+		for (auto& worker : workers)
+		{
+			worker->stop();
 		}
 	}
 
 private:
-	int createSocket(const std::string& interfaceName)
+	/** sockets, rings and epoll loop of one receive thread */
+	class cWorker
 	{
-		int rawSocket = -1;
-
-		rawSocket = socket(AF_PACKET, SOCK_RAW | SOCK_NONBLOCK, htons(ETH_P_ALL));
-		if (rawSocket < 0)
+	public:
+		cWorker(cRawSocket* library,
+		        const unsigned int workerId) :
+		        library(library),
+		        workerId(workerId)
 		{
-			return -1;
+			epollFd = -1;
+			stopEventFd = -1;
+			thread = 0;
+			threadId = std::thread::id();
+			pool = nullptr;
 		}
 
-		int ifindex;
+		~cWorker()
+		{
+			txQueues.clear();
+			if (pool)
+			{
+				pool->destroy();
+			}
+
+			for (cRing* ring : rings)
+			{
+				if (ring)
+				{
+					ring->destroy();
+				}
+			}
+
+			for (int rawSocket : sockets)
+			{
+				close(rawSocket);
+			}
+
+			if (stopEventFd != -1)
+			{
+				close(stopEventFd);
+			}
+
+			if (epollFd != -1)
+			{
+				close(epollFd);
+			}
+		}
+
+		bool init()
+		{
+			pool = new cPacketPool(library->poolSize, packetMaxSize, library->poolHugePages);
+
+			for (tPortId portId = 0; portId < (unsigned int)library->interfaceNames.size(); portId++)
+			{
+				int rawSocket = library->createSocket(library->interfaceNames[portId]);
+				if (rawSocket < 0)
+				{
+					return false;
+				}
+
+				sockets.push_back(rawSocket);
+				rings.push_back(nullptr);
+				txQueues.emplace_back();
+
+				if (library->packetRing &&
+				    !createRing(rawSocket, rings.back()))
+				{
+					return false;
+				}
+
+				/** kernel keeps packets of one flow on one worker */
+				if (library->workers.size() > 1 &&
+				    !library->joinFanoutGroup(rawSocket, portId))
+				{
+					return false;
+				}
+			}
+
+			epollFd = epoll_create1(0);
+			if (epollFd < 0)
+			{
+				epollFd = -1;
+				return false;
+			}
+
+			stopEventFd = eventfd(0, EFD_NONBLOCK);
+			if (stopEventFd < 0)
+			{
+				stopEventFd = -1;
+				return false;
+			}
+
+			if (!epollAdd(stopEventFd, stopEventId))
+			{
+				return false;
+			}
+
+			for (tPortId portId = 0; portId < (unsigned int)sockets.size(); portId++)
+			{
+				if (!epollAdd(sockets[portId], portId))
+				{
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		void runThread()
+		{
+			pthread_attr_t attr;
+
+			if (pthread_attr_init(&attr) != 0)
+			{
+				return;
+			}
+			if (pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE) != 0)
+			{
+				return;
+			}
+
+			if (pthread_create(&thread, &attr, &callHelper, this) != 0)
+			{
+				thread = 0;
+			}
+
+			pthread_attr_destroy(&attr);
+		}
+
+		void wait()
+		{
+			if (thread != 0)
+			{
+				void* status;
+				pthread_join(thread, &status);
+				thread = 0;
+			}
+		}
+
+		void run()
+		{
+			tBuffer buffer;
+			struct epoll_event events[epollEventsSize];
+
+			threadId.store(std::this_thread::get_id(), std::memory_order_relaxed);
+
+			if (library->burstSize)
+			{
+				burstPackets.reserve(library->burstSize);
+				burstFreePackets.reserve(library->burstSize);
+				burstPortIds.reserve(library->burstSize);
+			}
+
+			if (library->burstSize && !library->packetRing)
+			{
+				burstStorage.resize(library->burstSize * packetMaxSize);
+				burstIovecs.resize(library->burstSize);
+				burstMessages.resize(library->burstSize);
+				for (unsigned int packet_i = 0; packet_i < library->burstSize; packet_i++)
+				{
+					burstIovecs[packet_i].iov_base = &burstStorage[packet_i * packetMaxSize];
+					burstIovecs[packet_i].iov_len = packetMaxSize;
+				}
+			}
+
+			while (!library->isStopped())
+			{
+				const int eventsCount = epoll_wait(epollFd, events, epollEventsSize, -1);
+				if (eventsCount < 0)
+				{
+					if (errno == EINTR)
+					{
+						continue;
+					}
+
+					break;
+				}
+
+				for (int event_i = 0; event_i < eventsCount; event_i++)
+				{
+					if (events[event_i].data.u64 == stopEventId)
+					{
+						uint64_t value;
+						if (read(stopEventFd, &value, sizeof(value)) < 0)
+						{
+							/** @todo */
+						}
+						continue;
+					}
+
+					const tPortId portId = events[event_i].data.u64;
+
+					if (events[event_i].events & EPOLLOUT)
+					{
+						std::lock_guard<std::mutex> guard(txMutex);
+						flushTxQueue(portId);
+					}
+
+					if (!(events[event_i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)))
+					{
+						continue;
+					}
+
+					if (library->packetRing)
+					{
+						recvRing(portId);
+					}
+					else if (library->burstSize)
+					{
+						if (!recvPacketsBurst(portId))
+						{
+							flushTxQueues();
+							return;
+						}
+					}
+					else if (!recvPackets(portId, buffer))
+					{
+						flushTxQueues();
+						return;
+					}
+				}
+
+				/** end of event batch */
+				flushTxQueues();
+			}
+		}
+
+		void stop()
+		{
+			if (stopEventFd != -1)
+			{
+				uint64_t value = 1;
+				if (write(stopEventFd, &value, sizeof(value)) < 0)
+				{
+					/** @todo */
+				}
+			}
+		}
+
+		bool isCurrentThread() const
+		{
+			return std::this_thread::get_id() == threadId.load(std::memory_order_relaxed);
+		}
+
+		int getSocket(const tPortId portId) const
+		{
+			return sockets[portId];
+		}
+
+		cPacketPool* getPool() const
+		{
+			return pool;
+		}
+
+		/** flushNow: caller is not this worker, frame is sent immediately */
+		void sendPacket(const tPortId portId,
+		                const tPacket& packet,
+		                const bool flushNow)
+		{
+			std::lock_guard<std::mutex> guard(txMutex);
+
+			cTxQueue& txQueue = txQueues[portId];
+			if (txQueue.count >= txQueueSize)
+			{
+				flushTxQueue(portId);
+				if (txQueue.count >= txQueueSize)
+				{
+					/** socket is still not writable: drop newest frame */
+					return;
+				}
+			}
+
+			if (txQueue.count == txQueue.packets.size())
+			{
+				txQueue.packets.emplace_back();
+			}
+
+			if (packet.isPooled())
+			{
+				txQueue.packets[txQueue.count] = packet;
+			}
+			else
+			{
+				cPacketPool::cSlot* slot = packet.size() <= packetMaxSize ? pool->acquire() : nullptr;
+				if (!slot)
+				{
+					/** pool is exhausted: keep order and send without queue */
+					flushTxQueue(portId);
+					if (txQueue.count)
+					{
+						/** socket is not writable: drop */
+						return;
+					}
+					if (send(sockets[portId], packet.data(), packet.size(), 0) < 0)
+					{
+						/** frame is dropped, as by full queue */
+					}
+					return;
+				}
+
+				memcpy(slot->data, packet.data(), packet.size());
+				txQueue.packets[txQueue.count] = tPacket(slot, packet.size());
+			}
+			txQueue.count++;
+
+			if (txQueue.count >= txQueueSize ||
+			    flushNow)
+			{
+				flushTxQueue(portId);
+			}
+		}
+
+		void flushTxQueues()
+		{
+			std::lock_guard<std::mutex> guard(txMutex);
+
+			for (tPortId portId = 0; portId < (unsigned int)txQueues.size(); portId++)
+			{
+				flushTxQueue(portId);
+			}
+		}
+
+	private:
+		static void* callHelper(void* args)
+		{
+			cWorker* worker = (cWorker*)args;
+			worker->run();
+			return nullptr;
+		}
+
+		/** txMutex must be locked */
+		void flushTxQueue(const tPortId portId)
+		{
+			cTxQueue& txQueue = txQueues[portId];
+			if (!txQueue.count)
+			{
+				return;
+			}
+
+			std::array<struct iovec, txQueueSize> iovecs;
+			std::array<struct mmsghdr, txQueueSize> messages;
+			memset(messages.data(), 0, sizeof(struct mmsghdr) * txQueue.count);
+
+			for (unsigned int packet_i = 0; packet_i < txQueue.count; packet_i++)
+			{
+				iovecs[packet_i].iov_base = (void*)txQueue.packets[packet_i].data();
+				iovecs[packet_i].iov_len = txQueue.packets[packet_i].size();
+				messages[packet_i].msg_hdr.msg_iov = &iovecs[packet_i];
+				messages[packet_i].msg_hdr.msg_iovlen = 1;
+			}
+
+			unsigned int sentCount = 0;
+			while (sentCount < txQueue.count)
+			{
+				const int sendCount = sendmmsg(sockets[portId],
+				                               &messages[sentCount],
+				                               txQueue.count - sentCount,
+				                               0);
+				if (sendCount < 0)
+				{
+					const int errorNumber = errno;
+					if (errorNumber == EINTR)
+					{
+						continue;
+					}
+
+					if (errorNumber == EAGAIN ||
+					    errorNumber == EWOULDBLOCK ||
+					    errorNumber == ENOBUFS)
+					{
+						break;
+					}
+
+					/** first frame is rejected (EMSGSIZE, ENETDOWN, ...): drop only it */
+					sentCount++;
+					continue;
+				}
+
+				sentCount += sendCount;
+			}
+
+			/** keep unsent tail at front of queue */
+			for (unsigned int packet_i = 0; packet_i < txQueue.count; packet_i++)
+			{
+				if (packet_i + sentCount < txQueue.count)
+				{
+					std::swap(txQueue.packets[packet_i], txQueue.packets[packet_i + sentCount]);
+				}
+				else
+				{
+					txQueue.packets[packet_i] = tPacket();
+				}
+			}
+			txQueue.count -= sentCount;
+
+			const bool waitWritable = (txQueue.count != 0);
+			if (txQueue.waitWritable != waitWritable &&
+			    epollModify(sockets[portId], portId, waitWritable ? EPOLLIN | EPOLLOUT : EPOLLIN))
+			{
+				txQueue.waitWritable = waitWritable;
+			}
+		}
+
+		/** drain socket until EAGAIN */
+		bool recvPackets(const tPortId portId,
+		                 tBuffer& buffer)
+		{
+			const int rawSocket = sockets[portId];
+
+			while (!library->isStopped())
+			{
+				/** pool is exhausted: frame is received to buffer */
+				cPacketPool::cSlot* slot = pool->acquire();
+				if (!slot)
+				{
+					buffer.resize(packetMaxSize);
+				}
+				uint8_t* data = slot ? slot->data : &buffer[0];
+
+				const int recvLen = recv(rawSocket,
+				                         data,
+				                         packetMaxSize,
+				                         0);
+				if (recvLen < 0)
+				{
+					if (slot)
+					{
+						cPacketPool::release(slot);
+					}
+
+					const int errorNumber = errno;
+					if (errorNumber == EINTR)
+					{
+						continue;
+					}
+
+					if (errorNumber == EAGAIN ||
+					    errorNumber == EWOULDBLOCK ||
+					    errorNumber == ENETDOWN)
+					{
+						return true;
+					}
+
+					return false;
+				}
+
+				if (!library->recvPacketFilter.match(data, recvLen))
+				{
+					if (slot)
+					{
+						cPacketPool::release(slot);
+					}
+					continue;
+				}
+
+				if (slot)
+				{
+					library->dispatchPacket(workerId,
+					                        portId,
+					                        tPacket(slot, recvLen),
+					                        &buffer);
+				}
+				else
+				{
+					/** scheme may keep packet, buffer is overwritten by next frame */
+					library->dispatchPacket(workerId,
+					                        portId,
+					                        tPacket(tBuffer(data, data + recvLen)),
+					                        &buffer);
+				}
+			}
+
+			return true;
+		}
+
+		/** drain socket with recvmmsg(), one recvPacketBurst signal per call */
+		bool recvPacketsBurst(const tPortId portId)
+		{
+			const int rawSocket = sockets[portId];
+			const unsigned int burstSize = library->burstSize;
+
+			while (!library->isStopped())
+			{
+				for (unsigned int packet_i = 0; packet_i < burstSize; packet_i++)
+				{
+					memset(&burstMessages[packet_i], 0, sizeof(struct mmsghdr));
+					burstMessages[packet_i].msg_hdr.msg_iov = &burstIovecs[packet_i];
+					burstMessages[packet_i].msg_hdr.msg_iovlen = 1;
+				}
+
+				const int recvCount = recvmmsg(rawSocket,
+				                               burstMessages.data(),
+				                               burstSize,
+				                               MSG_DONTWAIT,
+				                               nullptr);
+				if (recvCount < 0)
+				{
+					const int errorNumber = errno;
+					if (errorNumber == EINTR)
+					{
+						continue;
+					}
+
+					if (errorNumber == EAGAIN ||
+					    errorNumber == EWOULDBLOCK ||
+					    errorNumber == ENETDOWN)
+					{
+						return true;
+					}
+
+					return false;
+				}
+
+				for (int packet_i = 0; packet_i < recvCount; packet_i++)
+				{
+					pushBurst(portId,
+					          &burstStorage[packet_i * packetMaxSize],
+					          burstMessages[packet_i].msg_len);
+				}
+
+				signalBurst();
+
+				if ((unsigned int)recvCount < burstSize)
+				{
+					return true;
+				}
+			}
+
+			return true;
+		}
+
+		void pushBurst(const tPortId portId,
+		               const uint8_t* data,
+		               const uint32_t length)
+		{
+			if (!library->recvPacketBurstFilter.match(data, length))
+			{
+				return;
+			}
+
+			/** buffers of previous bursts keep their capacity */
+			if (burstFreePackets.empty())
+			{
+				burstPackets.emplace_back();
+			}
+			else
+			{
+				burstPackets.emplace_back(std::move(burstFreePackets.back()));
+				burstFreePackets.pop_back();
+			}
+			burstPackets.back().assign(data, data + length);
+			burstPortIds.emplace_back(portId);
+
+			if (burstPackets.size() >= library->burstSize)
+			{
+				signalBurst();
+			}
+		}
+
+		void signalBurst()
+		{
+			if (burstPackets.empty())
+			{
+				return;
+			}
+
+			library->dispatchBurst(workerId, burstPackets, burstPortIds);
+
+			while (!burstPackets.empty())
+			{
+				burstFreePackets.emplace_back(std::move(burstPackets.back()));
+				burstPackets.pop_back();
+			}
+			burstPortIds.clear();
+		}
+
+		/** walk blocks released by kernel, packets are passed as references into the ring */
+		void recvRing(const tPortId portId)
+		{
+			cRing& ring = *rings[portId];
+
+			while (!library->isStopped())
+			{
+				cRingBlock& ringBlock = ring.blocks[ring.currentBlock];
+				struct tpacket_block_desc* block = ringBlock.desc;
+				if (!(__atomic_load_n(&block->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER))
+				{
+					return;
+				}
+
+				if (!ring.acquire(ringBlock))
+				{
+					/** views of previous pass are still kept (moved out of root memory): kernel waits for this block too */
+					return;
+				}
+
+				const uint32_t packetsCount = block->hdr.bh1.num_pkts;
+				const uint8_t* pointer = (const uint8_t*)block + block->hdr.bh1.offset_to_first_pkt;
+
+				for (uint32_t packet_i = 0; packet_i < packetsCount; packet_i++)
+				{
+					const struct tpacket3_hdr* header = (const struct tpacket3_hdr*)pointer;
+
+					if (library->burstSize)
+					{
+						pushBurst(portId, pointer + header->tp_mac, header->tp_snaplen);
+					}
+					else if (library->recvPacketFilter.match(pointer + header->tp_mac, header->tp_snaplen))
+					{
+						library->dispatchPacket(workerId,
+						                        portId,
+						                        tPacket(&ringBlock, pointer + header->tp_mac, header->tp_snaplen),
+						                        nullptr);
+					}
+
+					pointer += header->tp_next_offset;
+				}
+
+				signalBurst();
+
+				/** scheme copies are in packet pool: block is returned to kernel now */
+				library->resetPacket();
+				cRing::release(&ringBlock);
+
+				ring.currentBlock = (ring.currentBlock + 1) % ring.blocksCount;
+			}
+		}
+
+		bool createRing(const int rawSocket,
+		                cRing*& ring)
+		{
+			int version = TPACKET_V3;
+			if (setsockopt(rawSocket, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) < 0)
+			{
+				return false;
+			}
+
+			struct tpacket_req3 request;
+			memset(&request, 0, sizeof(request));
+			request.tp_block_size = ringBlockSize;
+			request.tp_block_nr = ringBlocksCount;
+			request.tp_frame_size = ringFrameSize;
+			request.tp_frame_nr = (ringBlockSize / ringFrameSize) * ringBlocksCount;
+			request.tp_retire_blk_tov = ringBlockTimeout;
+
+			if (setsockopt(rawSocket, SOL_PACKET, PACKET_RX_RING, &request, sizeof(request)) < 0)
+			{
+				return false;
+			}
+
+			void* map = mmap(nullptr,
+			                 ringBlockSize * ringBlocksCount,
+			                 PROT_READ | PROT_WRITE,
+			                 MAP_SHARED | MAP_POPULATE,
+			                 rawSocket,
+			                 0);
+			if (map == MAP_FAILED)
+			{
+				return false;
+			}
+
+			ring = new cRing((uint8_t*)map, ringBlockSize, ringBlocksCount, pool);
+
+			return true;
+		}
+
+		bool epollAdd(const int fd,
+		              const uint64_t id)
+		{
+			struct epoll_event event;
+			memset(&event, 0, sizeof(event));
+			event.events = EPOLLIN;
+			event.data.u64 = id;
+
+			return (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) == 0);
+		}
+
+		bool epollModify(const int fd,
+		                 const uint64_t id,
+		                 const uint32_t events)
+		{
+			struct epoll_event event;
+			memset(&event, 0, sizeof(event));
+			event.events = events;
+			event.data.u64 = id;
+
+			return (epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &event) == 0);
+		}
+
+	private:
+		cRawSocket* library;
+		const unsigned int workerId;
+
+		std::vector<int> sockets; ///< per interface
+		std::vector<cRing*> rings; ///< per interface, used in packetRing mode
+
+		std::mutex txMutex;
+		std::vector<cTxQueue> txQueues; ///< per interface
+		std::atomic<std::thread::id> threadId; ///< written by run(), sendPacket() of other threads compares it
+
+		tBuffer burstStorage; ///< recvmmsg() slots, burstSize * packetMaxSize
+		std::vector<struct iovec> burstIovecs;
+		std::vector<struct mmsghdr> burstMessages;
+		std::vector<tBuffer> burstPackets;
+		std::vector<tBuffer> burstFreePackets; ///< emptied after signal, capacity is kept
+		std::vector<tPortId> burstPortIds;
+
+		cPacketPool* pool; ///< destroyed by last released packet
+
+		int epollFd;
+		int stopEventFd;
+		pthread_t thread;
+	};
+
+	/** frames are queued by the worker which executes the module, and sent at the end of its event batch,
+	 *  when queue is full, or by flush module. Modules executed by other roots send immediately */
+	void sendPacket(const tPortId portId,
+	                const tPacket& packet)
+	{
+		for (auto& worker : workers)
+		{
+			if (worker->isCurrentThread())
+			{
+				worker->sendPacket(portId, packet, false);
+				return;
+			}
+		}
+
+		workers[0]->sendPacket(portId, packet, true);
+	}
+
+	void flushTxQueues()
+	{
+		for (auto& worker : workers)
+		{
+			worker->flushTxQueues();
+		}
+	}
+
+	/** workers share one scheme: root memories and signal of one event are set under one virtual machine lock.
+	 *  packetData is filled only if its root memory is connected */
+	void dispatchPacket(const unsigned int workerId,
+	                    const tPortId portId,
+	                    const tPacket& packet,
+	                    tBuffer* packetData)
+	{
+		rootExecute([&]()
+		{
+			rootSetMemoryLocked(rootRecvPacket.memoryWorkerId, (tInteger)workerId);
+			rootSetMemoryLocked(rootRecvPacket.memoryPortId, portId);
+			rootSetMemoryLocked(rootRecvPacket.memoryPacket, packet);
+			if (packetData &&
+			    rootIsMemoryConnectedLocked(rootRecvPacket.memoryPacketData))
+			{
+				packetData->assign(packet.data(), packet.data() + packet.size());
+				rootSetMemoryLocked(rootRecvPacket.memoryPacketData, *packetData);
+			}
+			rootSignalFlowLocked(rootRecvPacket.signal);
+		});
+	}
+
+	void dispatchBurst(const unsigned int workerId,
+	                   const std::vector<tBuffer>& packets,
+	                   const std::vector<tPortId>& portIds)
+	{
+		rootExecute([&]()
+		{
+			rootSetMemoryLocked(rootRecvPacketBurst.memoryWorkerId, (tInteger)workerId);
+			rootSetMemoryLocked(rootRecvPacketBurst.memoryPackets, packets);
+			rootSetMemoryLocked(rootRecvPacketBurst.memoryPortIds, portIds);
+			rootSignalFlowLocked(rootRecvPacketBurst.signal);
+		});
+	}
+
+	void resetPacket()
+	{
+		rootSetMemory(rootRecvPacket.memoryPacket, tPacket());
+	}
+
+	/** PACKET_FANOUT group ids are global: first socket of interface gets unused id from kernel, others join it */
+	bool joinFanoutGroup(const int rawSocket,
+	                     const tPortId portId)
+	{
+		int& groupId = fanoutGroupIds[portId];
+
+		if (groupId != -1)
+		{
+			int fanout = groupId | (PACKET_FANOUT_HASH << 16);
+			return (setsockopt(rawSocket, SOL_PACKET, PACKET_FANOUT, &fanout, sizeof(fanout)) == 0);
+		}
+
+		int fanout = (PACKET_FANOUT_HASH | PACKET_FANOUT_FLAG_UNIQUEID) << 16;
+		if (setsockopt(rawSocket, SOL_PACKET, PACKET_FANOUT, &fanout, sizeof(fanout)) < 0)
+		{
+			return false;
+		}
+
+		socklen_t fanoutLength = sizeof(fanout);
+		if (getsockopt(rawSocket, SOL_PACKET, PACKET_FANOUT, &fanout, &fanoutLength) < 0)
+		{
+			return false;
+		}
+
+		groupId = fanout & 0xFFFF;
+		return true;
+	}
+
+	int createSocket(const std::string& interfaceName)
+	{
+		int rawSocket = -1;
+
+		/** protocol 0: no frames are queued until bind() */
+		rawSocket = socket(AF_PACKET, SOCK_RAW | SOCK_NONBLOCK, 0);
+		if (rawSocket < 0)
+		{
+			return -1;
+		}
+
+		int ifindex;
+
+		{
+			struct ifreq ifr;
+			strncpy(ifr.ifr_name, interfaceName.c_str(), IFNAMSIZ);
+			if (ioctl(rawSocket, SIOCGIFINDEX, &ifr) < 0)
+			{
+				close(rawSocket);
+				return -1;
+			}
+			ifindex = ifr.ifr_ifindex;
+		}
+
+		/** before bind: every queued frame has passed filter */
+		if (!socketFilter.attach(rawSocket))
+		{
+			close(rawSocket);
+			return -1;
+		}
+
+		{
+			struct ifreq ifr;
+			strncpy(ifr.ifr_name, interfaceName.c_str(), IFNAMSIZ);
+			if (ioctl(rawSocket, SIOCGIFFLAGS, &ifr) < 0)
+			{
+				close(rawSocket);
+				return -1;
+			}
+
+			ifr.ifr_flags |= IFF_PROMISC | IFF_UP;
+			if (ioctl(rawSocket, SIOCSIFFLAGS, &ifr) < 0)
+			{
+				close(rawSocket);
+				return -1;
+			}
+		}
+
+		{
+			sockaddr_ll sll;
+			memset(&sll, 0, sizeof(sll));
+			sll.sll_family = AF_PACKET;
+			sll.sll_protocol = htons(ETH_P_ALL);
+			sll.sll_ifindex = ifindex;
+
+			if (bind(rawSocket, (sockaddr*)&sll, sizeof(sll)) < 0)
+			{
+				close(rawSocket);
+				return -1;
+			}
+		}
+
+		return rawSocket;
+	}
+
+	static uint16_t readBe16(const uint8_t* data)
+	{
+		uint16_t value;
+		memcpy(&value, data, sizeof(value));
+		return be16toh(value);
+	}
+
+	static uint32_t readBe32(const uint8_t* data)
+	{
+		uint32_t value;
+		memcpy(&value, data, sizeof(value));
+		return be32toh(value);
+	}
+
+	bool checkExceptInterfaces(const std::string& interface)
+	{
+		for (const auto& exceptInterface : exceptInterfaces)
+		{
+			if (interface == exceptInterface)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+private:
+	std::vector<tString> exceptInterfaces;
+	std::vector<tString> interfaceNames;
+	std::vector<int> fanoutGroupIds; ///< per interface, -1 until first worker joins
+	const bool packetRing;
+	const unsigned int burstSize;
+
+	const std::string filterExpression;
+	const std::map<std::string, std::string> rootFilterExpressions;
+	cPacketFilter socketFilter;
+	cPacketFilter recvPacketFilter;
+	cPacketFilter recvPacketBurstFilter;
+
+	const unsigned int poolSize;
+	const bool poolHugePages;
+
+	std::vector<std::unique_ptr<cWorker>> workers;
+
+	constexpr static unsigned int ringBlockSize = 1024 * 1024;
+	constexpr static unsigned int ringBlocksCount = 16;
+	constexpr static unsigned int ringFrameSize = 2048;
+	constexpr static unsigned int ringBlockTimeout = 10; ///< milliseconds
+
+	constexpr static int epollEventsSize = 64;
+	constexpr static uint64_t stopEventId = (uint64_t)-1;
+	constexpr static size_t packetMaxSize = 16384;
+	constexpr static unsigned int txQueueSize = 64;
+
+private: /** rootModules */
+	class cRootRecvPacket : public cRootModule
+	{
+	public:
+		bool registerModule() override
+		{
+			setModuleName("recvPacket");
+
+			if (!registerSignalExit("signal", signal))
+			{
+				return false;
+			}
+
+			if (!registerMemoryExit("workerId", "integer", memoryWorkerId))
+			{
+				return false;
+			}
+
+			if (!registerMemoryExit("portId", "portId", memoryPortId))
+			{
+				return false;
+			}
+
+			if (!registerMemoryExit("packet", "packet", memoryPacket))
+			{
+				return false;
+			}
+
+			if (!registerMemoryExit("packetData", "buffer", memoryPacketData))
+			{
+				return false;
+			}
+
+			return true;
+		}
+
+		tRootSignalExitId signal;
+		tRootMemoryExitId memoryWorkerId;
+		tRootMemoryExitId memoryPortId;
+		tRootMemoryExitId memoryPacket;
+		tRootMemoryExitId memoryPacketData;
+	};
+
+	class cRootRecvPacketBurst : public cRootModule
+	{
+	public:
+		bool registerModule() override
+		{
+			setModuleName("recvPacketBurst");
+
+			if (!registerSignalExit("signal", signal))
+			{
+				return false;
+			}
+
+			if (!registerMemoryExit("workerId", "integer", memoryWorkerId))
+			{
+				return false;
+			}
+
+			if (!registerMemoryExit("packets", "vector<buffer>", memoryPackets))
+			{
+				return false;
+			}
+
+			if (!registerMemoryExit("portIds", "vector<portId>", memoryPortIds))
+			{
+				return false;
+			}
+
+			return true;
+		}
+
+		tRootSignalExitId signal;
+		tRootMemoryExitId memoryWorkerId;
+		tRootMemoryExitId memoryPackets;
+		tRootMemoryExitId memoryPortIds;
+	};
+
+private:
+	cRootRecvPacket rootRecvPacket;
+	cRootRecvPacketBurst rootRecvPacketBurst;
+
+private: /** modules */
+	class cLogicGetInterfacesInformation : public cLogicModule
+	{
+	public:
+		using tMap = std::map<tPortId,
+		                      tInterfaceInformation>;
+
+	public:
+		cLogicGetInterfacesInformation(cRawSocket* library) :
+		        library(library)
+		{
+		}
+
+		cModule* clone() const override
+		{
+			return new cLogicGetInterfacesInformation(library);
+		}
+
+		bool registerModule() override
+		{
+			setModuleName("getInterfacesInformation");
+
+			if (!registerSignalEntry("signal", &cLogicGetInterfacesInformation::signalEntry))
+			{
+				return false;
+			}
+
+			if (!registerSignalExit("signal", signalExit))
+			{
+				return false;
+			}
+
+			if (!registerMemoryExit("map<portId,interfaceInformation>", "map<portId,interfaceInformation>", map))
+			{
+				return false;
+			}
+
+			return true;
+		}
+
+	private: /** signalEntries */
+		bool signalEntry()
+		{
+			if (map)
+			{
+				/** interface is up only if it is up for sockets of every worker */
+				for (tPortId portId = 0; portId < (int64_t)library->interfaceNames.size(); portId++)
+				{
+					bool up = true;
+
+					for (const auto& worker : library->workers)
+					{
+						struct ifreq ifr;
+						strncpy(ifr.ifr_name, library->interfaceNames[portId].c_str(), IFNAMSIZ);
+						if (ioctl(worker->getSocket(portId), SIOCGIFFLAGS, &ifr) < 0 ||
+						    !(ifr.ifr_flags & IFF_UP))
+						{
+							up = false;
+							break;
+						}
+					}
+
+					std::get<0>((*map)[portId]) = up;
+				}
+
+				for (tPortId portId = 0; portId < (int64_t)library->interfaceNames.size(); portId++)
+				{
+					std::get<1>((*map)[portId]) = library->interfaceNames[portId];
+				}
+			}
+			return signalFlow(signalExit);
+		}
+
+	private:
+		const tSignalExitId signalExit = 1;
+
+	private:
+		cRawSocket* library;
+
+	private:
+		tMap* map;
+	};
+
+	class cLogicSendPacket : public cLogicModule
+	{
+	public:
+		cLogicSendPacket(cRawSocket* library) :
+		        library(library)
+		{
+		}
+
+		cModule* clone() const override
+		{
+			return new cLogicSendPacket(library);
+		}
+
+		bool registerModule() override
+		{
+			setModuleName("sendPacket");
+
+			if (!registerSignalEntry("signal", &cLogicSendPacket::signalEntry))
+			{
+				return false;
+			}
+
+			if (!registerMemoryEntry("portId", "portId", portId))
+			{
+				return false;
+			}
+
+			if (!registerMemoryEntry("packet", "packet", packet))
+			{
+				return false;
+			}
+
+			if (!registerMemoryEntry("packetData", "buffer", packetData))
+			{
+				return false;
+			}
+
+			if (!registerSignalExit("signal", signalExit))
+			{
+				return false;
+			}
+
+			return true;
+		}
+
+	private: /** signalEntries */
+		bool signalEntry()
+		{
+			if ((!portId) || ((!packet) && (!packetData)))
+			{
+				return signalFlow(signalExit);
+			}
+
+			if (*portId >= (unsigned int)library->interfaceNames.size())
+			{
+				return signalFlow(signalExit);
+			}
+
+			library->sendPacket(*portId,
+			                    packet ? *packet : tPacket(packetData->data(), packetData->size()));
+
+			return signalFlow(signalExit);
+		}
+
+	private:
+		const tSignalExitId signalExit = 1;
+
+	private:
+		cRawSocket* library;
+
+	private:
+		tPortId* portId;
+		tPacket* packet;
+		tBuffer* packetData;
+	};
+
+	class cLogicSendPacketBroadcast : public cLogicModule
+	{
+	public:
+		cLogicSendPacketBroadcast(cRawSocket* library) :
+		        library(library)
+		{
+		}
+
+		cModule* clone() const override
+		{
+			return new cLogicSendPacketBroadcast(library);
+		}
+
+		bool registerModule() override
+		{
+			setModuleName("sendPacketBroadcast");
+
+			if (!registerSignalEntry("signal", &cLogicSendPacketBroadcast::signalEntry))
+			{
+				return false;
+			}
+
+			if (!registerMemoryEntry("packet", "packet", packet))
+			{
+				return false;
+			}
+
+			if (!registerMemoryEntry("packetData", "buffer", packetData))
+			{
+				return false;
+			}
+
+			if (!registerMemoryEntry("exceptPortId", "portId", exceptPortId))
+			{
+				return false;
+			}
+
+			if (!registerSignalExit("signal", signalExit))
+			{
+				return false;
+			}
+
+			return true;
+		}
+
+	private: /** signalEntries */
+		bool signalEntry()
+		{
+			if ((!packet) && (!packetData))
+			{
+				return signalFlow(signalExit);
+			}
+
+			const tPacket sendPacket = packet ? *packet : tPacket(packetData->data(), packetData->size());
+
+			for (tPortId portId = 0; portId < (unsigned int)library->interfaceNames.size(); portId++)
+			{
+				if (exceptPortId && portId == *exceptPortId)
+				{
+					continue;
+				}
+
+				library->sendPacket(portId, sendPacket);
+			}
+
+			return signalFlow(signalExit);
+		}
+
+	private:
+		const tSignalExitId signalExit = 1;
+
+	private:
+		cRawSocket* library;
+
+	private:
+		tPacket* packet;
+		tBuffer* packetData;
+		tPortId* exceptPortId;
+	};
+
+	class cLogicFlush : public cLogicModule
+	{
+	public:
+		cLogicFlush(cRawSocket* library) :
+		        library(library)
+		{
+		}
+
+		cModule* clone() const override
+		{
+			return new cLogicFlush(library);
+		}
 
+		bool registerModule() override
 		{
-			struct ifreq ifr;
-			strncpy(ifr.ifr_name, interfaceName.c_str(), IFNAMSIZ);
-			if (ioctl(rawSocket, SIOCGIFINDEX, &ifr) < 0)
+			setModuleName("flush");
+
+			if (!registerSignalEntry("signal", &cLogicFlush::signalEntry))
 			{
-				close(rawSocket);
-				return -1;
+				return false;
 			}
-			ifindex = ifr.ifr_ifindex;
+
+			if (!registerSignalExit("signal", signalExit))
+			{
+				return false;
+			}
+
+			return true;
 		}
 
+	private: /** signalEntries */
+		bool signalEntry()
 		{
-			struct ifreq ifr;
-			strncpy(ifr.ifr_name, interfaceName.c_str(), IFNAMSIZ);
-			if (ioctl(rawSocket, SIOCGIFFLAGS, &ifr) < 0)
+			library->flushTxQueues();
+			return signalFlow(signalExit);
+		}
+
+	private:
+		const tSignalExitId signalExit = 1;
+
+	private:
+		cRawSocket* library;
+	};
+
+	class cLogicGetPoolStats : public cLogicModule
+	{
+	public:
+		cLogicGetPoolStats(cRawSocket* library) :
+		        library(library)
+		{
+		}
+
+		cModule* clone() const override
+		{
+			return new cLogicGetPoolStats(library);
+		}
+
+		bool registerModule() override
+		{
+			setModuleName("getPoolStats");
+
+			if (!registerSignalEntry("signal", &cLogicGetPoolStats::signalEntry))
 			{
-				close(rawSocket);
-				return -1;
+				return false;
 			}
 
-			ifr.ifr_flags |= IFF_PROMISC | IFF_UP;
-			if (ioctl(rawSocket, SIOCSIFFLAGS, &ifr) < 0)
+			if (!registerSignalExit("signal", signalExit))
 			{
-				close(rawSocket);
-				return -1;
+				return false;
+			}
+
+			if (!registerMemoryExit("size", "integer", size))
+			{
+				return false;
+			}
+
+			if (!registerMemoryExit("used", "integer", used))
+			{
+				return false;
+			}
+
+			if (!registerMemoryExit("peak", "integer", peak))
+			{
+				return false;
+			}
+
+			if (!registerMemoryExit("failures", "integer", failures))
+			{
+				return false;
 			}
+
+			return true;
 		}
 
+	private: /** signalEntries */
+		bool signalEntry()
 		{
-			sockaddr_ll sll;
-			memset(&sll, 0, sizeof(sll));
-			sll.sll_family = AF_PACKET;
-			sll.sll_protocol = htons(ETH_P_ALL);
-			sll.sll_ifindex = ifindex;
+			/** sum of all workers pools */
+			tInteger sizeSum = 0;
+			tInteger usedSum = 0;
+			tInteger peakSum = 0;
+			tInteger failuresSum = 0;
 
-			if (bind(rawSocket, (sockaddr*)&sll, sizeof(sll)) < 0)
+			for (auto& worker : library->workers)
 			{
-				close(rawSocket);
-				return -1;
+				if (!worker->getPool())
+				{
+					continue;
+				}
+
+				size_t poolSize, poolUsed, poolPeak, poolFailures;
+				worker->getPool()->getStats(poolSize, poolUsed, poolPeak, poolFailures);
+
+				sizeSum += poolSize;
+				usedSum += poolUsed;
+				peakSum += poolPeak;
+				failuresSum += poolFailures;
+			}
+
+			if (size)
+			{
+				*size = sizeSum;
+			}
+			if (used)
+			{
+				*used = usedSum;
+			}
+			if (peak)
+			{
+				*peak = peakSum;
+			}
+			if (failures)
+			{
+				*failures = failuresSum;
 			}
+
+			return signalFlow(signalExit);
 		}
 
-		return rawSocket;
-	}
+	private:
+		const tSignalExitId signalExit = 1;
 
-	bool checkExceptInterfaces(const std::string& interface)
+	private:
+		cRawSocket* library;
+
+	private:
+		tInteger* size;
+		tInteger* used;
+		tInteger* peak;
+		tInteger* failures;
+	};
+
+	class cLogicGetEthernetHeader : public cLogicModule
 	{
-		for (const auto& exceptInterface : exceptInterfaces)
+	public:
+		cModule* clone() const override
 		{
-			if (interface == exceptInterface)
+			return new cLogicGetEthernetHeader();
+		}
+
+		bool registerModule() override
+		{
+			setModuleName("getEthernetHeader");
+
+			if (!registerSignalEntry("signal", &cLogicGetEthernetHeader::signalEntry))
+			{
+				return false;
+			}
+
+			if (!registerMemoryEntry("packet", "packet", packet))
+			{
+				return false;
+			}
+
+			if (!registerMemoryEntry("packetData", "buffer", packetData))
+			{
+				return false;
+			}
+
+			if (!registerSignalExit("signal", signalExit))
+			{
+				return false;
+			}
+
+			if (!registerMemoryExit("destination", "ethernetAddress", destination))
+			{
+				return false;
+			}
+
+			if (!registerMemoryExit("source", "ethernetAddress", source))
+			{
+				return false;
+			}
+
+			if (!registerMemoryExit("type", "ethernetType", ethernetType))
+			{
+				return false;
+			}
+
+			if (!registerMemoryExit("nextOffset", "integer", nextOffset))
 			{
 				return false;
 			}
+
+			return true;
 		}
-		return true;
-	}
 
-private:
-	std::vector<tString> exceptInterfaces;
-	std::vector<tString> interfaceNames;
+	private: /** signalEntries */
+		bool signalEntry()
+		{
+			const uint8_t* data = packet ? packet->data() : (packetData ? packetData->data() : nullptr);
+			const size_t size = packet ? packet->size() : (packetData ? packetData->size() : 0);
+
+			if (size >= 14)
+			{
+				if (destination)
+				{
+					memcpy(destination, data, 6);
+				}
 
-	std::vector<int> interfaces;
+				if (source)
+				{
+					memcpy(source, data + 6, 6);
+				}
 
-private: /** rootModules */
-	class cRootRecvPacket : public cRootModule
+				if (ethernetType)
+				{
+					*ethernetType = readBe16(data + 12);
+				}
+
+				if (nextOffset)
+				{
+					*nextOffset = 14;
+				}
+			}
+			return signalFlow(signalExit);
+		}
+
+	private:
+		const tSignalExitId signalExit = 1;
+
+	private:
+		tPacket* packet;
+		tBuffer* packetData;
+		tEthernetAddress* destination;
+		tEthernetAddress* source;
+		tEthernetType* ethernetType;
+		tInteger* nextOffset;
+	};
+
+	/** decodes header at offset of packet in place: fields and nextOffset on "done", "fail" if frame is truncated or malformed */
+	class cLogicHeader : public cLogicModule
+	{
+	protected:
+		bool registerHeaderModule(const tModuleName& moduleName)
+		{
+			setModuleName(moduleName);
+
+			if (!registerSignalEntry("signal", &cLogicHeader::signalEntry))
+			{
+				return false;
+			}
+
+			if (!registerMemoryEntry("packet", "packet", packet))
+			{
+				return false;
+			}
+
+			if (!registerMemoryEntry("packetData", "buffer", packetData))
+			{
+				return false;
+			}
+
+			if (!registerMemoryEntry("offset", "integer", offset))
+			{
+				return false;
+			}
+
+			if (!registerSignalExit("done", signalExitDone))
+			{
+				return false;
+			}
+
+			if (!registerSignalExit("fail", signalExitFail))
+			{
+				return false;
+			}
+
+			if (!registerMemoryExit("nextOffset", "integer", nextOffset))
+			{
+				return false;
+			}
+
+			return true;
+		}
+
+		/** size: bytes available from header start. Returns header length, 0 if header is invalid */
+		virtual size_t decode(const uint8_t* header,
+		                      const size_t size) = 0;
+
+	private: /** signalEntries */
+		bool signalEntry()
+		{
+			const uint8_t* data = packet ? packet->data() : (packetData ? packetData->data() : nullptr);
+			const size_t size = packet ? packet->size() : (packetData ? packetData->size() : 0);
+			const tInteger headerOffset = offset ? *offset : 0;
+
+			if (headerOffset < 0 ||
+			    (size_t)headerOffset >= size)
+			{
+				return signalFlow(signalExitFail);
+			}
+
+			const size_t headerLength = decode(data + headerOffset, size - headerOffset);
+			if (!headerLength)
+			{
+				return signalFlow(signalExitFail);
+			}
+
+			if (nextOffset)
+			{
+				*nextOffset = headerOffset + headerLength;
+			}
+			return signalFlow(signalExitDone);
+		}
+
+	private:
+		const tSignalExitId signalExitDone = 1;
+		const tSignalExitId signalExitFail = 2;
+
+	private:
+		tPacket* packet;
+		tBuffer* packetData;
+		tInteger* offset;
+		tInteger* nextOffset;
+	};
+
+	/** offset: 802.1Q tag control information (nextOffset of getEthernetHeader with type 0x8100) */
+	class cLogicGetVlanHeader : public cLogicHeader
 	{
 	public:
+		cModule* clone() const override
+		{
+			return new cLogicGetVlanHeader();
+		}
+
 		bool registerModule() override
 		{
-			setModuleName("recvPacket");
+			if (!registerHeaderModule("getVlanHeader"))
+			{
+				return false;
+			}
 
-			if (!registerSignalExit("signal", signal))
+			if (!registerMemoryExit("vlanId", "integer", vlanId))
 			{
 				return false;
 			}
 
-			if (!registerMemoryExit("portId", "portId", memoryPortId))
+			if (!registerMemoryExit("priority", "integer", priority))
 			{
 				return false;
 			}
 
-			if (!registerMemoryExit("packetData", "buffer", memoryPacket))
+			if (!registerMemoryExit("type", "ethernetType", ethernetType))
 			{
 				return false;
 			}
@@ -326,47 +2331,76 @@ private: /** rootModules */
 			return true;
 		}
 
-		tRootSignalExitId signal;
-		tRootMemoryExitId memoryPortId;
-		tRootMemoryExitId memoryPacket;
-	};
+	private:
+		size_t decode(const uint8_t* header,
+		              const size_t size) override
+		{
+			if (size < 4)
+			{
+				return 0;
+			}
 
-private:
-	cRootRecvPacket rootRecvPacket;
+			const uint16_t tagControl = readBe16(header);
 
-private: /** modules */
-	class cLogicGetInterfacesInformation : public cLogicModule
-	{
-	public:
-		using tMap = std::map<tPortId,
-		                      tInterfaceInformation>;
+			if (vlanId)
+			{
+				*vlanId = tagControl & 0x0FFF;
+			}
+			if (priority)
+			{
+				*priority = tagControl >> 13;
+			}
+			if (ethernetType)
+			{
+				*ethernetType = readBe16(header + 2);
+			}
 
-	public:
-		cLogicGetInterfacesInformation(cRawSocket* library) :
-		        library(library)
-		{
+			return 4;
 		}
 
+	private:
+		tInteger* vlanId;
+		tInteger* priority;
+		tEthernetType* ethernetType;
+	};
+
+	/** ethernet/IPv4 only */
+	class cLogicGetArpHeader : public cLogicHeader
+	{
+	public:
 		cModule* clone() const override
 		{
-			return new cLogicGetInterfacesInformation(library);
+			return new cLogicGetArpHeader();
 		}
 
 		bool registerModule() override
 		{
-			setModuleName("getInterfacesInformation");
+			if (!registerHeaderModule("getArpHeader"))
+			{
+				return false;
+			}
 
-			if (!registerSignalEntry("signal", &cLogicGetInterfacesInformation::signalEntry))
+			if (!registerMemoryExit("operation", "integer", operation))
 			{
 				return false;
 			}
 
-			if (!registerSignalExit("signal", signalExit))
+			if (!registerMemoryExit("senderEthernetAddress", "ethernetAddress", senderEthernetAddress))
 			{
 				return false;
 			}
 
-			if (!registerMemoryExit("map<portId,interfaceInformation>", "map<portId,interfaceInformation>", map))
+			if (!registerMemoryExit("senderIpAddress", "ipv4Address", senderIpAddress))
+			{
+				return false;
+			}
+
+			if (!registerMemoryExit("targetEthernetAddress", "ethernetAddress", targetEthernetAddress))
+			{
+				return false;
+			}
+
+			if (!registerMemoryExit("targetIpAddress", "ipv4Address", targetIpAddress))
 			{
 				return false;
 			}
@@ -374,70 +2408,92 @@ private: /** modules */
 			return true;
 		}
 
-	private: /** signalEntries */
-		bool signalEntry()
+	private:
+		size_t decode(const uint8_t* header,
+		              const size_t size) override
 		{
-			if (map)
+			if (size < 28 ||
+			    readBe16(header) != 1 ||
+			    readBe16(header + 2) != ETH_P_IP ||
+			    header[4] != 6 ||
+			    header[5] != 4)
 			{
-				for (tPortId portId = 0; portId < (int64_t)library->interfaces.size(); portId++)
-				{
-					struct ifreq ifr;
-					strncpy(ifr.ifr_name, library->interfaceNames[portId].c_str(), IFNAMSIZ);
-					if (ioctl(library->interfaces[portId], SIOCGIFFLAGS, &ifr) < 0)
-					{
-						std::get<0>((*map)[portId]) = false;
-						continue;
-					}
-
-					std::get<0>((*map)[portId]) = ifr.ifr_flags & IFF_UP;
-				}
-
-				for (tPortId portId = 0; portId < (int64_t)library->interfaceNames.size(); portId++)
-				{
-					std::get<1>((*map)[portId]) = library->interfaceNames[portId];
-				}
+				return 0;
 			}
-			return signalFlow(signalExit);
-		}
 
-	private:
-		const tSignalExitId signalExit = 1;
+			if (operation)
+			{
+				*operation = readBe16(header + 6);
+			}
+			if (senderEthernetAddress)
+			{
+				memcpy(senderEthernetAddress, header + 8, 6);
+			}
+			if (senderIpAddress)
+			{
+				*senderIpAddress = readBe32(header + 14);
+			}
+			if (targetEthernetAddress)
+			{
+				memcpy(targetEthernetAddress, header + 18, 6);
+			}
+			if (targetIpAddress)
+			{
+				*targetIpAddress = readBe32(header + 24);
+			}
 
-	private:
-		cRawSocket* library;
+			return 28;
+		}
 
 	private:
-		tMap* map;
+		tInteger* operation;
+		tEthernetAddress* senderEthernetAddress;
+		tIpv4Address* senderIpAddress;
+		tEthernetAddress* targetEthernetAddress;
+		tIpv4Address* targetIpAddress;
 	};
 
-	class cLogicSendPacket : public cLogicModule
+	class cLogicGetIpv4Header : public cLogicHeader
 	{
 	public:
-		cLogicSendPacket(cRawSocket* library) :
-		        library(library)
-		{
-		}
-
 		cModule* clone() const override
 		{
-			return new cLogicSendPacket(library);
+			return new cLogicGetIpv4Header();
 		}
 
 		bool registerModule() override
 		{
-			setModuleName("sendPacket");
+			if (!registerHeaderModule("getIpv4Header"))
+			{
+				return false;
+			}
 
-			if (!registerSignalEntry("signal", &cLogicSendPacket::signalEntry))
+			if (!registerMemoryExit("source", "ipv4Address", source))
 			{
 				return false;
 			}
 
-			if (!registerMemoryEntry("portId", "portId", portId))
+			if (!registerMemoryExit("destination", "ipv4Address", destination))
 			{
 				return false;
 			}
 
-			if (!registerMemoryEntry("packetData", "buffer", packet))
+			if (!registerMemoryExit("protocol", "integer", protocol))
+			{
+				return false;
+			}
+
+			if (!registerMemoryExit("ttl", "integer", ttl))
+			{
+				return false;
+			}
+
+			if (!registerMemoryExit("totalLength", "integer", totalLength))
+			{
+				return false;
+			}
+
+			if (!registerMemoryExit("isFragment", "boolean", isFragment))
 			{
 				return false;
 			}
@@ -445,65 +2501,98 @@ private: /** modules */
 			return true;
 		}
 
-	private: /** signalEntries */
-		bool signalEntry()
+	private:
+		size_t decode(const uint8_t* header,
+		              const size_t size) override
 		{
-			if ((!portId) || (!packet))
+			if (size < 20 ||
+			    (header[0] >> 4) != 4)
 			{
-				return true;
+				return 0;
 			}
 
-			if (*portId >= (unsigned int)library->interfaces.size())
+			const size_t headerLength = (header[0] & 0x0F) * 4;
+			if (headerLength < 20 ||
+			    headerLength > size)
 			{
-				return true;
+				return 0;
 			}
 
-			int rawSocket = library->interfaces[*portId];
-			const int sendLen = send(rawSocket, &(*packet)[0], packet->size(), 0);
-			if (sendLen < 0)
+			if (source)
+			{
+				*source = readBe32(header + 12);
+			}
+			if (destination)
+			{
+				*destination = readBe32(header + 16);
+			}
+			if (protocol)
+			{
+				*protocol = header[9];
+			}
+			if (ttl)
+			{
+				*ttl = header[8];
+			}
+			if (totalLength)
+			{
+				*totalLength = readBe16(header + 2);
+			}
+			if (isFragment)
 			{
-				/** @todo */
+				/** more fragments flag or fragment offset */
+				*isFragment = readBe16(header + 6) & 0x3FFF;
 			}
 
-			return true;
+			return headerLength;
 		}
 
 	private:
-		cRawSocket* library;
-
-	private:
-		tPortId* portId;
-		tBuffer* packet;
+		tIpv4Address* source;
+		tIpv4Address* destination;
+		tInteger* protocol;
+		tInteger* ttl;
+		tInteger* totalLength;
+		tBoolean* isFragment;
 	};
 
-	class cLogicSendPacketBroadcast : public cLogicModule
+	/** fixed header only: extension headers are reported by nextHeader */
+	class cLogicGetIpv6Header : public cLogicHeader
 	{
 	public:
-		cLogicSendPacketBroadcast(cRawSocket* library) :
-		        library(library)
-		{
-		}
-
 		cModule* clone() const override
 		{
-			return new cLogicSendPacketBroadcast(library);
+			return new cLogicGetIpv6Header();
 		}
 
 		bool registerModule() override
 		{
-			setModuleName("sendPacketBroadcast");
+			if (!registerHeaderModule("getIpv6Header"))
+			{
+				return false;
+			}
 
-			if (!registerSignalEntry("signal", &cLogicSendPacketBroadcast::signalEntry))
+			if (!registerMemoryExit("source", "ipv6Address", source))
 			{
 				return false;
 			}
 
-			if (!registerMemoryEntry("packetData", "buffer", packet))
+			if (!registerMemoryExit("destination", "ipv6Address", destination))
 			{
 				return false;
 			}
 
-			if (!registerMemoryEntry("exceptPortId", "portId", exceptPortId))
+			if (!registerMemoryExit("nextHeader", "integer", nextHeader))
+			{
+				return false;
+			}
+
+			if (!registerMemoryExit("hopLimit", "integer", hopLimit))
+			{
+				return false;
+			}
+
+			if (!registerMemoryExit("payloadLength", "integer", payloadLength))
 			{
 				return false;
 			}
@@ -511,78 +2600,89 @@ private: /** modules */
 			return true;
 		}
 
-	private: /** signalEntries */
-		bool signalEntry()
+	private:
+		size_t decode(const uint8_t* header,
+		              const size_t size) override
 		{
-			if (!packet)
+			if (size < 40 ||
+			    (header[0] >> 4) != 6)
 			{
-				return true;
+				return 0;
 			}
 
-			for (tPortId portId = 0; portId < (unsigned int)library->interfaces.size(); portId++)
+			if (source)
 			{
-				if (exceptPortId && portId == *exceptPortId)
-				{
-					continue;
-				}
-
-				int rawSocket = library->interfaces[portId];
-				const int sendLen = send(rawSocket, &(*packet)[0], packet->size(), 0);
-				if (sendLen < 0)
-				{
-					/** @todo */
-				}
+				memcpy(source, header + 8, 16);
+			}
+			if (destination)
+			{
+				memcpy(destination, header + 24, 16);
+			}
+			if (nextHeader)
+			{
+				*nextHeader = header[6];
+			}
+			if (hopLimit)
+			{
+				*hopLimit = header[7];
+			}
+			if (payloadLength)
+			{
+				*payloadLength = readBe16(header + 4);
 			}
 
-			return true;
+			return 40;
 		}
 
 	private:
-		cRawSocket* library;
-
-	private:
-		tBuffer* packet;
-		tPortId* exceptPortId;
+		tIpv6Address* source;
+		tIpv6Address* destination;
+		tInteger* nextHeader;
+		tInteger* hopLimit;
+		tInteger* payloadLength;
 	};
 
-	class cLogicGetEthernetHeader : public cLogicModule
+	class cLogicGetTcpHeader : public cLogicHeader
 	{
 	public:
 		cModule* clone() const override
 		{
-			return new cLogicGetEthernetHeader();
+			return new cLogicGetTcpHeader();
 		}
 
 		bool registerModule() override
 		{
-			setModuleName("getEthernetHeader");
+			if (!registerHeaderModule("getTcpHeader"))
+			{
+				return false;
+			}
 
-			if (!registerSignalEntry("signal", &cLogicGetEthernetHeader::signalEntry))
+			if (!registerMemoryExit("sourcePort", "integer", sourcePort))
 			{
 				return false;
 			}
 
-			if (!registerMemoryEntry("packetData", "buffer", packet))
+			if (!registerMemoryExit("destinationPort", "integer", destinationPort))
 			{
 				return false;
 			}
 
-			if (!registerSignalExit("signal", signalExit))
+			if (!registerMemoryExit("sequence", "integer", sequence))
 			{
 				return false;
 			}
 
-			if (!registerMemoryExit("destination", "ethernetAddress", destination))
+			if (!registerMemoryExit("acknowledgment", "integer", acknowledgment))
 			{
 				return false;
 			}
 
-			if (!registerMemoryExit("source", "ethernetAddress", source))
+			if (!registerMemoryExit("flags", "integer", flags))
 			{
 				return false;
 			}
 
-			if (!registerMemoryExit("type", "ethernetType", ethernetType))
+			if (!registerMemoryExit("window", "integer", window))
 			{
 				return false;
 			}
@@ -590,39 +2690,121 @@ private: /** modules */
 			return true;
 		}
 
-	private: /** signalEntries */
-		bool signalEntry()
+	private:
+		size_t decode(const uint8_t* header,
+		              const size_t size) override
 		{
-			if (packet)
+			if (size < 20)
 			{
-				if (destination)
-				{
-					memcpy(destination, &(*packet)[0], 6);
-				}
+				return 0;
+			}
 
-				if (source)
-				{
-					memcpy(source, &(*packet)[6], 6);
-				}
+			const size_t headerLength = (header[12] >> 4) * 4;
+			if (headerLength < 20 ||
+			    headerLength > size)
+			{
+				return 0;
+			}
 
-				if (ethernetType)
-				{
-					uint16_t value;
-					memcpy(&value, &(*packet)[12], sizeof(value));
-					*ethernetType = be16toh(value);
-				}
+			if (sourcePort)
+			{
+				*sourcePort = readBe16(header);
 			}
-			return signalFlow(signalExit);
+			if (destinationPort)
+			{
+				*destinationPort = readBe16(header + 2);
+			}
+			if (sequence)
+			{
+				*sequence = readBe32(header + 4);
+			}
+			if (acknowledgment)
+			{
+				*acknowledgment = readBe32(header + 8);
+			}
+			if (flags)
+			{
+				*flags = readBe16(header + 12) & 0x01FF;
+			}
+			if (window)
+			{
+				*window = readBe16(header + 14);
+			}
+
+			return headerLength;
 		}
 
 	private:
-		const tSignalExitId signalExit = 1;
+		tInteger* sourcePort;
+		tInteger* destinationPort;
+		tInteger* sequence;
+		tInteger* acknowledgment;
+		tInteger* flags;
+		tInteger* window;
+	};
+
+	class cLogicGetUdpHeader : public cLogicHeader
+	{
+	public:
+		cModule* clone() const override
+		{
+			return new cLogicGetUdpHeader();
+		}
+
+		bool registerModule() override
+		{
+			if (!registerHeaderModule("getUdpHeader"))
+			{
+				return false;
+			}
+
+			if (!registerMemoryExit("sourcePort", "integer", sourcePort))
+			{
+				return false;
+			}
+
+			if (!registerMemoryExit("destinationPort", "integer", destinationPort))
+			{
+				return false;
+			}
+
+			if (!registerMemoryExit("length", "integer", length))
+			{
+				return false;
+			}
+
+			return true;
+		}
 
 	private:
-		tBuffer* packet;
-		tEthernetAddress* destination;
-		tEthernetAddress* source;
-		tEthernetType* ethernetType;
+		size_t decode(const uint8_t* header,
+		              const size_t size) override
+		{
+			if (size < 8)
+			{
+				return 0;
+			}
+
+			if (sourcePort)
+			{
+				*sourcePort = readBe16(header);
+			}
+			if (destinationPort)
+			{
+				*destinationPort = readBe16(header + 2);
+			}
+			if (length)
+			{
+				*length = readBe16(header + 4);
+			}
+
+			return 8;
+		}
+
+	private:
+		tInteger* sourcePort;
+		tInteger* destinationPort;
+		tInteger* length;
 	};
 };
 
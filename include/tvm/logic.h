@@ -4,9 +4,13 @@
 #define TVM_LOGIC_H
 
 #include <functional>
+#include <array>
+#include <algorithm>
+#include <numeric>
 
 #include "module.h"
 #include "signal.h"
+#include "simd.h"
 
 namespace nVirtualMachine
 {
@@ -418,6 +422,1343 @@ private:
 	TType* value;
 };
 
+/** sort of whole vector: LSD radix sort (8 bits per pass, stable) for integer types, std::sort/std::stable_sort for others */
+template<typename TType>
+class cLogicVectorSortAlgorithm
+{
+	using tVector = std::vector<TType>;
+	using tRadix = std::integral_constant<bool,
+	                                      std::is_integral<TType>::value &&
+	                                      !std::is_same<TType, bool>::value>;
+
+public:
+	static void sort(tVector& vector,
+	                 const bool stable)
+	{
+		sort(vector, stable, tRadix());
+	}
+
+private:
+	static void sort(tVector& vector,
+	                 const bool stable,
+	                 std::false_type)
+	{
+		if (stable)
+		{
+			std::stable_sort(vector.begin(), vector.end());
+		}
+		else
+		{
+			std::sort(vector.begin(), vector.end());
+		}
+	}
+
+	static void sort(tVector& vector,
+	                 const bool stable,
+	                 std::true_type)
+	{
+		using tKey = typename std::make_unsigned<TType>::type;
+
+		/** counting passes cost more than comparisons on short vectors */
+		if (vector.size() < 256)
+		{
+			std::stable_sort(vector.begin(), vector.end());
+			return;
+		}
+
+		/** flip sign bit: negative values go first */
+		const tKey signBit = std::is_signed<TType>::value ? (tKey)((tKey)1 << (sizeof(TType) * 8 - 1)) : 0;
+
+		tVector buffer(vector.size());
+		TType* from = vector.data();
+		TType* to = buffer.data();
+
+		for (unsigned int shift = 0; shift < sizeof(TType) * 8; shift += 8)
+		{
+			size_t offsets[256] = {};
+			for (size_t i = 0; i < vector.size(); i++)
+			{
+				offsets[(((tKey)from[i] ^ signBit) >> shift) & 0xFF]++;
+			}
+
+			/** all values have same byte: skip pass */
+			if (offsets[(((tKey)from[0] ^ signBit) >> shift) & 0xFF] == vector.size())
+			{
+				continue;
+			}
+
+			size_t offset = 0;
+			for (size_t& bucketOffset : offsets)
+			{
+				const size_t count = bucketOffset;
+				bucketOffset = offset;
+				offset += count;
+			}
+
+			for (size_t i = 0; i < vector.size(); i++)
+			{
+				to[offsets[(((tKey)from[i] ^ signBit) >> shift) & 0xFF]++] = from[i];
+			}
+
+			std::swap(from, to);
+		}
+
+		if (from != vector.data())
+		{
+			std::copy(from, from + vector.size(), vector.data());
+		}
+	}
+};
+
+template<typename TType, typename = void>
+class cLogicVectorSort : public cLogicNull
+{
+public:
+	cLogicVectorSort(...)
+	{
+	}
+};
+
+/** moduleName: "sort" or "stableSort" */
+template<typename TType>
+class cLogicVectorSort<TType,
+                       void_t<decltype(std::declval<TType>() < std::declval<TType>())>> : public cLogicModule
+{
+	using tVector = std::vector<TType>;
+
+public:
+	cLogicVectorSort(const tModuleName& moduleName,
+	                 const tMemoryTypeName& memoryTypeName,
+	                 const bool stable) :
+	        moduleName(moduleName),
+	        memoryTypeName(memoryTypeName),
+	        stable(stable)
+	{
+	}
+
+	cModule* clone() const override
+	{
+		return new cLogicVectorSort(moduleName,
+		                            memoryTypeName,
+		                            stable);
+	}
+
+	bool registerModule() override
+	{
+		tMemoryTypeName memoryTypeNameVector = "vector<" + memoryTypeName.value + ">";
+
+		setModuleName(moduleName);
+		setCaptionName(moduleName.value);
+
+		if (!registerSignalEntry("signal", &cLogicVectorSort::signalEntry))
+		{
+			return false;
+		}
+
+		if (!registerSignalExit("signal", signalExit))
+		{
+			return false;
+		}
+
+		if (!registerMemoryExit(memoryTypeNameVector.value, memoryTypeNameVector, vector))
+		{
+			return false;
+		}
+
+		return true;
+	}
+
+private: /** signalEntries */
+	bool signalEntry()
+	{
+		if (vector)
+		{
+			cLogicVectorSortAlgorithm<TType>::sort(*vector, stable);
+		}
+		return signalFlow(signalExit);
+	}
+
+private:
+	const tModuleName moduleName;
+	const tMemoryTypeName memoryTypeName;
+	const bool stable;
+
+private:
+	const tSignalExitId signalExit = 1;
+
+private:
+	tVector* vector;
+};
+
+template<typename TType, typename = void>
+class cLogicVectorUnique : public cLogicNull
+{
+public:
+	cLogicVectorUnique(...)
+	{
+	}
+};
+
+/** removes consecutive equal items (sort first for all duplicates) */
+template<typename TType>
+class cLogicVectorUnique<TType,
+                         void_t<decltype(std::declval<TType>() == std::declval<TType>())>> : public cLogicModule
+{
+	using tVector = std::vector<TType>;
+
+public:
+	cLogicVectorUnique(const tMemoryTypeName& memoryTypeName) :
+	        memoryTypeName(memoryTypeName)
+	{
+	}
+
+	cModule* clone() const override
+	{
+		return new cLogicVectorUnique(memoryTypeName);
+	}
+
+	bool registerModule() override
+	{
+		tMemoryTypeName memoryTypeNameVector = "vector<" + memoryTypeName.value + ">";
+
+		setModuleName("unique");
+		setCaptionName("unique");
+
+		if (!registerSignalEntry("signal", &cLogicVectorUnique::signalEntry))
+		{
+			return false;
+		}
+
+		if (!registerSignalExit("signal", signalExit))
+		{
+			return false;
+		}
+
+		if (!registerMemoryExit(memoryTypeNameVector.value, memoryTypeNameVector, vector))
+		{
+			return false;
+		}
+
+		return true;
+	}
+
+private: /** signalEntries */
+	bool signalEntry()
+	{
+		if (vector)
+		{
+			vector->erase(std::unique(vector->begin(), vector->end()), vector->end());
+		}
+		return signalFlow(signalExit);
+	}
+
+private:
+	const tMemoryTypeName memoryTypeName;
+
+private:
+	const tSignalExitId signalExit = 1;
+
+private:
+	tVector* vector;
+};
+
+template<typename TType>
+class cLogicVectorReverse : public cLogicModule
+{
+	using tVector = std::vector<TType>;
+
+public:
+	cLogicVectorReverse(const tMemoryTypeName& memoryTypeName) :
+	        memoryTypeName(memoryTypeName)
+	{
+	}
+
+	cModule* clone() const override
+	{
+		return new cLogicVectorReverse(memoryTypeName);
+	}
+
+	bool registerModule() override
+	{
+		tMemoryTypeName memoryTypeNameVector = "vector<" + memoryTypeName.value + ">";
+
+		setModuleName("reverse");
+		setCaptionName("reverse");
+
+		if (!registerSignalEntry("signal", &cLogicVectorReverse::signalEntry))
+		{
+			return false;
+		}
+
+		if (!registerSignalExit("signal", signalExit))
+		{
+			return false;
+		}
+
+		if (!registerMemoryExit(memoryTypeNameVector.value, memoryTypeNameVector, vector))
+		{
+			return false;
+		}
+
+		return true;
+	}
+
+private: /** signalEntries */
+	bool signalEntry()
+	{
+		if (vector)
+		{
+			std::reverse(vector->begin(), vector->end());
+		}
+		return signalFlow(signalExit);
+	}
+
+private:
+	const tMemoryTypeName memoryTypeName;
+
+private:
+	const tSignalExitId signalExit = 1;
+
+private:
+	tVector* vector;
+};
+
+template<typename TType, typename TIntegerType, typename = void>
+class cLogicVectorBound : public cLogicNull
+{
+public:
+	cLogicVectorBound(...)
+	{
+	}
+};
+
+/** moduleName: "lowerBound" (first item not less than value) or "upperBound" (first item greater than value), vector must be sorted */
+template<typename TType, typename TIntegerType>
+class cLogicVectorBound<TType,
+                        TIntegerType,
+                        void_t<decltype(std::declval<TType>() < std::declval<TType>())>> : public cLogicModule
+{
+	using tVector = std::vector<TType>;
+
+public:
+	cLogicVectorBound(const tModuleName& moduleName,
+	                  const tMemoryTypeName& memoryTypeName,
+	                  const tMemoryTypeName& memoryIntegerTypeName,
+	                  const bool upper) :
+	        moduleName(moduleName),
+	        memoryTypeName(memoryTypeName),
+	        memoryIntegerTypeName(memoryIntegerTypeName),
+	        upper(upper)
+	{
+	}
+
+	cModule* clone() const override
+	{
+		return new cLogicVectorBound(moduleName,
+		                             memoryTypeName,
+		                             memoryIntegerTypeName,
+		                             upper);
+	}
+
+	bool registerModule() override
+	{
+		tMemoryTypeName memoryTypeNameVector = "vector<" + memoryTypeName.value + ">";
+
+		setModuleName(moduleName);
+		setCaptionName(moduleName.value);
+
+		if (!registerSignalEntry("signal", &cLogicVectorBound::signalEntry))
+		{
+			return false;
+		}
+
+		if (!registerMemoryEntry(memoryTypeNameVector.value, memoryTypeNameVector, vector))
+		{
+			return false;
+		}
+
+		if (!registerMemoryEntry(memoryTypeName.value, memoryTypeName, value))
+		{
+			return false;
+		}
+
+		if (!registerSignalExit("signal", signalExit))
+		{
+			return false;
+		}
+
+		if (!registerMemoryExit("index", memoryIntegerTypeName, index))
+		{
+			return false;
+		}
+
+		return true;
+	}
+
+private: /** signalEntries */
+	bool signalEntry()
+	{
+		if (vector && value && index)
+		{
+			if (upper)
+			{
+				*index = std::upper_bound(vector->begin(), vector->end(), *value) - vector->begin();
+			}
+			else
+			{
+				*index = std::lower_bound(vector->begin(), vector->end(), *value) - vector->begin();
+			}
+		}
+		return signalFlow(signalExit);
+	}
+
+private:
+	const tModuleName moduleName;
+	const tMemoryTypeName memoryTypeName;
+	const tMemoryTypeName memoryIntegerTypeName;
+	const bool upper;
+
+private:
+	const tSignalExitId signalExit = 1;
+
+private:
+	tVector* vector;
+	TType* value;
+	TIntegerType* index;
+};
+
+template<typename TType, typename TIntegerType, typename = void>
+class cLogicVectorCount : public cLogicNull
+{
+public:
+	cLogicVectorCount(...)
+	{
+	}
+};
+
+/** count of items equal to value */
+template<typename TType, typename TIntegerType>
+class cLogicVectorCount<TType,
+                        TIntegerType,
+                        void_t<decltype(std::declval<TType>() == std::declval<TType>())>> : public cLogicModule
+{
+	using tVector = std::vector<TType>;
+
+public:
+	cLogicVectorCount(const tMemoryTypeName& memoryTypeName,
+	                  const tMemoryTypeName& memoryIntegerTypeName) :
+	        memoryTypeName(memoryTypeName),
+	        memoryIntegerTypeName(memoryIntegerTypeName)
+	{
+	}
+
+	cModule* clone() const override
+	{
+		return new cLogicVectorCount(memoryTypeName,
+		                             memoryIntegerTypeName);
+	}
+
+	bool registerModule() override
+	{
+		tMemoryTypeName memoryTypeNameVector = "vector<" + memoryTypeName.value + ">";
+
+		setModuleName("count");
+		setCaptionName("count");
+
+		if (!registerSignalEntry("signal", &cLogicVectorCount::signalEntry))
+		{
+			return false;
+		}
+
+		if (!registerMemoryEntry(memoryTypeNameVector.value, memoryTypeNameVector, vector))
+		{
+			return false;
+		}
+
+		if (!registerMemoryEntry(memoryTypeName.value, memoryTypeName, value))
+		{
+			return false;
+		}
+
+		if (!registerSignalExit("signal", signalExit))
+		{
+			return false;
+		}
+
+		if (!registerMemoryExit(memoryIntegerTypeName.value, memoryIntegerTypeName, count))
+		{
+			return false;
+		}
+
+		return true;
+	}
+
+private: /** signalEntries */
+	bool signalEntry()
+	{
+		if (vector && value && count)
+		{
+			*count = std::count(vector->begin(), vector->end(), *value);
+		}
+		return signalFlow(signalExit);
+	}
+
+private:
+	const tMemoryTypeName memoryTypeName;
+	const tMemoryTypeName memoryIntegerTypeName;
+
+private:
+	const tSignalExitId signalExit = 1;
+
+private:
+	tVector* vector;
+	TType* value;
+	TIntegerType* count;
+};
+
+template<typename TType, typename TIntegerType, typename = void>
+class cLogicVectorMinMax : public cLogicNull
+{
+public:
+	cLogicVectorMinMax(...)
+	{
+	}
+};
+
+/** moduleName: "min" or "max", first of equal items. fail: vector is empty */
+template<typename TType, typename TIntegerType>
+class cLogicVectorMinMax<TType,
+                         TIntegerType,
+                         void_t<decltype(std::declval<TType>() < std::declval<TType>())>> : public cLogicModule
+{
+	using tVector = std::vector<TType>;
+
+public:
+	cLogicVectorMinMax(const tModuleName& moduleName,
+	                   const tMemoryTypeName& memoryTypeName,
+	                   const tMemoryTypeName& memoryIntegerTypeName,
+	                   const bool max) :
+	        moduleName(moduleName),
+	        memoryTypeName(memoryTypeName),
+	        memoryIntegerTypeName(memoryIntegerTypeName),
+	        max(max)
+	{
+	}
+
+	cModule* clone() const override
+	{
+		return new cLogicVectorMinMax(moduleName,
+		                              memoryTypeName,
+		                              memoryIntegerTypeName,
+		                              max);
+	}
+
+	bool registerModule() override
+	{
+		tMemoryTypeName memoryTypeNameVector = "vector<" + memoryTypeName.value + ">";
+
+		setModuleName(moduleName);
+		setCaptionName(moduleName.value);
+
+		if (!registerSignalEntry("signal", &cLogicVectorMinMax::signalEntry))
+		{
+			return false;
+		}
+
+		if (!registerMemoryEntry(memoryTypeNameVector.value, memoryTypeNameVector, vector))
+		{
+			return false;
+		}
+
+		if (!registerSignalExit("done", signalExitDone))
+		{
+			return false;
+		}
+
+		if (!registerSignalExit("fail", signalExitFail))
+		{
+			return false;
+		}
+
+		if (!registerMemoryExit(memoryTypeName.value, memoryTypeName, value))
+		{
+			return false;
+		}
+
+		if (!registerMemoryExit("index", memoryIntegerTypeName, index))
+		{
+			return false;
+		}
+
+		return true;
+	}
+
+private: /** signalEntries */
+	bool signalEntry()
+	{
+		if (!vector || vector->empty())
+		{
+			return signalFlow(signalExitFail);
+		}
+
+		auto iter = find(*vector, max);
+
+		if (value)
+		{
+			*value = *iter;
+		}
+
+		if (index)
+		{
+			*index = iter - vector->begin();
+		}
+
+		return signalFlow(signalExitDone);
+	}
+
+private:
+	/** int64_t and double: vector kernel finds value, then first equal item */
+	template<typename TFindType = TType>
+	static typename std::enable_if<cSimd::isSupported<TFindType>::value,
+	                               typename tVector::const_iterator>::type find(const tVector& vector,
+	                                                                            const bool max)
+	{
+		const TType value = cSimd::reduce(max ? cSimd::eReduction::max : cSimd::eReduction::min,
+		                                  vector.data(),
+		                                  vector.size());
+
+		auto iter = std::find(vector.begin(), vector.end(), value);
+		if (iter == vector.end())
+		{
+			/** nan */
+			return max ? std::max_element(vector.begin(), vector.end()) : std::min_element(vector.begin(), vector.end());
+		}
+		return iter;
+	}
+
+	template<typename TFindType = TType>
+	static typename std::enable_if<!cSimd::isSupported<TFindType>::value,
+	                               typename tVector::const_iterator>::type find(const tVector& vector,
+	                                                                            const bool max)
+	{
+		return max ? std::max_element(vector.begin(), vector.end()) : std::min_element(vector.begin(), vector.end());
+	}
+
+private:
+	const tModuleName moduleName;
+	const tMemoryTypeName memoryTypeName;
+	const tMemoryTypeName memoryIntegerTypeName;
+	const bool max;
+
+private:
+	const tSignalExitId signalExitDone = 1;
+	const tSignalExitId signalExitFail = 2;
+
+private:
+	tVector* vector;
+	TType* value;
+	TIntegerType* index;
+};
+
+template<typename TType, typename = void>
+class cLogicVectorSum : public cLogicNull
+{
+public:
+	cLogicVectorSum(...)
+	{
+	}
+};
+
+template<typename TType>
+class cLogicVectorSum<TType,
+                      typename std::enable_if<std::is_arithmetic<TType>::value &&
+                                              !std::is_same<TType, bool>::value>::type> : public cLogicModule
+{
+	using tVector = std::vector<TType>;
+
+public:
+	cLogicVectorSum(const tMemoryTypeName& memoryTypeName) :
+	        memoryTypeName(memoryTypeName)
+	{
+	}
+
+	cModule* clone() const override
+	{
+		return new cLogicVectorSum(memoryTypeName);
+	}
+
+	bool registerModule() override
+	{
+		tMemoryTypeName memoryTypeNameVector = "vector<" + memoryTypeName.value + ">";
+
+		setModuleName("sum");
+		setCaptionName("sum");
+
+		if (!registerSignalEntry("signal", &cLogicVectorSum::signalEntry))
+		{
+			return false;
+		}
+
+		if (!registerMemoryEntry(memoryTypeNameVector.value, memoryTypeNameVector, vector))
+		{
+			return false;
+		}
+
+		if (!registerSignalExit("signal", signalExit))
+		{
+			return false;
+		}
+
+		if (!registerMemoryExit(memoryTypeName.value, memoryTypeName, value))
+		{
+			return false;
+		}
+
+		return true;
+	}
+
+private: /** signalEntries */
+	bool signalEntry()
+	{
+		if (vector && value)
+		{
+			*value = sum(*vector);
+		}
+		return signalFlow(signalExit);
+	}
+
+private:
+	template<typename TSumType = TType>
+	static typename std::enable_if<cSimd::isSupported<TSumType>::value, TType>::type sum(const tVector& vector)
+	{
+		return cSimd::reduce(cSimd::eReduction::sum, vector.data(), vector.size());
+	}
+
+	template<typename TSumType = TType>
+	static typename std::enable_if<!cSimd::isSupported<TSumType>::value, TType>::type sum(const tVector& vector)
+	{
+		return std::accumulate(vector.begin(), vector.end(), (TType)0);
+	}
+
+private:
+	const tMemoryTypeName memoryTypeName;
+
+private:
+	const tSignalExitId signalExit = 1;
+
+private:
+	tVector* vector;
+	TType* value;
+};
+
+template<typename TType, typename = void>
+class cLogicVectorFilter : public cLogicNull
+{
+public:
+	cLogicVectorFilter(...)
+	{
+	}
+};
+
+/** copies items for which (item <comparison> value) is true: signal entry selects comparison */
+template<typename TType>
+class cLogicVectorFilter<TType,
+                         void_t<decltype(std::declval<TType>() < std::declval<TType>()),
+                                decltype(std::declval<TType>() == std::declval<TType>())>> : public cLogicModule
+{
+	using tVector = std::vector<TType>;
+
+public:
+	cLogicVectorFilter(const tMemoryTypeName& memoryTypeName) :
+	        memoryTypeName(memoryTypeName)
+	{
+	}
+
+	cModule* clone() const override
+	{
+		return new cLogicVectorFilter(memoryTypeName);
+	}
+
+	bool registerModule() override
+	{
+		tMemoryTypeName memoryTypeNameVector = "vector<" + memoryTypeName.value + ">";
+
+		setModuleName("filter");
+		setCaptionName("filter");
+
+		if (!registerSignalEntry("equal", &cLogicVectorFilter::signalEntryEqual))
+		{
+			return false;
+		}
+
+		if (!registerSignalEntry("notEqual", &cLogicVectorFilter::signalEntryNotEqual))
+		{
+			return false;
+		}
+
+		if (!registerSignalEntry("less", &cLogicVectorFilter::signalEntryLess))
+		{
+			return false;
+		}
+
+		if (!registerSignalEntry("lessOrEqual", &cLogicVectorFilter::signalEntryLessOrEqual))
+		{
+			return false;
+		}
+
+		if (!registerSignalEntry("greater", &cLogicVectorFilter::signalEntryGreater))
+		{
+			return false;
+		}
+
+		if (!registerSignalEntry("greaterOrEqual", &cLogicVectorFilter::signalEntryGreaterOrEqual))
+		{
+			return false;
+		}
+
+		if (!registerMemoryEntry("from", memoryTypeNameVector, from))
+		{
+			return false;
+		}
+
+		if (!registerMemoryEntry(memoryTypeName.value, memoryTypeName, value))
+		{
+			return false;
+		}
+
+		if (!registerSignalExit("signal", signalExit))
+		{
+			return false;
+		}
+
+		if (!registerMemoryExit("to", memoryTypeNameVector, to))
+		{
+			return false;
+		}
+
+		return true;
+	}
+
+private: /** signalEntries */
+	bool signalEntryEqual()
+	{
+		return filter([](const TType& item, const TType& value) { return item == value; });
+	}
+
+	bool signalEntryNotEqual()
+	{
+		return filter([](const TType& item, const TType& value) { return !(item == value); });
+	}
+
+	bool signalEntryLess()
+	{
+		return filter([](const TType& item, const TType& value) { return item < value; });
+	}
+
+	bool signalEntryLessOrEqual()
+	{
+		return filter([](const TType& item, const TType& value) { return !(value < item); });
+	}
+
+	bool signalEntryGreater()
+	{
+		return filter([](const TType& item, const TType& value) { return value < item; });
+	}
+
+	bool signalEntryGreaterOrEqual()
+	{
+		return filter([](const TType& item, const TType& value) { return !(item < value); });
+	}
+
+private:
+	template<typename TCompare>
+	bool filter(const TCompare& compare)
+	{
+		if (from && value && to)
+		{
+			/** from and to may be same memory */
+			tVector result;
+			result.reserve(from->size());
+
+			for (const TType& item : *from)
+			{
+				if (compare(item, *value))
+				{
+					result.push_back(item);
+				}
+			}
+
+			*to = std::move(result);
+		}
+		return signalFlow(signalExit);
+	}
+
+private:
+	const tMemoryTypeName memoryTypeName;
+
+private:
+	const tSignalExitId signalExit = 1;
+
+private:
+	tVector* from;
+	TType* value;
+	tVector* to;
+};
+
+template<typename TType, typename = void>
+class cLogicVectorArithmetic : public cLogicNull
+{
+public:
+	cLogicVectorArithmetic(...)
+	{
+	}
+};
+
+/** moduleName: "addition", "subtraction" or "multiplication", elementwise.
+ *  signal entry "vector": first <operation> second, fail: sizes differ.
+ *  signal entry "scalar": first <operation> value */
+template<typename TType>
+class cLogicVectorArithmetic<TType,
+                             typename std::enable_if<cSimd::isSupported<TType>::value>::type> : public cLogicModule
+{
+	using tVector = std::vector<TType>;
+
+public:
+	cLogicVectorArithmetic(const tModuleName& moduleName,
+	                       const tMemoryTypeName& memoryTypeName,
+	                       const cSimd::eArithmetic operation) :
+	        moduleName(moduleName),
+	        memoryTypeName(memoryTypeName),
+	        operation(operation)
+	{
+	}
+
+	cModule* clone() const override
+	{
+		return new cLogicVectorArithmetic(moduleName,
+		                                  memoryTypeName,
+		                                  operation);
+	}
+
+	bool registerModule() override
+	{
+		tMemoryTypeName memoryTypeNameVector = "vector<" + memoryTypeName.value + ">";
+
+		setModuleName(moduleName);
+		setCaptionName(moduleName.value);
+
+		if (!registerSignalEntry("vector", &cLogicVectorArithmetic::signalEntryVector))
+		{
+			return false;
+		}
+
+		if (!registerSignalEntry("scalar", &cLogicVectorArithmetic::signalEntryScalar))
+		{
+			return false;
+		}
+
+		if (!registerMemoryEntry("first", memoryTypeNameVector, first))
+		{
+			return false;
+		}
+
+		if (!registerMemoryEntry("second", memoryTypeNameVector, second))
+		{
+			return false;
+		}
+
+		if (!registerMemoryEntry(memoryTypeName.value, memoryTypeName, value))
+		{
+			return false;
+		}
+
+		if (!registerSignalExit("done", signalExitDone))
+		{
+			return false;
+		}
+
+		if (!registerSignalExit("fail", signalExitFail))
+		{
+			return false;
+		}
+
+		if (!registerMemoryExit("result", memoryTypeNameVector, result))
+		{
+			return false;
+		}
+
+		return true;
+	}
+
+private: /** signalEntries */
+	bool signalEntryVector()
+	{
+		if (!first || !second || !result ||
+		    first->size() != second->size())
+		{
+			return signalFlow(signalExitFail);
+		}
+
+		/** result may be first or second: sizes are equal, resize keeps data */
+		result->resize(first->size());
+		cSimd::arithmetic(operation, first->data(), second->data(), result->data(), first->size());
+
+		return signalFlow(signalExitDone);
+	}
+
+	bool signalEntryScalar()
+	{
+		if (!first || !value || !result)
+		{
+			return signalFlow(signalExitFail);
+		}
+
+		result->resize(first->size());
+		cSimd::arithmetic(operation, first->data(), *value, result->data(), first->size());
+
+		return signalFlow(signalExitDone);
+	}
+
+private:
+	const tModuleName moduleName;
+	const tMemoryTypeName memoryTypeName;
+	const cSimd::eArithmetic operation;
+
+private:
+	const tSignalExitId signalExitDone = 1;
+	const tSignalExitId signalExitFail = 2;
+
+private:
+	tVector* first;
+	tVector* second;
+	TType* value;
+	tVector* result;
+};
+
+template<typename TType, typename = void>
+class cLogicVectorDot : public cLogicNull
+{
+public:
+	cLogicVectorDot(...)
+	{
+	}
+};
+
+/** fail: sizes differ */
+template<typename TType>
+class cLogicVectorDot<TType,
+                      typename std::enable_if<cSimd::isSupported<TType>::value>::type> : public cLogicModule
+{
+	using tVector = std::vector<TType>;
+
+public:
+	cLogicVectorDot(const tMemoryTypeName& memoryTypeName) :
+	        memoryTypeName(memoryTypeName)
+	{
+	}
+
+	cModule* clone() const override
+	{
+		return new cLogicVectorDot(memoryTypeName);
+	}
+
+	bool registerModule() override
+	{
+		tMemoryTypeName memoryTypeNameVector = "vector<" + memoryTypeName.value + ">";
+
+		setModuleName("dot");
+		setCaptionName("dot");
+
+		if (!registerSignalEntry("signal", &cLogicVectorDot::signalEntry))
+		{
+			return false;
+		}
+
+		if (!registerMemoryEntry("first", memoryTypeNameVector, first))
+		{
+			return false;
+		}
+
+		if (!registerMemoryEntry("second", memoryTypeNameVector, second))
+		{
+			return false;
+		}
+
+		if (!registerSignalExit("done", signalExitDone))
+		{
+			return false;
+		}
+
+		if (!registerSignalExit("fail", signalExitFail))
+		{
+			return false;
+		}
+
+		if (!registerMemoryExit(memoryTypeName.value, memoryTypeName, value))
+		{
+			return false;
+		}
+
+		return true;
+	}
+
+private: /** signalEntries */
+	bool signalEntry()
+	{
+		if (!first || !second ||
+		    first->size() != second->size())
+		{
+			return signalFlow(signalExitFail);
+		}
+
+		if (value)
+		{
+			*value = cSimd::dot(first->data(), second->data(), first->size());
+		}
+
+		return signalFlow(signalExitDone);
+	}
+
+private:
+	const tMemoryTypeName memoryTypeName;
+
+private:
+	const tSignalExitId signalExitDone = 1;
+	const tSignalExitId signalExitFail = 2;
+
+private:
+	tVector* first;
+	tVector* second;
+	TType* value;
+};
+
+template<typename TType, typename TIntegerType, typename = void>
+class cLogicVectorCompare : public cLogicNull
+{
+public:
+	cLogicVectorCompare(...)
+	{
+	}
+};
+
+/** indices of items for which (item <comparison> value) is true: signal entry selects comparison */
+template<typename TType, typename TIntegerType>
+class cLogicVectorCompare<TType,
+                          TIntegerType,
+                          typename std::enable_if<cSimd::isSupported<TType>::value &&
+                                                  std::is_same<TIntegerType, int64_t>::value>::type> : public cLogicModule
+{
+	using tVector = std::vector<TType>;
+	using tIntegerVector = std::vector<TIntegerType>;
+
+public:
+	cLogicVectorCompare(const tMemoryTypeName& memoryTypeName,
+	                    const tMemoryTypeName& memoryIntegerTypeName) :
+	        memoryTypeName(memoryTypeName),
+	        memoryIntegerTypeName(memoryIntegerTypeName)
+	{
+	}
+
+	cModule* clone() const override
+	{
+		return new cLogicVectorCompare(memoryTypeName,
+		                               memoryIntegerTypeName);
+	}
+
+	bool registerModule() override
+	{
+		tMemoryTypeName memoryTypeNameVector = "vector<" + memoryTypeName.value + ">";
+		tMemoryTypeName memoryIntegerTypeNameVector = "vector<" + memoryIntegerTypeName.value + ">";
+
+		setModuleName("compare");
+		setCaptionName("compare");
+
+		if (!registerSignalEntry("equal", &cLogicVectorCompare::signalEntryEqual))
+		{
+			return false;
+		}
+
+		if (!registerSignalEntry("notEqual", &cLogicVectorCompare::signalEntryNotEqual))
+		{
+			return false;
+		}
+
+		if (!registerSignalEntry("less", &cLogicVectorCompare::signalEntryLess))
+		{
+			return false;
+		}
+
+		if (!registerSignalEntry("lessOrEqual", &cLogicVectorCompare::signalEntryLessOrEqual))
+		{
+			return false;
+		}
+
+		if (!registerSignalEntry("greater", &cLogicVectorCompare::signalEntryGreater))
+		{
+			return false;
+		}
+
+		if (!registerSignalEntry("greaterOrEqual", &cLogicVectorCompare::signalEntryGreaterOrEqual))
+		{
+			return false;
+		}
+
+		if (!registerMemoryEntry(memoryTypeNameVector.value, memoryTypeNameVector, vector))
+		{
+			return false;
+		}
+
+		if (!registerMemoryEntry(memoryTypeName.value, memoryTypeName, value))
+		{
+			return false;
+		}
+
+		if (!registerSignalExit("signal", signalExit))
+		{
+			return false;
+		}
+
+		if (!registerMemoryExit("indices", memoryIntegerTypeNameVector, indices))
+		{
+			return false;
+		}
+
+		return true;
+	}
+
+private: /** signalEntries */
+	bool signalEntryEqual()
+	{
+		return compare(cSimd::eComparison::equal);
+	}
+
+	bool signalEntryNotEqual()
+	{
+		return compare(cSimd::eComparison::notEqual);
+	}
+
+	bool signalEntryLess()
+	{
+		return compare(cSimd::eComparison::less);
+	}
+
+	bool signalEntryLessOrEqual()
+	{
+		return compare(cSimd::eComparison::lessOrEqual);
+	}
+
+	bool signalEntryGreater()
+	{
+		return compare(cSimd::eComparison::greater);
+	}
+
+	bool signalEntryGreaterOrEqual()
+	{
+		return compare(cSimd::eComparison::greaterOrEqual);
+	}
+
+private:
+	bool compare(const cSimd::eComparison comparison)
+	{
+		if (vector && value && indices)
+		{
+			cSimd::compare(comparison, vector->data(), *value, vector->size(), *indices);
+		}
+		return signalFlow(signalExit);
+	}
+
+private:
+	const tMemoryTypeName memoryTypeName;
+	const tMemoryTypeName memoryIntegerTypeName;
+
+private:
+	const tSignalExitId signalExit = 1;
+
+private:
+	tVector* vector;
+	TType* value;
+	tIntegerVector* indices;
+};
+
+template<typename TType, typename = void>
+class cLogicVectorPrefixSum : public cLogicNull
+{
+public:
+	cLogicVectorPrefixSum(...)
+	{
+	}
+};
+
+/** inclusive: to[i] = from[0] + ... + from[i]. from and to may be same memory */
+template<typename TType>
+class cLogicVectorPrefixSum<TType,
+                            typename std::enable_if<cSimd::isSupported<TType>::value>::type> : public cLogicModule
+{
+	using tVector = std::vector<TType>;
+
+public:
+	cLogicVectorPrefixSum(const tMemoryTypeName& memoryTypeName) :
+	        memoryTypeName(memoryTypeName)
+	{
+	}
+
+	cModule* clone() const override
+	{
+		return new cLogicVectorPrefixSum(memoryTypeName);
+	}
+
+	bool registerModule() override
+	{
+		tMemoryTypeName memoryTypeNameVector = "vector<" + memoryTypeName.value + ">";
+
+		setModuleName("prefixSum");
+		setCaptionName("prefixSum");
+
+		if (!registerSignalEntry("signal", &cLogicVectorPrefixSum::signalEntry))
+		{
+			return false;
+		}
+
+		if (!registerMemoryEntry("from", memoryTypeNameVector, from))
+		{
+			return false;
+		}
+
+		if (!registerSignalExit("signal", signalExit))
+		{
+			return false;
+		}
+
+		if (!registerMemoryExit("to", memoryTypeNameVector, to))
+		{
+			return false;
+		}
+
+		return true;
+	}
+
+private: /** signalEntries */
+	bool signalEntry()
+	{
+		if (from && to)
+		{
+			to->resize(from->size());
+			cSimd::prefixSum(from->data(), to->data(), from->size());
+		}
+		return signalFlow(signalExit);
+	}
+
+private:
+	const tMemoryTypeName memoryTypeName;
+
+private:
+	const tSignalExitId signalExit = 1;
+
+private:
+	tVector* from;
+	tVector* to;
+};
+
 template<typename TType, typename TIntegerType>
 class cLogicVectorSet : public cLogicModule
 {
@@ -693,6 +2034,161 @@ private:
 	tVectorIterator iter;
 };
 
+/** chunk size of forEachChunk modules: default if memory entry is not connected or not positive */
+class cLogicChunkSize
+{
+public:
+	template<typename TIntegerType>
+	static size_t get(const TIntegerType* chunkSize)
+	{
+		if (!chunkSize || *chunkSize < 1)
+		{
+			return 256;
+		}
+		return *chunkSize;
+	}
+};
+
+/** one iteration per chunk of up to chunkSize items: chunk is a vector, so every vector module processes it.
+ *  index: position of first item of chunk */
+template<typename TType,
+         typename TIntegerType>
+class cLogicVectorForEachChunk : public cLogicModule
+{
+	using tVector = std::vector<TType>;
+
+public:
+	cLogicVectorForEachChunk(const tMemoryTypeName& memoryTypeName,
+	                         const tMemoryTypeName& memoryIntegerTypeName) :
+	        memoryTypeName(memoryTypeName),
+	        memoryIntegerTypeName(memoryIntegerTypeName)
+	{
+	}
+
+	cModule* clone() const override
+	{
+		return new cLogicVectorForEachChunk(memoryTypeName,
+		                                    memoryIntegerTypeName);
+	}
+
+	bool registerModule() override
+	{
+		tMemoryTypeName memoryTypeNameVector = "vector<" + memoryTypeName.value + ">";
+
+		setModuleName("forEachChunk");
+		setCaptionName("forEachChunk");
+
+		if (!registerSignalEntry("begin", &cLogicVectorForEachChunk::signalEntryBegin))
+		{
+			return false;
+		}
+
+		if (!registerSignalEntry("continue", &cLogicVectorForEachChunk::signalEntryContinue))
+		{
+			return false;
+		}
+
+		if (!registerMemoryEntry(memoryTypeNameVector.value, memoryTypeNameVector, vector))
+		{
+			return false;
+		}
+
+		if (!registerMemoryEntry("chunkSize", memoryIntegerTypeName, chunkSize))
+		{
+			return false;
+		}
+
+		if (!registerSignalExit("iteration", signalExitIteration))
+		{
+			return false;
+		}
+
+		if (!registerSignalExit("done", signalExitDone))
+		{
+			return false;
+		}
+
+		if (!registerMemoryExit("chunk", memoryTypeNameVector, chunk))
+		{
+			return false;
+		}
+
+		if (!registerMemoryExit("index", memoryIntegerTypeName, index))
+		{
+			return false;
+		}
+
+		return true;
+	}
+
+private: /** signalEntries */
+	bool signalEntryBegin()
+	{
+		if (!vector)
+		{
+			return signalFlow(signalExitDone);
+		}
+
+		position = 0;
+		size = cLogicChunkSize::get(chunkSize);
+
+		return iteration();
+	}
+
+	bool signalEntryContinue()
+	{
+		if (!vector)
+		{
+			return signalFlow(signalExitDone);
+		}
+
+		return iteration();
+	}
+
+private:
+	/** position instead of iterator: vector may be changed between iterations */
+	bool iteration()
+	{
+		if (position < vector->size())
+		{
+			const size_t count = std::min(size, vector->size() - position);
+
+			if (chunk)
+			{
+				/** assign keeps capacity of chunk */
+				chunk->assign(vector->begin() + position, vector->begin() + position + count);
+			}
+
+			if (index)
+			{
+				*index = position;
+			}
+
+			position += count;
+			return signalFlow(signalExitIteration);
+		}
+		return signalFlow(signalExitDone);
+	}
+
+private:
+	const tMemoryTypeName memoryTypeName;
+	const tMemoryTypeName memoryIntegerTypeName;
+
+private:
+	const tSignalExitId signalExitIteration = 1;
+	const tSignalExitId signalExitDone = 2;
+
+private:
+	tVector* vector;
+	TIntegerType* chunkSize;
+	tVector* chunk;
+	TIntegerType* index;
+
+private:
+	size_t position;
+	size_t size;
+};
+
 template<typename TType, typename TBooleanType>
 class cLogicIsEmpty : public cLogicModule
 {
@@ -1253,34 +2749,79 @@ public:
 			return false;
 		}
 
-		return true;
+		return true;
+	}
+
+private: /** signalEntries */
+	bool signalEntry()
+	{
+		if (to)
+		{
+			to->clear();
+		}
+		return signalFlow(signalExitDone);
+	}
+
+private:
+	const tMemoryTypeName memoryTypeName;
+
+private:
+	const tSignalExitId signalExitDone = 1;
+
+private:
+	TType* to;
+};
+
+/** memory type name of map container: map<key,value> */
+template<typename TMap>
+class cLogicMapTypeName;
+
+template<typename TKeyType,
+         typename TValueType>
+class cLogicMapTypeName<std::map<TKeyType, TValueType>>
+{
+public:
+	static tMemoryTypeName get(const tMemoryTypeName& memoryKeyTypeName,
+	                           const tMemoryTypeName& memoryValueTypeName)
+	{
+		return "map<" + memoryKeyTypeName.value + "," + memoryValueTypeName.value + ">";
+	}
+};
+
+/** forEach position in map container: next() returns entry and advances before iteration is signalled,
+ *  scheme may insert and erase other entries during iteration */
+template<typename TMap>
+class cLogicMapCursor
+{
+public:
+	void begin(const TMap& map)
+	{
+		iter = map.begin();
 	}
 
-private: /** signalEntries */
-	bool signalEntry()
+	/** nullptr: done */
+	const typename TMap::value_type* next(const TMap& map)
 	{
-		if (to)
+		if (iter == map.end())
 		{
-			to->clear();
+			return nullptr;
 		}
-		return signalFlow(signalExitDone);
-	}
-
-private:
-	const tMemoryTypeName memoryTypeName;
 
-private:
-	const tSignalExitId signalExitDone = 1;
+		const typename TMap::value_type* entry = &*iter;
+		++iter;
+		return entry;
+	}
 
 private:
-	TType* to;
+	typename TMap::const_iterator iter;
 };
 
 template<typename TKeyType,
-         typename TValueType>
+         typename TValueType,
+         typename TMap = std::map<TKeyType, TValueType>>
 class cLogicMapInsertOrUpdate : public cLogicModule
 {
-	using tMap = std::map<TKeyType, TValueType>;
+	using tMap = TMap;
 
 public:
 	cLogicMapInsertOrUpdate(const tMemoryTypeName& memoryKeyTypeName,
@@ -1298,7 +2839,7 @@ public:
 
 	bool registerModule() override
 	{
-		tMemoryTypeName memoryTypeNameMap = "map<" + memoryKeyTypeName.value + "," + memoryValueTypeName.value + ">";
+		tMemoryTypeName memoryTypeNameMap = cLogicMapTypeName<tMap>::get(memoryKeyTypeName, memoryValueTypeName);
 
 		setModuleName("insertOrUpdate");
 		setCaptionName("insertOrUpdate");
@@ -1355,10 +2896,11 @@ private:
 };
 
 template<typename TKeyType,
-         typename TValueType>
+         typename TValueType,
+         typename TMap = std::map<TKeyType, TValueType>>
 class cLogicMapFind : public cLogicModule
 {
-	using tMap = std::map<TKeyType, TValueType>;
+	using tMap = TMap;
 
 public:
 	cLogicMapFind(const tMemoryTypeName& memoryKeyTypeName,
@@ -1376,7 +2918,7 @@ public:
 
 	bool registerModule() override
 	{
-		tMemoryTypeName memoryTypeNameMap = "map<" + memoryKeyTypeName.value + "," + memoryValueTypeName.value + ">";
+		tMemoryTypeName memoryTypeNameMap = cLogicMapTypeName<tMap>::get(memoryKeyTypeName, memoryValueTypeName);
 
 		setModuleName("find");
 		setCaptionName("find");
@@ -1422,11 +2964,12 @@ private: /** signalEntries */
 			return signalFlow(signalExitFail);
 		}
 
-		if (map->find(*key) != map->end())
+		auto iter = map->find(*key);
+		if (iter != map->end())
 		{
 			if (value)
 			{
-				*value = (*map)[*key];
+				*value = iter->second;
 			}
 
 			return signalFlow(signalExitDone);
@@ -1450,10 +2993,11 @@ private:
 };
 
 template<typename TKeyType,
-         typename TValueType>
+         typename TValueType,
+         typename TMap = std::map<TKeyType, TValueType>>
 class cLogicMapSelectOrCreate : public cLogicModule
 {
-	using tMap = std::map<TKeyType, TValueType>;
+	using tMap = TMap;
 
 public:
 	cLogicMapSelectOrCreate(const tMemoryTypeName& memoryKeyTypeName,
@@ -1471,7 +3015,7 @@ public:
 
 	bool registerModule() override
 	{
-		tMemoryTypeName memoryTypeNameMap = "map<" + memoryKeyTypeName.value + "," + memoryValueTypeName.value + ">";
+		tMemoryTypeName memoryTypeNameMap = cLogicMapTypeName<tMap>::get(memoryKeyTypeName, memoryValueTypeName);
 
 		setModuleName("selectOrCreate");
 		setCaptionName("selectOrCreate");
@@ -1517,12 +3061,15 @@ private: /** signalEntries */
 			return signalFlow(signalExit);
 		}
 
-		if (map->find(*key) == map->end())
+		auto iter = map->find(*key);
+		if (iter == map->end())
 		{
-			(*map)[*key] = *inValue;
+			*outValue = ((*map)[*key] = *inValue);
+		}
+		else
+		{
+			*outValue = iter->second;
 		}
-
-		*outValue = (*map)[*key];
 
 		return signalFlow(signalExit);
 	}
@@ -1542,10 +3089,11 @@ private:
 };
 
 template<typename TKeyType,
-         typename TValueType>
+         typename TValueType,
+         typename TMap = std::map<TKeyType, TValueType>>
 class cLogicMapGet : public cLogicModule
 {
-	using tMap = std::map<TKeyType, TValueType>;
+	using tMap = TMap;
 
 public:
 	cLogicMapGet(const tMemoryTypeName& memoryKeyTypeName,
@@ -1563,7 +3111,7 @@ public:
 
 	bool registerModule() override
 	{
-		tMemoryTypeName memoryTypeNameMap = "map<" + memoryKeyTypeName.value + "," + memoryValueTypeName.value + ">";
+		tMemoryTypeName memoryTypeNameMap = cLogicMapTypeName<tMap>::get(memoryKeyTypeName, memoryValueTypeName);
 
 		setModuleName("get");
 		setCaptionName("get");
@@ -1606,14 +3154,15 @@ private: /** signalEntries */
 	{
 		if (map && key)
 		{
-			if (map->find(*key) == map->end())
+			auto iter = map->find(*key);
+			if (iter == map->end())
 			{
 				return signalFlow(signalExitFail);
 			}
 
 			if (value)
 			{
-				*value = (*map)[*key];
+				*value = iter->second;
 			}
 
 			return signalFlow(signalExitDone);
@@ -1636,11 +3185,11 @@ private:
 };
 
 template<typename TKeyType,
-         typename TValueType>
+         typename TValueType,
+         typename TMap = std::map<TKeyType, TValueType>>
 class cLogicMapForEach : public cLogicModule
 {
-	using tMap = std::map<TKeyType, TValueType>;
-	using tMapIterator = typename std::map<TKeyType, TValueType>::const_iterator;
+	using tMap = TMap;
 
 public:
 	cLogicMapForEach(const tMemoryTypeName& memoryKeyTypeName,
@@ -1658,7 +3207,7 @@ public:
 
 	bool registerModule() override
 	{
-		tMemoryTypeName memoryTypeNameMap = "map<" + memoryKeyTypeName.value + "," + memoryValueTypeName.value + ">";
+		tMemoryTypeName memoryTypeNameMap = cLogicMapTypeName<tMap>::get(memoryKeyTypeName, memoryValueTypeName);
 
 		setModuleName("forEach");
 		setCaptionName("forEach");
@@ -1709,7 +3258,7 @@ private: /** signalEntries */
 			return signalFlow(signalExitDone);
 		}
 
-		iter = map->begin();
+		cursor.begin(*map);
 
 		return iteration();
 	}
@@ -1727,19 +3276,18 @@ private: /** signalEntries */
 private:
 	bool iteration()
 	{
-		if (iter != map->end())
+		if (const auto* entry = cursor.next(*map))
 		{
 			if (key)
 			{
-				*key = iter->first;
+				*key = entry->first;
 			}
 
 			if (value)
 			{
-				*value = iter->second;
+				*value = entry->second;
 			}
 
-			++iter;
 			return signalFlow(signalExitIteration);
 		}
 		return signalFlow(signalExitDone);
@@ -1759,7 +3307,170 @@ private:
 	TValueType* value;
 
 private:
-	tMapIterator iter;
+	cLogicMapCursor<tMap> cursor;
+};
+
+/** one iteration per chunk of up to chunkSize entries: keys and values are vectors in map order */
+template<typename TKeyType,
+         typename TValueType,
+         typename TIntegerType,
+         typename TMap = std::map<TKeyType, TValueType>>
+class cLogicMapForEachChunk : public cLogicModule
+{
+	using tMap = TMap;
+	using tKeyVector = std::vector<TKeyType>;
+	using tValueVector = std::vector<TValueType>;
+
+public:
+	cLogicMapForEachChunk(const tMemoryTypeName& memoryKeyTypeName,
+	                      const tMemoryTypeName& memoryValueTypeName,
+	                      const tMemoryTypeName& memoryIntegerTypeName) :
+	        memoryKeyTypeName(memoryKeyTypeName),
+	        memoryValueTypeName(memoryValueTypeName),
+	        memoryIntegerTypeName(memoryIntegerTypeName)
+	{
+	}
+
+	cModule* clone() const override
+	{
+		return new cLogicMapForEachChunk(memoryKeyTypeName,
+		                                 memoryValueTypeName,
+		                                 memoryIntegerTypeName);
+	}
+
+	bool registerModule() override
+	{
+		tMemoryTypeName memoryTypeNameMap = cLogicMapTypeName<tMap>::get(memoryKeyTypeName, memoryValueTypeName);
+		tMemoryTypeName memoryKeyTypeNameVector = "vector<" + memoryKeyTypeName.value + ">";
+		tMemoryTypeName memoryValueTypeNameVector = "vector<" + memoryValueTypeName.value + ">";
+
+		setModuleName("forEachChunk");
+		setCaptionName("forEachChunk");
+
+		if (!registerSignalEntry("begin", &cLogicMapForEachChunk::signalEntryBegin))
+		{
+			return false;
+		}
+
+		if (!registerSignalEntry("continue", &cLogicMapForEachChunk::signalEntryContinue))
+		{
+			return false;
+		}
+
+		if (!registerMemoryEntry(memoryTypeNameMap.value, memoryTypeNameMap, map))
+		{
+			return false;
+		}
+
+		if (!registerMemoryEntry("chunkSize", memoryIntegerTypeName, chunkSize))
+		{
+			return false;
+		}
+
+		if (!registerSignalExit("iteration", signalExitIteration))
+		{
+			return false;
+		}
+
+		if (!registerSignalExit("done", signalExitDone))
+		{
+			return false;
+		}
+
+		if (!registerMemoryExit("keys", memoryKeyTypeNameVector, keys))
+		{
+			return false;
+		}
+
+		if (!registerMemoryExit("values", memoryValueTypeNameVector, values))
+		{
+			return false;
+		}
+
+		return true;
+	}
+
+private: /** signalEntries */
+	bool signalEntryBegin()
+	{
+		if (!map)
+		{
+			return signalFlow(signalExitDone);
+		}
+
+		cursor.begin(*map);
+		size = cLogicChunkSize::get(chunkSize);
+
+		return iteration();
+	}
+
+	bool signalEntryContinue()
+	{
+		if (!map)
+		{
+			return signalFlow(signalExitDone);
+		}
+
+		return iteration();
+	}
+
+private:
+	bool iteration()
+	{
+		const auto* entry = cursor.next(*map);
+		if (entry)
+		{
+			if (keys)
+			{
+				keys->clear();
+			}
+
+			if (values)
+			{
+				values->clear();
+			}
+
+			for (size_t i = 0; i < size && entry; i++)
+			{
+				if (keys)
+				{
+					keys->push_back(entry->first);
+				}
+
+				if (values)
+				{
+					values->push_back(entry->second);
+				}
+
+				if (i + 1 < size)
+				{
+					entry = cursor.next(*map);
+				}
+			}
+
+			return signalFlow(signalExitIteration);
+		}
+		return signalFlow(signalExitDone);
+	}
+
+private:
+	const tMemoryTypeName memoryKeyTypeName;
+	const tMemoryTypeName memoryValueTypeName;
+	const tMemoryTypeName memoryIntegerTypeName;
+
+private:
+	const tSignalExitId signalExitIteration = 1;
+	const tSignalExitId signalExitDone = 2;
+
+private:
+	tMap* map;
+	TIntegerType* chunkSize;
+	tKeyVector* keys;
+	tValueVector* values;
+
+private:
+	cLogicMapCursor<tMap> cursor;
+	size_t size;
 };
 
 template<typename TType>
@@ -3615,6 +5326,150 @@ private:
 	tArrayIterator iter;
 };
 
+/** one iteration per chunk of up to chunkSize items: chunk is a vector, so every vector module processes it.
+ *  index: position of first item of chunk */
+template<typename TType,
+         std::size_t TSize,
+         typename TIntegerType>
+class cLogicArrayForEachChunk : public cLogicModule
+{
+	using tArray = std::array<TType, TSize>;
+	using tVector = std::vector<TType>;
+
+public:
+	cLogicArrayForEachChunk(const tMemoryTypeName& memoryTypeNameArray,
+	                        const tMemoryTypeName& memoryTypeName,
+	                        const tMemoryTypeName& memoryIntegerTypeName) :
+	        memoryTypeNameArray(memoryTypeNameArray),
+	        memoryTypeName(memoryTypeName),
+	        memoryIntegerTypeName(memoryIntegerTypeName)
+	{
+	}
+
+	cModule* clone() const override
+	{
+		return new cLogicArrayForEachChunk(memoryTypeNameArray,
+		                                   memoryTypeName,
+		                                   memoryIntegerTypeName);
+	}
+
+	bool registerModule() override
+	{
+		tMemoryTypeName memoryTypeNameVector = "vector<" + memoryTypeName.value + ">";
+
+		setModuleName("forEachChunk");
+		setCaptionName("forEachChunk");
+
+		if (!registerSignalEntry("begin", &cLogicArrayForEachChunk::signalEntryBegin))
+		{
+			return false;
+		}
+
+		if (!registerSignalEntry("continue", &cLogicArrayForEachChunk::signalEntryContinue))
+		{
+			return false;
+		}
+
+		if (!registerMemoryEntry(memoryTypeNameArray.value, memoryTypeNameArray, array))
+		{
+			return false;
+		}
+
+		if (!registerMemoryEntry("chunkSize", memoryIntegerTypeName, chunkSize))
+		{
+			return false;
+		}
+
+		if (!registerSignalExit("iteration", signalExitIteration))
+		{
+			return false;
+		}
+
+		if (!registerSignalExit("done", signalExitDone))
+		{
+			return false;
+		}
+
+		if (!registerMemoryExit("chunk", memoryTypeNameVector, chunk))
+		{
+			return false;
+		}
+
+		if (!registerMemoryExit("index", memoryIntegerTypeName, index))
+		{
+			return false;
+		}
+
+		return true;
+	}
+
+private: /** signalEntries */
+	bool signalEntryBegin()
+	{
+		if (!array)
+		{
+			return signalFlow(signalExitDone);
+		}
+
+		position = 0;
+		size = cLogicChunkSize::get(chunkSize);
+
+		return iteration();
+	}
+
+	bool signalEntryContinue()
+	{
+		if (!array)
+		{
+			return signalFlow(signalExitDone);
+		}
+
+		return iteration();
+	}
+
+private:
+	bool iteration()
+	{
+		if (position < TSize)
+		{
+			const size_t count = std::min(size, TSize - position);
+
+			if (chunk)
+			{
+				chunk->assign(array->begin() + position, array->begin() + position + count);
+			}
+
+			if (index)
+			{
+				*index = position;
+			}
+
+			position += count;
+			return signalFlow(signalExitIteration);
+		}
+		return signalFlow(signalExitDone);
+	}
+
+private:
+	const tMemoryTypeName memoryTypeNameArray;
+	const tMemoryTypeName memoryTypeName;
+	const tMemoryTypeName memoryIntegerTypeName;
+
+private:
+	const tSignalExitId signalExitIteration = 1;
+	const tSignalExitId signalExitDone = 2;
+
+private:
+	tArray* array;
+	TIntegerType* chunkSize;
+	tVector* chunk;
+	TIntegerType* index;
+
+private:
+	size_t position;
+	size_t size;
+};
+
 }
 
 #endif // TVM_LOGIC_H
@@ -17,6 +17,7 @@ namespace nVirtualMachine
 class cVirtualMachine;
 class cLibrary;
 class cScheme;
+class cSchemeReplica;
 
 class cSignalEntry
 {
@@ -75,6 +76,7 @@ class cModule
 	friend class cScheme;
 	friend class cVirtualMachine;
 	friend class cActionModule;
+	friend class cSchemeReplica;
 
 	template<typename TObject>
 	friend class cSignalEntryObject;
@@ -111,12 +113,14 @@ public:
 	const tSignalExits& getSignalExits() const;
 	const tMemoryExits& getMemoryExits() const;
 	const bool& isDeprecated() const;
+	const bool& isPure() const;
 
 protected:
 	void setModuleName(const tModuleName& moduleName);
 	void setCaptionName(const tCaptionName& captionName);
 	void setCaptionTypeName(const tCaptionTypeName& captionTypeName);
 	void setDeprecated();
+	void setPure();
 
 	template<typename TObject>
 	bool registerSignalEntry(const tSignalEntryName& signalEntryName,
@@ -153,6 +157,7 @@ private:
 	tSignalExits signalExits;
 	tMemoryExits memoryExits;
 	bool deprecated;
+	bool pure; ///< own memories only: may run without virtual machine lock (parallelForEach body)
 
 protected: /** exec */
 	inline bool signalFlow(tSignalExitId signalExitId);
@@ -165,6 +170,7 @@ inline cModule::cModule()
 {
 	virtualMachine = nullptr;
 	deprecated = false;
+	pure = false;
 	scheme = nullptr;
 }
 
@@ -196,6 +202,11 @@ inline void cModule::setDeprecated()
 	deprecated = true;
 }
 
+inline void cModule::setPure()
+{
+	pure = true;
+}
+
 inline const tModuleName& cModule::getModuleName() const
 {
 	return moduleName;
@@ -236,6 +247,11 @@ inline const bool& cModule::isDeprecated() const
 	return deprecated;
 }
 
+inline const bool& cModule::isPure() const
+{
+	return pure;
+}
+
 template<typename TType>
 bool cModule::registerMemoryEntry(const tMemoryEntryName& memoryEntryName,
                                   const tMemoryTypeName& memoryTypeName,
@@ -0,0 +1,490 @@
+// Copyright © 2017, Timur Aitov. Contacts: timonbl4@gmail.com. All rights reserved
+
+#ifndef TVM_PARALLEL_H
+#define TVM_PARALLEL_H
+
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+#include "logic.h"
+#include "scheme.h"
+
+namespace nVirtualMachine
+{
+
+/** fixed threads, one pool per virtual machine: run() executes job on every worker and calling thread (worker 0) */
+class cWorkerPool
+{
+public:
+	using tJob = std::function<void(unsigned int)>;
+
+public:
+	cWorkerPool() :
+	        stopped(false),
+	        generation(0),
+	        pending(0),
+	        job(nullptr)
+	{
+	}
+
+	~cWorkerPool()
+	{
+		{
+			std::lock_guard<std::mutex> guard(mutex);
+			stopped = true;
+		}
+		conditionStart.notify_all();
+
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+	}
+
+	/** workersCount includes calling thread */
+	void start(const unsigned int workersCount)
+	{
+		for (unsigned int worker_i = 1; worker_i < workersCount; worker_i++)
+		{
+			threads.emplace_back(&cWorkerPool::loop, this, worker_i);
+		}
+	}
+
+	unsigned int getWorkersCount() const
+	{
+		return threads.size() + 1;
+	}
+
+	void run(const tJob& job)
+	{
+		std::lock_guard<std::mutex> runGuard(runMutex);
+
+		{
+			std::lock_guard<std::mutex> guard(mutex);
+			this->job = &job;
+			pending = threads.size();
+			generation++;
+		}
+		conditionStart.notify_all();
+
+		job(0);
+
+		std::unique_lock<std::mutex> lock(mutex);
+		conditionDone.wait(lock, [this]() { return !pending; });
+		this->job = nullptr;
+	}
+
+private:
+	void loop(const unsigned int worker_i)
+	{
+		uint64_t lastGeneration = 0;
+
+		for (;;)
+		{
+			const tJob* currentJob;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				conditionStart.wait(lock, [this, lastGeneration]() { return stopped || generation != lastGeneration; });
+				if (stopped)
+				{
+					return;
+				}
+
+				lastGeneration = generation;
+				currentJob = job;
+			}
+
+			(*currentJob)(worker_i);
+
+			std::lock_guard<std::mutex> guard(mutex);
+			if (!--pending)
+			{
+				conditionDone.notify_one();
+			}
+		}
+	}
+
+private:
+	std::vector<std::thread> threads;
+	std::mutex runMutex; ///< one job at a time
+	std::mutex mutex;
+	std::condition_variable conditionStart;
+	std::condition_variable conditionDone;
+	bool stopped;
+	uint64_t generation;
+	size_t pending;
+	const tJob* job;
+};
+
+/** own copy of custom module (body) connected to signal exit of module: runs without virtual machine lock.
+ *  body must be pure: memory modules, modules marked pure and memories only, no custom modules and root flows,
+ *  memory ports connected to module only, signal exits not connected */
+class cSchemeReplica
+{
+public:
+	cSchemeReplica() :
+	        scheme(nullptr),
+	        signalEntry(nullptr),
+	        signalModule(nullptr),
+	        value(nullptr),
+	        result(nullptr)
+	{
+	}
+
+	~cSchemeReplica()
+	{
+		delete scheme;
+	}
+
+	cSchemeReplica(const cSchemeReplica&) = delete;
+	cSchemeReplica& operator=(const cSchemeReplica&) = delete;
+
+	/** value: memory exit of module (to body), result: memory entry of module (from body) */
+	bool init(const cModule* module,
+	          const tSignalExitName& signalExitName,
+	          const tMemoryExitName& valueExitName,
+	          const tMemoryEntryName& resultEntryName)
+	{
+		const cScheme* parentScheme = module->scheme;
+		if (!parentScheme)
+		{
+			return false;
+		}
+
+		tModuleId moduleId = 0;
+		for (const auto& iter : parentScheme->modules)
+		{
+			if (iter.second == module)
+			{
+				moduleId = iter.first;
+			}
+		}
+
+		auto signalFlowIter = parentScheme->loadSignalFlows.find(std::make_tuple(moduleId, signalExitName));
+		if (!moduleId ||
+		    signalFlowIter == parentScheme->loadSignalFlows.end())
+		{
+			return false;
+		}
+
+		const tModuleId bodyModuleId = std::get<0>(signalFlowIter->second);
+		const tSignalEntryName& bodySignalEntryName = std::get<1>(signalFlowIter->second);
+
+		auto bodyNameIter = parentScheme->loadCustomModules.find(bodyModuleId);
+		auto bodyIter = parentScheme->customModules.find(bodyModuleId);
+		if (bodyNameIter == parentScheme->loadCustomModules.end() ||
+		    bodyIter == parentScheme->customModules.end())
+		{
+			return false;
+		}
+
+		const cScheme* body = bodyIter->second;
+		if (!isPure(parentScheme, moduleId, bodyModuleId, body))
+		{
+			return false;
+		}
+
+		/** body ports connected to value exit and result entry of module */
+		tModuleId valueModuleId;
+		tModuleId resultModuleId;
+		tMemoryEntryName bodyValueEntryName;
+		tMemoryExitName bodyResultExitName;
+		if (!parentScheme->getMemoryModule(moduleId, valueExitName,
+		                                   valueModuleId, bodyValueEntryName) ||
+		    !parentScheme->getMemoryModule(moduleId, resultEntryName,
+		                                   resultModuleId, bodyResultExitName) ||
+		    !(valueModuleId == bodyModuleId) ||
+		    !(resultModuleId == bodyModuleId))
+		{
+			return false;
+		}
+
+		/** replica scheme: body only */
+		const tModuleId replicaBodyId = 1;
+
+		scheme = new cScheme(parentScheme->virtualMachine);
+		scheme->loadCustomModules[replicaBodyId] = bodyNameIter->second;
+
+		/** body has no custom modules: only its own scheme is needed */
+		const cScheme::tSchemes schemes = {{bodyNameIter->second, const_cast<cScheme*>(body)}};
+		if (!scheme->init(schemes, parentScheme->projectId))
+		{
+			return false;
+		}
+
+		cModule* registerModule;
+		if (!scheme->findEntryPathModule(replicaBodyId,
+		                                 bodySignalEntryName,
+		                                 registerModule,
+		                                 signalModule,
+		                                 signalEntry) ||
+		    !signalEntry)
+		{
+			return false;
+		}
+
+		if (!scheme->findMemoryEntryPath(replicaBodyId, bodyValueEntryName, value) ||
+		    !scheme->findMemoryExitPath(replicaBodyId, bodyResultExitName, result) ||
+		    !value ||
+		    !result)
+		{
+			return false;
+		}
+
+		return true;
+	}
+
+	template<typename TType>
+	TType* getValue() const
+	{
+		return (TType*)value;
+	}
+
+	template<typename TType>
+	TType* getResult() const
+	{
+		return (TType*)result;
+	}
+
+	/** shared by all replicas of virtual machine */
+	inline cWorkerPool* getWorkerPool() const;
+
+	/** body is synchronous: returns when flow is done */
+	void run()
+	{
+		signalEntry->signalEntry(signalModule);
+	}
+
+private:
+	static bool isPure(const cScheme* parentScheme,
+	                   const tModuleId moduleId,
+	                   const tModuleId bodyModuleId,
+	                   const cScheme* body)
+	{
+		if (!body->loadCustomModules.empty() ||
+		    !body->loadRootSignalFlows.empty() ||
+		    !body->loadRootMemoryExitFlows.empty())
+		{
+			return false;
+		}
+
+		for (const auto& iter : body->loadModules)
+		{
+			if (!isPureModule(parentScheme, iter.second))
+			{
+				return false;
+			}
+		}
+
+		for (const auto& iter : parentScheme->loadMemoryFlows)
+		{
+			if ((std::get<0>(iter) == bodyModuleId && !(std::get<2>(iter) == moduleId)) ||
+			    (std::get<2>(iter) == bodyModuleId && !(std::get<0>(iter) == moduleId)))
+			{
+				/** non-local memory */
+				return false;
+			}
+		}
+
+		for (const auto& iter : parentScheme->loadSignalFlows)
+		{
+			if (std::get<0>(iter.first) == bodyModuleId)
+			{
+				return false;
+			}
+
+			if (std::get<0>(iter.second) == bodyModuleId &&
+			    !(std::get<0>(iter.first) == moduleId))
+			{
+				return false;
+			}
+		}
+
+		for (const auto& iter : parentScheme->loadRootSignalFlows)
+		{
+			if (std::get<0>(iter.second) == bodyModuleId)
+			{
+				return false;
+			}
+		}
+
+		for (const auto& iter : parentScheme->loadRootMemoryExitFlows)
+		{
+			if (std::get<0>(iter.second) == bodyModuleId)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	/** memory modules and modules marked pure only: library modules may share state (console ring, sockets) */
+	static inline bool isPureModule(const cScheme* scheme,
+	                                const std::tuple<tLibraryName, tModuleName>& key);
+
+private:
+	cScheme* scheme;
+	cSignalEntry* signalEntry;
+	cModule* signalModule;
+	void* value;
+	void* result;
+};
+
+/** forEach with one body replica per worker of virtual machine pool: "body" signal exit must lead to pure custom module.
+ *  value exit and result entry are connected to body ports, to[i] is result of body for from[i].
+ *  from is split into contiguous parts, one per worker. from and to may be same memory */
+template<typename TType>
+class cLogicVectorParallelForEach : public cLogicModule
+{
+	using tVector = std::vector<TType>;
+
+public:
+	cLogicVectorParallelForEach(const tMemoryTypeName& memoryTypeName) :
+	        memoryTypeName(memoryTypeName),
+	        workerPool(nullptr)
+	{
+	}
+
+	cModule* clone() const override
+	{
+		return new cLogicVectorParallelForEach(memoryTypeName);
+	}
+
+	bool registerModule() override
+	{
+		tMemoryTypeName memoryTypeNameVector = "vector<" + memoryTypeName.value + ">";
+
+		setModuleName("parallelForEach");
+		setCaptionName("parallelForEach");
+
+		if (!registerSignalEntry("signal", &cLogicVectorParallelForEach::signalEntry))
+		{
+			return false;
+		}
+
+		if (!registerMemoryEntry("from", memoryTypeNameVector, from))
+		{
+			return false;
+		}
+
+		if (!registerMemoryEntry("result", memoryTypeName, result))
+		{
+			return false;
+		}
+
+		if (!registerSignalExit("body", signalExitBody))
+		{
+			return false;
+		}
+
+		if (!registerSignalExit("done", signalExitDone))
+		{
+			return false;
+		}
+
+		if (!registerMemoryExit("value", memoryTypeName, value))
+		{
+			return false;
+		}
+
+		if (!registerMemoryExit("to", memoryTypeNameVector, to))
+		{
+			return false;
+		}
+
+		return true;
+	}
+
+	bool init() override
+	{
+		replicas.emplace_back(new cSchemeReplica());
+		if (!replicas.back()->init(this, "body", "value", "result"))
+		{
+			return false;
+		}
+
+		workerPool = replicas.back()->getWorkerPool();
+
+		while (replicas.size() < workerPool->getWorkersCount())
+		{
+			replicas.emplace_back(new cSchemeReplica());
+			if (!replicas.back()->init(this, "body", "value", "result"))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+private: /** signalEntries */
+	bool signalEntry()
+	{
+		if (!from || !to)
+		{
+			return signalFlow(signalExitDone);
+		}
+
+		to->resize(from->size());
+
+		const size_t size = from->size();
+		if (size < minParallelSize * replicas.size())
+		{
+			process(0, 0, size);
+			return signalFlow(signalExitDone);
+		}
+
+		const size_t count = replicas.size();
+		workerPool->run([this, size, count](const unsigned int worker_i)
+		{
+			process(worker_i, size * worker_i / count, size * (worker_i + 1) / count);
+		});
+
+		return signalFlow(signalExitDone);
+	}
+
+private:
+	void process(const unsigned int worker_i,
+	             const size_t begin,
+	             const size_t end)
+	{
+		cSchemeReplica* replica = replicas[worker_i].get();
+		TType* replicaValue = replica->getValue<TType>();
+		TType* replicaResult = replica->getResult<TType>();
+
+		for (size_t i = begin; i < end; i++)
+		{
+			*replicaValue = (*from)[i];
+			replica->run();
+			(*to)[i] = *replicaResult;
+		}
+	}
+
+private:
+	constexpr static size_t minParallelSize = 64; ///< items per worker, smaller vectors run on calling thread
+
+	const tMemoryTypeName memoryTypeName;
+
+private:
+	const tSignalExitId signalExitBody = 1;
+	const tSignalExitId signalExitDone = 2;
+
+private:
+	tVector* from;
+	TType* result;
+	TType* value;
+	tVector* to;
+
+private:
+	std::vector<std::unique_ptr<cSchemeReplica>> replicas;
+	cWorkerPool* workerPool;
+};
+
+}
+
+#endif // TVM_PARALLEL_H
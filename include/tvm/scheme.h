@@ -18,6 +18,7 @@ class cScheme
 	friend class cVirtualMachine;
 	friend class cModule;
 	friend class cActionModule;
+	friend class cSchemeReplica;
 
 	template<typename TObject>
 	friend class cSignalEntryObject;
@@ -150,6 +151,8 @@ private: /** exec */
 	template<typename TType>
 	inline void rootSetMemory(tRootMemoryExitId rootMemoryExitId, const TType& value);
 
+	inline bool rootIsMemoryConnected(tRootMemoryExitId rootMemoryExitId) const;
+
 	inline bool signalFlow(cModule* fromModule, tSignalExitId fromSignalExit);
 
 private: /** exec */
@@ -365,6 +368,17 @@ inline void cScheme::rootSetMemory(tRootMemoryExitId rootMemoryExitId, const TTy
 	}
 }
 
+inline bool cScheme::rootIsMemoryConnected(tRootMemoryExitId rootMemoryExitId) const
+{
+	if (rootMemoryFlows.find(rootMemoryExitId) != rootMemoryFlows.end())
+	{
+		return true;
+	}
+
+	return parentScheme &&
+	       parentScheme->rootIsMemoryConnected(rootMemoryExitId);
+}
+
 inline bool cActionModule::registerSignalEntry(const tSignalEntryName& signalEntryName,
                                                const tSignalEntryId signalEntryId)
 {
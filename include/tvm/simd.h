@@ -0,0 +1,763 @@
+// Copyright © 2017, Timur Aitov. Contacts: timonbl4@gmail.com. All rights reserved
+
+#ifndef TVM_SIMD_H
+#define TVM_SIMD_H
+
+#include <vector>
+#include <type_traits>
+
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__)
+#define TVM_SIMD_TARGET(features) __attribute__((target(features)))
+#else
+#define TVM_SIMD_TARGET(features)
+#endif
+
+namespace nVirtualMachine
+{
+
+/** vector kernels for int64_t and double arrays.
+ *  every kernel is built for each instruction set and selected once by cpu features:
+ *  one static binary (without -march) runs sse2, sse4.2, avx2 or avx512 code on every host.
+ *  double sum, dot and prefixSum are reassociated: last bits may differ from sequential loop */
+class cSimd
+{
+public:
+	enum class eLevel
+	{
+		generic, ///< sse2 on x86_64, plain vector extensions elsewhere
+		sse42,
+		avx2,
+		avx512
+	};
+
+	enum class eArithmetic
+	{
+		addition,
+		subtraction,
+		multiplication
+	};
+
+	enum class eReduction
+	{
+		sum,
+		min,
+		max
+	};
+
+	enum class eComparison
+	{
+		equal,
+		notEqual,
+		less,
+		lessOrEqual,
+		greater,
+		greaterOrEqual
+	};
+
+	template<typename TType>
+	using isSupported = std::integral_constant<bool,
+	                                           std::is_same<TType, int64_t>::value ||
+	                                           std::is_same<TType, double>::value>;
+
+public:
+	static eLevel getLevel()
+	{
+		return currentLevel();
+	}
+
+	/** for benchmarks: level is limited by cpu features */
+	static void setLevel(const eLevel level)
+	{
+		currentLevel() = level < detectLevel() ? level : detectLevel();
+	}
+
+	/** result[i] = first[i] <operation> second[i]. result may be first or second */
+	template<typename TType>
+	static void arithmetic(const eArithmetic operation,
+	                       const TType* first,
+	                       const TType* second,
+	                       TType* result,
+	                       const size_t size)
+	{
+		switch (operation)
+		{
+			case eArithmetic::addition:
+			{
+				cArithmetic<TType, eArithmetic::addition> task = {first, second, result, size};
+				return run(task);
+			}
+			case eArithmetic::subtraction:
+			{
+				cArithmetic<TType, eArithmetic::subtraction> task = {first, second, result, size};
+				return run(task);
+			}
+			case eArithmetic::multiplication:
+			{
+				cArithmetic<TType, eArithmetic::multiplication> task = {first, second, result, size};
+				return run(task);
+			}
+		}
+	}
+
+	/** result[i] = first[i] <operation> value. result may be first */
+	template<typename TType>
+	static void arithmetic(const eArithmetic operation,
+	                       const TType* first,
+	                       const TType value,
+	                       TType* result,
+	                       const size_t size)
+	{
+		switch (operation)
+		{
+			case eArithmetic::addition:
+			{
+				cArithmeticScalar<TType, eArithmetic::addition> task = {first, value, result, size};
+				return run(task);
+			}
+			case eArithmetic::subtraction:
+			{
+				cArithmeticScalar<TType, eArithmetic::subtraction> task = {first, value, result, size};
+				return run(task);
+			}
+			case eArithmetic::multiplication:
+			{
+				cArithmeticScalar<TType, eArithmetic::multiplication> task = {first, value, result, size};
+				return run(task);
+			}
+		}
+	}
+
+	/** min and max: size must not be 0 */
+	template<typename TType>
+	static TType reduce(const eReduction operation,
+	                    const TType* first,
+	                    const size_t size)
+	{
+		switch (operation)
+		{
+			case eReduction::sum:
+			{
+				cReduce<TType, eReduction::sum> task = {first, size, 0};
+				run(task);
+				return task.result;
+			}
+			case eReduction::min:
+			{
+				cReduce<TType, eReduction::min> task = {first, size, 0};
+				run(task);
+				return task.result;
+			}
+			case eReduction::max:
+			{
+				cReduce<TType, eReduction::max> task = {first, size, 0};
+				run(task);
+				return task.result;
+			}
+		}
+		return 0;
+	}
+
+	template<typename TType>
+	static TType dot(const TType* first,
+	                 const TType* second,
+	                 const size_t size)
+	{
+		cDot<TType> task = {first, second, size, 0};
+		run(task);
+		return task.result;
+	}
+
+	/** indices of items for which (first[i] <operation> value) is true */
+	template<typename TType>
+	static void compare(const eComparison operation,
+	                    const TType* first,
+	                    const TType value,
+	                    const size_t size,
+	                    std::vector<int64_t>& indices)
+	{
+		indices.resize(size);
+
+		size_t count = 0;
+		switch (operation)
+		{
+			case eComparison::equal:
+			{
+				cCompare<TType, eComparison::equal> task = {first, value, size, indices.data(), 0};
+				run(task);
+				count = task.count;
+				break;
+			}
+			case eComparison::notEqual:
+			{
+				cCompare<TType, eComparison::notEqual> task = {first, value, size, indices.data(), 0};
+				run(task);
+				count = task.count;
+				break;
+			}
+			case eComparison::less:
+			{
+				cCompare<TType, eComparison::less> task = {first, value, size, indices.data(), 0};
+				run(task);
+				count = task.count;
+				break;
+			}
+			case eComparison::lessOrEqual:
+			{
+				cCompare<TType, eComparison::lessOrEqual> task = {first, value, size, indices.data(), 0};
+				run(task);
+				count = task.count;
+				break;
+			}
+			case eComparison::greater:
+			{
+				cCompare<TType, eComparison::greater> task = {first, value, size, indices.data(), 0};
+				run(task);
+				count = task.count;
+				break;
+			}
+			case eComparison::greaterOrEqual:
+			{
+				cCompare<TType, eComparison::greaterOrEqual> task = {first, value, size, indices.data(), 0};
+				run(task);
+				count = task.count;
+				break;
+			}
+		}
+
+		indices.resize(count);
+	}
+
+	/** inclusive scan: result[i] = first[0] + ... + first[i]. result may be first.
+	 *  scan is latency bound: baseline 16 bytes build on every level, wider vectors measured slower */
+	template<typename TType>
+	static void prefixSum(const TType* first,
+	                      TType* result,
+	                      const size_t size)
+	{
+		cPrefixSum<TType> task = {first, result, size};
+		runGeneric(task);
+	}
+
+private:
+	/** loops over TWidth bytes vectors, tail is scalar. inlined into per instruction set functions below */
+	template<typename TType,
+	         size_t TWidth>
+	class cKernel
+	{
+	public:
+		typedef TType tVector __attribute__((vector_size(TWidth)));
+		typedef decltype(tVector{} < tVector{}) tIndexVector; ///< also comparison mask
+
+		constexpr static size_t lanes = TWidth / sizeof(TType);
+
+	public:
+		template<eArithmetic TOperation>
+		__attribute__((always_inline)) static void arithmetic(const TType* first,
+		                                                      const TType* second,
+		                                                      TType* result,
+		                                                      const size_t size)
+		{
+			size_t i = 0;
+			for (; i + lanes <= size; i += lanes)
+			{
+				tVector a;
+				tVector b;
+				memcpy(&a, first + i, sizeof(a));
+				memcpy(&b, second + i, sizeof(b));
+
+				if (TOperation == eArithmetic::addition)
+				{
+					a += b;
+				}
+				else if (TOperation == eArithmetic::subtraction)
+				{
+					a -= b;
+				}
+				else
+				{
+					a *= b;
+				}
+
+				memcpy(result + i, &a, sizeof(a));
+			}
+
+			for (; i < size; i++)
+			{
+				result[i] = apply<TOperation>(first[i], second[i]);
+			}
+		}
+
+		template<eArithmetic TOperation>
+		__attribute__((always_inline)) static void arithmeticScalar(const TType* first,
+		                                                            const TType value,
+		                                                            TType* result,
+		                                                            const size_t size)
+		{
+			const tVector b = tVector{} + value;
+
+			size_t i = 0;
+			for (; i + lanes <= size; i += lanes)
+			{
+				tVector a;
+				memcpy(&a, first + i, sizeof(a));
+
+				if (TOperation == eArithmetic::addition)
+				{
+					a += b;
+				}
+				else if (TOperation == eArithmetic::subtraction)
+				{
+					a -= b;
+				}
+				else
+				{
+					a *= b;
+				}
+
+				memcpy(result + i, &a, sizeof(a));
+			}
+
+			for (; i < size; i++)
+			{
+				result[i] = apply<TOperation>(first[i], value);
+			}
+		}
+
+		/** four accumulators hide add latency */
+		template<eReduction TOperation>
+		__attribute__((always_inline)) static TType reduce(const TType* first,
+		                                                   const size_t size)
+		{
+			if (size < 4 * lanes)
+			{
+				TType result = TOperation == eReduction::sum ? 0 : first[0];
+				for (size_t i = 0; i < size; i++)
+				{
+					result = combine<TOperation>(result, first[i]);
+				}
+				return result;
+			}
+
+			tVector accumulators[4];
+			for (size_t j = 0; j < 4; j++)
+			{
+				memcpy(&accumulators[j], first + j * lanes, sizeof(tVector));
+			}
+
+			size_t i = 4 * lanes;
+			for (; i + 4 * lanes <= size; i += 4 * lanes)
+			{
+				for (size_t j = 0; j < 4; j++)
+				{
+					tVector a;
+					memcpy(&a, first + i + j * lanes, sizeof(a));
+
+					if (TOperation == eReduction::sum)
+					{
+						accumulators[j] += a;
+					}
+					else if (TOperation == eReduction::min)
+					{
+						accumulators[j] = a < accumulators[j] ? a : accumulators[j];
+					}
+					else
+					{
+						accumulators[j] = accumulators[j] < a ? a : accumulators[j];
+					}
+				}
+			}
+
+			TType result = accumulators[0][0];
+			for (size_t j = 0; j < 4; j++)
+			{
+				for (size_t lane_i = (j ? 0 : 1); lane_i < lanes; lane_i++)
+				{
+					result = combine<TOperation>(result, accumulators[j][lane_i]);
+				}
+			}
+
+			for (; i < size; i++)
+			{
+				result = combine<TOperation>(result, first[i]);
+			}
+
+			return result;
+		}
+
+		__attribute__((always_inline)) static TType dot(const TType* first,
+		                                                const TType* second,
+		                                                const size_t size)
+		{
+			tVector accumulators[4] = {};
+
+			size_t i = 0;
+			for (; i + 4 * lanes <= size; i += 4 * lanes)
+			{
+				for (size_t j = 0; j < 4; j++)
+				{
+					tVector a;
+					tVector b;
+					memcpy(&a, first + i + j * lanes, sizeof(a));
+					memcpy(&b, second + i + j * lanes, sizeof(b));
+					accumulators[j] += a * b;
+				}
+			}
+
+			TType result = 0;
+			for (size_t j = 0; j < 4; j++)
+			{
+				for (size_t lane_i = 0; lane_i < lanes; lane_i++)
+				{
+					result += accumulators[j][lane_i];
+				}
+			}
+
+			for (; i < size; i++)
+			{
+				result += first[i] * second[i];
+			}
+
+			return result;
+		}
+
+		/** branchless: index is always stored, count grows by matched lanes (mask lane is -1 or 0) */
+		template<eComparison TOperation>
+		__attribute__((always_inline)) static size_t compare(const TType* first,
+		                                                     const TType value,
+		                                                     const size_t size,
+		                                                     int64_t* indices)
+		{
+			const tVector b = tVector{} + value;
+
+			size_t count = 0;
+			size_t i = 0;
+			for (; i + lanes <= size; i += lanes)
+			{
+				tVector a;
+				memcpy(&a, first + i, sizeof(a));
+
+				decltype(a < b) mask;
+				if (TOperation == eComparison::equal)
+				{
+					mask = a == b;
+				}
+				else if (TOperation == eComparison::notEqual)
+				{
+					mask = a != b;
+				}
+				else if (TOperation == eComparison::less)
+				{
+					mask = a < b;
+				}
+				else if (TOperation == eComparison::lessOrEqual)
+				{
+					mask = a <= b;
+				}
+				else if (TOperation == eComparison::greater)
+				{
+					mask = a > b;
+				}
+				else
+				{
+					mask = a >= b;
+				}
+
+#pragma GCC unroll 8
+				for (size_t lane_i = 0; lane_i < lanes; lane_i++)
+				{
+					indices[count] = i + lane_i;
+					count -= mask[lane_i];
+				}
+			}
+
+			for (; i < size; i++)
+			{
+				indices[count] = i;
+				count += check<TOperation>(first[i], value);
+			}
+
+			return count;
+		}
+
+		/** in-vector scan by log2(lanes) shifted adds, then carry of previous vectors */
+		__attribute__((always_inline)) static void prefixSum(const TType* first,
+		                                                     TType* result,
+		                                                     const size_t size)
+		{
+			tIndexVector lastMask; ///< broadcast of last lane
+#pragma GCC unroll 8
+			for (size_t lane_i = 0; lane_i < lanes; lane_i++)
+			{
+				lastMask[lane_i] = lanes - 1;
+			}
+
+			tVector carry = {};
+
+			size_t i = 0;
+			for (; i + lanes <= size; i += lanes)
+			{
+				tVector a;
+				memcpy(&a, first + i, sizeof(a));
+
+#pragma GCC unroll 8
+				for (size_t shift = 1; shift < lanes; shift <<= 1)
+				{
+					tIndexVector mask;
+#pragma GCC unroll 8
+					for (size_t lane_i = 0; lane_i < lanes; lane_i++)
+					{
+						mask[lane_i] = lane_i < shift ? lanes : lane_i - shift; ///< lanes: zero from second operand
+					}
+					a += __builtin_shuffle(a, tVector{}, mask);
+				}
+
+				a += carry;
+				carry = __builtin_shuffle(a, lastMask);
+
+				memcpy(result + i, &a, sizeof(a));
+			}
+
+			TType last = carry[0];
+			for (; i < size; i++)
+			{
+				last += first[i];
+				result[i] = last;
+			}
+		}
+
+	private:
+		template<eArithmetic TOperation>
+		__attribute__((always_inline)) static TType apply(const TType first,
+		                                                  const TType second)
+		{
+			if (TOperation == eArithmetic::addition)
+			{
+				return first + second;
+			}
+			else if (TOperation == eArithmetic::subtraction)
+			{
+				return first - second;
+			}
+			return first * second;
+		}
+
+		template<eReduction TOperation>
+		__attribute__((always_inline)) static TType combine(const TType first,
+		                                                    const TType second)
+		{
+			if (TOperation == eReduction::sum)
+			{
+				return first + second;
+			}
+			else if (TOperation == eReduction::min)
+			{
+				return second < first ? second : first;
+			}
+			return first < second ? second : first;
+		}
+
+		template<eComparison TOperation>
+		__attribute__((always_inline)) static bool check(const TType first,
+		                                                 const TType second)
+		{
+			switch (TOperation)
+			{
+				case eComparison::equal:
+					return first == second;
+				case eComparison::notEqual:
+					return first != second;
+				case eComparison::less:
+					return first < second;
+				case eComparison::lessOrEqual:
+					return first <= second;
+				case eComparison::greater:
+					return first > second;
+				case eComparison::greaterOrEqual:
+					return first >= second;
+			}
+			return false;
+		}
+	};
+
+	/** tasks: arguments of kernel, run<TWidth>() is inlined into target function */
+	template<typename TType,
+	         eArithmetic TOperation>
+	class cArithmetic
+	{
+	public:
+		template<size_t TWidth>
+		__attribute__((always_inline)) void run()
+		{
+			cKernel<TType, TWidth>::template arithmetic<TOperation>(first, second, result, size);
+		}
+
+	public:
+		const TType* first;
+		const TType* second;
+		TType* result;
+		size_t size;
+	};
+
+	template<typename TType,
+	         eArithmetic TOperation>
+	class cArithmeticScalar
+	{
+	public:
+		template<size_t TWidth>
+		__attribute__((always_inline)) void run()
+		{
+			cKernel<TType, TWidth>::template arithmeticScalar<TOperation>(first, value, result, size);
+		}
+
+	public:
+		const TType* first;
+		TType value;
+		TType* result;
+		size_t size;
+	};
+
+	template<typename TType,
+	         eReduction TOperation>
+	class cReduce
+	{
+	public:
+		template<size_t TWidth>
+		__attribute__((always_inline)) void run()
+		{
+			result = cKernel<TType, TWidth>::template reduce<TOperation>(first, size);
+		}
+
+	public:
+		const TType* first;
+		size_t size;
+		TType result;
+	};
+
+	template<typename TType>
+	class cDot
+	{
+	public:
+		template<size_t TWidth>
+		__attribute__((always_inline)) void run()
+		{
+			result = cKernel<TType, TWidth>::dot(first, second, size);
+		}
+
+	public:
+		const TType* first;
+		const TType* second;
+		size_t size;
+		TType result;
+	};
+
+	template<typename TType,
+	         eComparison TOperation>
+	class cCompare
+	{
+	public:
+		template<size_t TWidth>
+		__attribute__((always_inline)) void run()
+		{
+			count = cKernel<TType, TWidth>::template compare<TOperation>(first, value, size, indices);
+		}
+
+	public:
+		const TType* first;
+		TType value;
+		size_t size;
+		int64_t* indices;
+		size_t count;
+	};
+
+	template<typename TType>
+	class cPrefixSum
+	{
+	public:
+		template<size_t TWidth>
+		__attribute__((always_inline)) void run()
+		{
+			cKernel<TType, TWidth>::prefixSum(first, result, size);
+		}
+
+	public:
+		const TType* first;
+		TType* result;
+		size_t size;
+	};
+
+private:
+	template<typename TTask>
+	static void run(TTask& task)
+	{
+		switch (getLevel())
+		{
+			case eLevel::avx512:
+				return runAvx512(task);
+			case eLevel::avx2:
+				return runAvx2(task);
+			case eLevel::sse42:
+				return runSse42(task);
+			case eLevel::generic:
+				return runGeneric(task);
+		}
+	}
+
+	template<typename TTask>
+	static void runGeneric(TTask& task)
+	{
+		task.template run<16>();
+	}
+
+	template<typename TTask>
+	TVM_SIMD_TARGET("sse4.2") static void runSse42(TTask& task)
+	{
+		task.template run<16>();
+	}
+
+	template<typename TTask>
+	TVM_SIMD_TARGET("avx2") static void runAvx2(TTask& task)
+	{
+		task.template run<32>();
+	}
+
+	template<typename TTask>
+	TVM_SIMD_TARGET("avx512f") static void runAvx512(TTask& task)
+	{
+		task.template run<64>();
+	}
+
+	static eLevel detectLevel()
+	{
+#if defined(__x86_64__)
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx512f"))
+		{
+			return eLevel::avx512;
+		}
+		else if (__builtin_cpu_supports("avx2"))
+		{
+			return eLevel::avx2;
+		}
+		else if (__builtin_cpu_supports("sse4.2"))
+		{
+			return eLevel::sse42;
+		}
+#endif
+		return eLevel::generic;
+	}
+
+	static eLevel& currentLevel()
+	{
+		static eLevel level = detectLevel();
+		return level;
+	}
+};
+
+}
+
+#undef TVM_SIMD_TARGET
+
+#endif // TVM_SIMD_H
@@ -5,6 +5,7 @@
 
 #include <string>
 #include <vector>
+#include <array>
 #include <map>
 
 #include "string.h"
@@ -17,11 +18,11 @@ namespace nVirtualMachine
 class cStreamIn
 {
 public:
-	cStreamIn(const std::vector<uint8_t>& buffer)
+	/** copy constructed: assignment to empty vector is reported by -Wnonnull at -O3 */
+	cStreamIn(const std::vector<uint8_t>& buffer) :
+	        in{buffer, 0},
+	        failed(false)
 	{
-		this->in.buffer = buffer;
-		this->in.position = 0;
-		failed = false;
 	}
 
 	inline void pop(uint32_t& value)
@@ -88,6 +89,13 @@ public:
 		in.position += sizeof(TType);
 	}
 
+	/** class types with own serialization: void streamPop(cStreamIn& stream) */
+	template<typename TType>
+	inline auto pop(TType& value) -> decltype(value.streamPop(*this))
+	{
+		value.streamPop(*this);
+	}
+
 	template<typename TFirstType, typename TSecondType>
 	inline void pop(std::pair<TFirstType, TSecondType>& pair)
 	{
@@ -214,6 +222,13 @@ public:
 		*(TType*)(&out.buffer[size]) = value;
 	}
 
+	/** class types with own serialization: void streamPush(cStreamOut& stream) const */
+	template<typename TType>
+	inline auto push(const TType& value) -> decltype(value.streamPush(*this))
+	{
+		value.streamPush(*this);
+	}
+
 	template<typename TFirstType, typename TSecondType>
 	inline void push(const std::pair<TFirstType, TSecondType>& pair)
 	{
@@ -17,9 +17,14 @@
 #include "root.h"
 #include "action.h"
 #include "logic.h"
+#include "flowtable.h"
+#include "hashmap.h"
+#include "flatmap.h"
+#include "cow.h"
 #include "memory.h"
 #include "signal.h"
 #include "scheme.h"
+#include "parallel.h"
 #include "stream.h"
 #include "library.h"
 
@@ -33,6 +38,7 @@ class cVirtualMachine
 	friend class cLibrary;
 	friend class cScheme;
 	friend class cActionModule;
+	friend class cSchemeReplica;
 
 	template<typename TObject>
 	friend class cSignalEntryObject;
@@ -106,6 +112,10 @@ public:
 	void wait();
 	void stop();
 
+	/** parallelForEach workers (including calling thread), 0: hardware threads. set before load */
+	void setWorkersCount(const unsigned int workersCount);
+	cWorkerPool* getWorkerPool();
+
 public: /** gui */
 	using tGuiMemoryTypes = std::map<tMemoryTypeName,
 	                                 cMemory*>;
@@ -138,6 +148,14 @@ public: /** exec */
 
 	inline bool isStopped() const;
 
+private: /** exec, mutex must be locked */
+	inline void rootSignalFlowLocked(tRootSignalExitId rootSignalExitId);
+
+	template<typename TType>
+	inline void rootSetMemoryLocked(tRootMemoryExitId rootMemoryExitId, const TType& value);
+
+	inline bool rootIsMemoryConnectedLocked(tRootMemoryExitId rootMemoryExitId) const;
+
 public:
 	template<typename TType>
 	bool registerMemory(const tMemoryTypeName& memoryTypeName)
@@ -265,6 +283,16 @@ public:
 			return false;
 		}
 
+		if (!registerMemoryModule(memoryTypeNameArray,
+		                          new cLogicArrayForEachChunk<TType,
+		                                                      TSize,
+		                                                      tInteger>(memoryTypeNameArray,
+		                                                                memoryTypeName,
+		                                                                memoryIntegerTypeName)))
+		{
+			return false;
+		}
+
 		if (!registerMemoryModule(memoryTypeNameArray,
 		                          new cLogicIfEqual<tArray,
 		                                            tBoolean>(memoryTypeNameArray,
@@ -383,12 +411,158 @@ public:
 			return false;
 		}
 
+		if (!registerMemoryModule(memoryTypeNameVector,
+		                          new cLogicVectorForEachChunk<TType,
+		                                                       tInteger>(memoryTypeName,
+		                                                                 memoryIntegerTypeName)))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryTypeNameVector,
+		                          new cLogicVectorParallelForEach<TType>(memoryTypeName)))
+		{
+			return false;
+		}
+
 		if (!registerMemoryModule(memoryTypeNameVector,
 		                          new cLogicVectorGetRandomItem<TType>(memoryTypeName)))
 		{
 			return false;
 		}
 
+		if (!registerMemoryModule(memoryTypeNameVector,
+		                          new cLogicVectorSort<TType>("sort",
+		                                                      memoryTypeName,
+		                                                      false)))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryTypeNameVector,
+		                          new cLogicVectorSort<TType>("stableSort",
+		                                                      memoryTypeName,
+		                                                      true)))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryTypeNameVector,
+		                          new cLogicVectorUnique<TType>(memoryTypeName)))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryTypeNameVector,
+		                          new cLogicVectorReverse<TType>(memoryTypeName)))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryTypeNameVector,
+		                          new cLogicVectorBound<TType,
+		                                                tInteger>("lowerBound",
+		                                                          memoryTypeName,
+		                                                          memoryIntegerTypeName,
+		                                                          false)))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryTypeNameVector,
+		                          new cLogicVectorBound<TType,
+		                                                tInteger>("upperBound",
+		                                                          memoryTypeName,
+		                                                          memoryIntegerTypeName,
+		                                                          true)))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryTypeNameVector,
+		                          new cLogicVectorCount<TType,
+		                                                tInteger>(memoryTypeName,
+		                                                          memoryIntegerTypeName)))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryTypeNameVector,
+		                          new cLogicVectorMinMax<TType,
+		                                                 tInteger>("min",
+		                                                           memoryTypeName,
+		                                                           memoryIntegerTypeName,
+		                                                           false)))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryTypeNameVector,
+		                          new cLogicVectorMinMax<TType,
+		                                                 tInteger>("max",
+		                                                           memoryTypeName,
+		                                                           memoryIntegerTypeName,
+		                                                           true)))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryTypeNameVector,
+		                          new cLogicVectorSum<TType>(memoryTypeName)))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryTypeNameVector,
+		                          new cLogicVectorFilter<TType>(memoryTypeName)))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryTypeNameVector,
+		                          new cLogicVectorArithmetic<TType>("addition",
+		                                                            memoryTypeName,
+		                                                            cSimd::eArithmetic::addition)))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryTypeNameVector,
+		                          new cLogicVectorArithmetic<TType>("subtraction",
+		                                                            memoryTypeName,
+		                                                            cSimd::eArithmetic::subtraction)))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryTypeNameVector,
+		                          new cLogicVectorArithmetic<TType>("multiplication",
+		                                                            memoryTypeName,
+		                                                            cSimd::eArithmetic::multiplication)))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryTypeNameVector,
+		                          new cLogicVectorDot<TType>(memoryTypeName)))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryTypeNameVector,
+		                          new cLogicVectorCompare<TType,
+		                                                  tInteger>(memoryTypeName,
+		                                                            memoryIntegerTypeName)))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryTypeNameVector,
+		                          new cLogicVectorPrefixSum<TType>(memoryTypeName)))
+		{
+			return false;
+		}
+
 		if (!registerMemoryModule(memoryTypeNameVector, new cLogicConvert<tVector,
 		                                                                  tBuffer>("toBuffer",
 		                                                                           memoryTypeNameVector,
@@ -507,6 +681,151 @@ public:
 			return false;
 		}
 
+		if (!registerMemoryModule(memoryTypeNameMap,
+		                          new cLogicMapForEachChunk<TKeyType,
+		                                                    TValueType,
+		                                                    tInteger>(memoryKeyTypeName,
+		                                                              memoryValueTypeName,
+		                                                              memoryIntegerTypeName)))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryTypeNameMap, new cLogicConvert<tMap,
+		                                                               tBuffer>("toBuffer",
+		                                                                        memoryTypeNameMap,
+		                                                                        memoryBufferTypeName,
+			[](tMap* from, tBuffer* to)
+			{
+				cStreamOut stream;
+				stream.push(*from);
+				*to = stream.getBuffer();
+			})))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryTypeNameMap, new cLogicConvertBool<tBuffer,
+		                                                                   tMap>("fromBuffer",
+		                                                                         memoryBufferTypeName,
+		                                                                         memoryTypeNameMap,
+			[](tBuffer* from, tMap* to)
+			{
+				cStreamIn stream(*from);
+				stream.pop(*to);
+				if (stream.isFailed())
+				{
+					return false;
+				}
+				return true;
+			})))
+		{
+			return false;
+		}
+
+		memoryTypes[memoryTypeNameMap] = new cMemoryVariable<tMap>();
+		return true;
+	}
+
+	/** unordered: open addressing table, same logic modules as map */
+	template<typename TKeyType,
+	         typename TValueType>
+	bool registerMemoryHashMap(const tMemoryTypeName& memoryKeyTypeName,
+	                           const tMemoryTypeName& memoryValueTypeName)
+	{
+		using tMap = cHashMap<TKeyType, TValueType>;
+		tMemoryTypeName memoryTypeNameMap = "hashMap<" + memoryKeyTypeName.value + "," + memoryValueTypeName.value + ">";
+
+		if (memoryTypes.find(memoryTypeNameMap) != memoryTypes.end())
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryTypeNameMap,
+		                          new cLogicCopy<tMap>(memoryTypeNameMap)))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryTypeNameMap,
+		                          new cLogicSetClear<tMap>(memoryTypeNameMap)))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryTypeNameMap,
+		                          new cLogicIsEmpty<tMap,
+		                                            tBoolean>(memoryTypeNameMap,
+		                                                      memoryBooleanTypeName)))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryTypeNameMap,
+		                          new cLogicMapInsertOrUpdate<TKeyType,
+		                                                      TValueType,
+		                                                      tMap>(memoryKeyTypeName,
+		                                                            memoryValueTypeName)))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryTypeNameMap,
+		                          new cLogicMapFind<TKeyType,
+		                                            TValueType,
+		                                            tMap>(memoryKeyTypeName,
+		                                                  memoryValueTypeName)))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryTypeNameMap,
+		                          new cLogicMapSelectOrCreate<TKeyType,
+		                                                      TValueType,
+		                                                      tMap>(memoryKeyTypeName,
+		                                                            memoryValueTypeName)))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryTypeNameMap,
+		                          new cLogicSize<tMap,
+		                                         tInteger>("getCount",
+		                                                   memoryTypeNameMap,
+		                                                   memoryIntegerTypeName)))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryTypeNameMap,
+		                          new cLogicMapGet<TKeyType,
+		                                           TValueType,
+		                                           tMap>(memoryKeyTypeName,
+		                                                 memoryValueTypeName)))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryTypeNameMap,
+		                          new cLogicMapForEach<TKeyType,
+		                                               TValueType,
+		                                               tMap>(memoryKeyTypeName,
+		                                                     memoryValueTypeName)))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryTypeNameMap,
+		                          new cLogicMapForEachChunk<TKeyType,
+		                                                    TValueType,
+		                                                    tInteger,
+		                                                    tMap>(memoryKeyTypeName,
+		                                                          memoryValueTypeName,
+		                                                          memoryIntegerTypeName)))
+		{
+			return false;
+		}
+
 		if (!registerMemoryModule(memoryTypeNameMap, new cLogicConvert<tMap,
 		                                                               tBuffer>("toBuffer",
 		                                                                        memoryTypeNameMap,
@@ -543,6 +862,248 @@ public:
 		return true;
 	}
 
+	/** built once (insert + build, or fromMap), then read: sorted arrays with binary search */
+	template<typename TKeyType,
+	         typename TValueType>
+	bool registerMemoryFlatMap(const tMemoryTypeName& memoryKeyTypeName,
+	                           const tMemoryTypeName& memoryValueTypeName)
+	{
+		using tFlatMap = cFlatMap<TKeyType, TValueType>;
+		tMemoryTypeName memoryTypeNameFlatMap = "flatMap<" + memoryKeyTypeName.value + "," + memoryValueTypeName.value + ">";
+
+		if (memoryTypes.find(memoryTypeNameFlatMap) != memoryTypes.end())
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryTypeNameFlatMap,
+		                          new cLogicCopy<tFlatMap>(memoryTypeNameFlatMap)))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryTypeNameFlatMap,
+		                          new cLogicSetClear<tFlatMap>(memoryTypeNameFlatMap)))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryTypeNameFlatMap,
+		                          new cLogicIsEmpty<tFlatMap,
+		                                            tBoolean>(memoryTypeNameFlatMap,
+		                                                      memoryBooleanTypeName)))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryTypeNameFlatMap,
+		                          new cLogicFlatMapInsert<TKeyType,
+		                                                  TValueType>(memoryKeyTypeName,
+		                                                              memoryValueTypeName)))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryTypeNameFlatMap,
+		                          new cLogicFlatMapBuild<TKeyType,
+		                                                 TValueType>(memoryKeyTypeName,
+		                                                             memoryValueTypeName)))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryTypeNameFlatMap,
+		                          new cLogicFlatMapFind<TKeyType,
+		                                                TValueType>(memoryKeyTypeName,
+		                                                            memoryValueTypeName)))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryTypeNameFlatMap,
+		                          new cLogicFlatMapForEach<TKeyType,
+		                                                   TValueType>(memoryKeyTypeName,
+		                                                               memoryValueTypeName)))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryTypeNameFlatMap,
+		                          new cLogicFlatMapFromMap<TKeyType,
+		                                                   TValueType>(memoryKeyTypeName,
+		                                                               memoryValueTypeName)))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryTypeNameFlatMap,
+		                          new cLogicSize<tFlatMap,
+		                                         tInteger>("getCount",
+		                                                   memoryTypeNameFlatMap,
+		                                                   memoryIntegerTypeName)))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryTypeNameFlatMap, new cLogicConvert<tFlatMap,
+		                                                                   tBuffer>("toBuffer",
+		                                                                            memoryTypeNameFlatMap,
+		                                                                            memoryBufferTypeName,
+			[](tFlatMap* from, tBuffer* to)
+			{
+				cStreamOut stream;
+				stream.push(*from);
+				*to = stream.getBuffer();
+			})))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryTypeNameFlatMap, new cLogicConvertBool<tBuffer,
+		                                                                       tFlatMap>("fromBuffer",
+		                                                                                 memoryBufferTypeName,
+		                                                                                 memoryTypeNameFlatMap,
+			[](tBuffer* from, tFlatMap* to)
+			{
+				cStreamIn stream(*from);
+				stream.pop(*to);
+				if (stream.isFailed())
+				{
+					return false;
+				}
+				return true;
+			})))
+		{
+			return false;
+		}
+
+		memoryTypes[memoryTypeNameFlatMap] = new cMemoryVariable<tFlatMap>();
+		return true;
+	}
+
+	/** open addressing hash table with idle aging, for per packet lookups */
+	template<typename TKeyType,
+	         typename TValueType>
+	bool registerMemoryFlowTable(const tMemoryTypeName& memoryKeyTypeName,
+	                             const tMemoryTypeName& memoryValueTypeName)
+	{
+		using tFlowTable = cFlowTable<TKeyType, TValueType>;
+		tMemoryTypeName memoryTypeNameFlowTable = "flowTable<" + memoryKeyTypeName.value + "," + memoryValueTypeName.value + ">";
+
+		if (memoryTypes.find(memoryTypeNameFlowTable) != memoryTypes.end())
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryTypeNameFlowTable,
+		                          new cLogicCopy<tFlowTable>(memoryTypeNameFlowTable)))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryTypeNameFlowTable,
+		                          new cLogicSetClear<tFlowTable>(memoryTypeNameFlowTable)))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryTypeNameFlowTable,
+		                          new cLogicIsEmpty<tFlowTable,
+		                                            tBoolean>(memoryTypeNameFlowTable,
+		                                                      memoryBooleanTypeName)))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryTypeNameFlowTable,
+		                          new cLogicFlowTableInsert<TKeyType,
+		                                                    TValueType>(memoryKeyTypeName,
+		                                                                memoryValueTypeName)))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryTypeNameFlowTable,
+		                          new cLogicFlowTableLookup<TKeyType,
+		                                                    TValueType>(memoryKeyTypeName,
+		                                                                memoryValueTypeName)))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryTypeNameFlowTable,
+		                          new cLogicFlowTableDelete<TKeyType,
+		                                                    TValueType>(memoryKeyTypeName,
+		                                                                memoryValueTypeName)))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryTypeNameFlowTable,
+		                          new cLogicFlowTableAge<TKeyType,
+		                                                 TValueType,
+		                                                 tInteger>(memoryKeyTypeName,
+		                                                           memoryValueTypeName,
+		                                                           memoryIntegerTypeName)))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryTypeNameFlowTable,
+		                          new cLogicFlowTableSetLimit<TKeyType,
+		                                                      TValueType,
+		                                                      tInteger>(memoryKeyTypeName,
+		                                                                memoryValueTypeName,
+		                                                                memoryIntegerTypeName)))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryTypeNameFlowTable,
+		                          new cLogicSize<tFlowTable,
+		                                         tInteger>("getCount",
+		                                                   memoryTypeNameFlowTable,
+		                                                   memoryIntegerTypeName)))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryTypeNameFlowTable, new cLogicConvert<tFlowTable,
+		                                                                     tBuffer>("toBuffer",
+		                                                                              memoryTypeNameFlowTable,
+		                                                                              memoryBufferTypeName,
+			[](tFlowTable* from, tBuffer* to)
+			{
+				cStreamOut stream;
+				stream.push(*from);
+				*to = stream.getBuffer();
+			})))
+		{
+			return false;
+		}
+
+		if (!registerMemoryModule(memoryTypeNameFlowTable, new cLogicConvertBool<tBuffer,
+		                                                                         tFlowTable>("fromBuffer",
+		                                                                                     memoryBufferTypeName,
+		                                                                                     memoryTypeNameFlowTable,
+			[](tBuffer* from, tFlowTable* to)
+			{
+				cStreamIn stream(*from);
+				stream.pop(*to);
+				if (stream.isFailed())
+				{
+					return false;
+				}
+				return true;
+			})))
+		{
+			return false;
+		}
+
+		memoryTypes[memoryTypeNameFlowTable] = new cMemoryVariable<tFlowTable>();
+		return true;
+	}
+
 	template<typename TTuple>
 	bool registerMemoryTuple(const std::vector<std::pair<tMemoryName, tMemoryTypeName>>& memories)
 	{
@@ -965,11 +1526,17 @@ private: /** exec */
 	std::mutex mutex; /**< @todo: mutex perProject */
 	tRootSignalExitId rootSignalSchemeLoaded;
 	tRootSignalExitId rootSignalSchemeUnload;
+
+private: /** parallelForEach */
+	unsigned int workersCount;
+	std::once_flag workerPoolStarted;
+	cWorkerPool workerPool;
 };
 
 inline cVirtualMachine::cVirtualMachine()
 {
 	stopped = false;
+	workersCount = 0;
 	registerBuildInLibrary();
 }
 
@@ -1018,6 +1585,31 @@ inline bool cVirtualMachine::init()
 	return true;
 }
 
+inline void cVirtualMachine::setWorkersCount(const unsigned int workersCount)
+{
+	this->workersCount = workersCount;
+}
+
+inline cWorkerPool* cVirtualMachine::getWorkerPool()
+{
+	std::call_once(workerPoolStarted, [this]()
+	{
+		unsigned int count = workersCount;
+		if (!count)
+		{
+			count = std::thread::hardware_concurrency();
+		}
+		if (!count)
+		{
+			count = 1;
+		}
+
+		workerPool.start(count);
+	});
+
+	return &workerPool;
+}
+
 inline bool cVirtualMachine::loadFromFile(const std::string& filePath)
 {
 	return loadFromFile(basename(filePath.c_str()),
@@ -1247,6 +1839,11 @@ inline const cVirtualMachine::tGuiMemoryModules cVirtualMachine::getGuiMemoryMod
 inline void cVirtualMachine::rootSignalFlow(tRootSignalExitId rootSignalExitId)
 {
 	std::lock_guard<std::mutex> guard(mutex);
+	rootSignalFlowLocked(rootSignalExitId);
+}
+
+inline void cVirtualMachine::rootSignalFlowLocked(tRootSignalExitId rootSignalExitId)
+{
 	for (const auto& currentSchemeIter : currentSchemes)
 	{
 		cScheme* currentScheme = currentSchemeIter.second;
@@ -1254,6 +1851,18 @@ inline void cVirtualMachine::rootSignalFlow(tRootSignalExitId rootSignalExitId)
 	}
 }
 
+inline bool cVirtualMachine::rootIsMemoryConnectedLocked(tRootMemoryExitId rootMemoryExitId) const
+{
+	for (const auto& currentSchemeIter : currentSchemes)
+	{
+		if (currentSchemeIter.second->rootIsMemoryConnected(rootMemoryExitId))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
 inline bool cVirtualMachine::isStopped() const
 {
 	return stopped;
@@ -1495,6 +2104,36 @@ bool cLibrary::registerMemoryMap(const tMemoryTypeName& memoryKeyTypeName,
 	                                                     memoryValueTypeName);
 }
 
+template<typename TKeyType,
+         typename TValueType>
+bool cLibrary::registerMemoryHashMap(const tMemoryTypeName& memoryKeyTypeName,
+                                     const tMemoryTypeName& memoryValueTypeName)
+{
+	return virtualMachine->registerMemoryHashMap<TKeyType,
+	                                             TValueType>(memoryKeyTypeName,
+	                                                         memoryValueTypeName);
+}
+
+template<typename TKeyType,
+         typename TValueType>
+bool cLibrary::registerMemoryFlatMap(const tMemoryTypeName& memoryKeyTypeName,
+                                     const tMemoryTypeName& memoryValueTypeName)
+{
+	return virtualMachine->registerMemoryFlatMap<TKeyType,
+	                                             TValueType>(memoryKeyTypeName,
+	                                                         memoryValueTypeName);
+}
+
+template<typename TKeyType,
+         typename TValueType>
+bool cLibrary::registerMemoryFlowTable(const tMemoryTypeName& memoryKeyTypeName,
+                                       const tMemoryTypeName& memoryValueTypeName)
+{
+	return virtualMachine->registerMemoryFlowTable<TKeyType,
+	                                               TValueType>(memoryKeyTypeName,
+	                                                           memoryValueTypeName);
+}
+
 template<typename TTuple>
 bool cLibrary::registerMemoryTuple(tMemoryTypeName memoryTypeNameTuple,
                                    const std::vector<std::pair<tMemoryName, tMemoryTypeName>>& memories)
@@ -1549,6 +2188,29 @@ inline void cLibrary::rootSetMemory(tRootMemoryExitId rootMemoryExitId, const TT
 	virtualMachine->rootSetMemory(rootMemoryExitId, value);
 }
 
+template<typename TCallback>
+inline void cLibrary::rootExecute(const TCallback& callback)
+{
+	std::lock_guard<std::mutex> guard(virtualMachine->mutex);
+	callback();
+}
+
+inline void cLibrary::rootSignalFlowLocked(tRootSignalExitId rootSignalExitId)
+{
+	virtualMachine->rootSignalFlowLocked(rootSignalExitId);
+}
+
+template<typename TType>
+inline void cLibrary::rootSetMemoryLocked(tRootMemoryExitId rootMemoryExitId, const TType& value)
+{
+	virtualMachine->rootSetMemoryLocked(rootMemoryExitId, value);
+}
+
+inline bool cLibrary::rootIsMemoryConnectedLocked(tRootMemoryExitId rootMemoryExitId) const
+{
+	return virtualMachine->rootIsMemoryConnectedLocked(rootMemoryExitId);
+}
+
 inline bool cLibrary::isStopped() const
 {
 	return virtualMachine->isStopped();
@@ -2108,6 +2770,12 @@ template<typename TType>
 void cVirtualMachine::rootSetMemory(tRootMemoryExitId rootMemoryExitId, const TType& value)
 {
 	std::lock_guard<std::mutex> guard(mutex);
+	rootSetMemoryLocked(rootMemoryExitId, value);
+}
+
+template<typename TType>
+void cVirtualMachine::rootSetMemoryLocked(tRootMemoryExitId rootMemoryExitId, const TType& value)
+{
 	for (const auto& currentSchemeIter : currentSchemes)
 	{
 		cScheme* currentScheme = currentSchemeIter.second;
@@ -2115,6 +2783,30 @@ void cVirtualMachine::rootSetMemory(tRootMemoryExitId rootMemoryExitId, const TT
 	}
 }
 
+inline cWorkerPool* cSchemeReplica::getWorkerPool() const
+{
+	return scheme->virtualMachine->getWorkerPool();
+}
+
+inline bool cSchemeReplica::isPureModule(const cScheme* scheme,
+                                         const std::tuple<tLibraryName, tModuleName>& key)
+{
+	if (std::get<0>(key).value.compare(0, 8, ":memory:") == 0)
+	{
+		return true;
+	}
+
+	const auto modules = scheme->virtualMachine->getModules();
+	auto iter = modules.find(key);
+	if (iter == modules.end())
+	{
+		return false;
+	}
+
+	return iter->second->getModuleTypeName().value == "logic" &&
+	       iter->second->isPure();
+}
+
 inline bool cActionModule::signalFlow(tSignalExitId signalExitId)
 {
 	std::lock_guard<std::mutex> guard(scheme->virtualMachine->mutex);